@@ -0,0 +1,308 @@
+/* galois_bench.cpp
+ *
+ * Benchmarks for libgalois, written as JSON to standard output.
+ *
+ * "single" times galois_single_multiply/divide and the per-method functions
+ * (multtable, logtable, shift, split_w8) for every w they support.  The
+ * table methods stop at the largest w whose tables fit comfortably in
+ * memory:  w = 12 for multtable (128 MB) and w = 22 for logtable (64 MB).
+ *
+ * "region" times galois_region_xor and the w = 8, 16 and 32 region
+ * multiplies, in overwrite and add mode, on buffers from 4 KB (well inside
+ * L1) up to twice the last level cache (at least 16 MB, at most 512 MB).
+ *
+ * Every measurement is the best of three runs, each long enough to take a
+ * third of --min-time seconds.  Tables are built before timing starts.
+ * cycles_per_byte counts time stamp counter ticks, so it is in reference
+ * cycles, and is null on CPUs without a TSC.
+ *
+ * Usage: galois_bench [--min-time SECONDS] [--simd LEVEL]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fmt/core.h"
+#include "fmt/format.h"
+#include "galois.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+#ifndef GALOIS_VERSION
+#define GALOIS_VERSION "unknown"
+#endif
+
+static double min_time = 0.1;
+
+struct bench_result {
+    double ns;     /* Per call of fn */
+    double cycles; /* Per call of fn, or -1 */
+};
+
+static unsigned long long bench_ticks() {
+#ifdef BENCH_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* Calls fn(iters) with iters doubled until a run takes a third of
+   min_time, then keeps the best of three runs of that length. */
+
+static bench_result bench_run(const std::function<void(unsigned long)> &fn) {
+    using clock = std::chrono::steady_clock;
+    unsigned long iters;
+    unsigned long long t0, t1;
+    double secs, best_ns, best_cycles;
+    int r;
+
+    iters = 1;
+    fn(1);
+    for (;;) {
+        auto start = clock::now();
+        fn(iters);
+        secs = std::chrono::duration<double>(clock::now() - start).count();
+        if (secs >= min_time / 3 || iters >= (1UL << 40))
+            break;
+        iters *= (secs < min_time / 300) ? 16 : 2;
+    }
+
+    best_ns = 1e300;
+    best_cycles = 1e300;
+    for (r = 0; r < 3; r++) {
+        auto start = clock::now();
+        t0 = bench_ticks();
+        fn(iters);
+        t1 = bench_ticks();
+        secs = std::chrono::duration<double>(clock::now() - start).count();
+        best_ns = std::min(best_ns, secs * 1e9 / iters);
+        best_cycles = std::min(best_cycles, (double)(t1 - t0) / iters);
+    }
+#ifndef BENCH_HAVE_TSC
+    best_cycles = -1;
+#endif
+    return {best_ns, best_cycles};
+}
+
+static std::string json_number(double x) {
+    return (x < 0) ? "null" : fmt::format("{:.4f}", x);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Single multiplies and divides                                           */
+/* ---------------------------------------------------------------------- */
+
+typedef unsigned (*binary_op)(unsigned x, unsigned y, unsigned w);
+
+static unsigned split_w8_multiply(unsigned x, unsigned y, unsigned) {
+    return galois_split_w8_multiply(x, y);
+}
+
+static std::vector<std::string> single_results;
+
+static void bench_single(const char *method, const char *op, unsigned w,
+                         binary_op fn) {
+    std::vector<unsigned> x(1024), y(1024);
+    unsigned mask = (w == 32) ? 0xffffffffu : (1u << w) - 1;
+    volatile unsigned sink;
+    bench_result r;
+    unsigned i;
+
+    srand(w);
+    for (i = 0; i < 1024; i++) {
+        x[i] = rand() & mask;
+        do {
+            y[i] = rand() & mask;
+        } while (y[i] == 0);
+    }
+
+    r = bench_run([&](unsigned long iters) {
+        unsigned acc = 0;
+        unsigned long n;
+
+        for (n = 0; n < iters; n++)
+            acc ^= fn(x[n & 1023], y[n & 1023], w);
+        sink = acc;
+    });
+    (void)sink;
+
+    single_results.push_back(fmt::format(
+        "    {{\"w\": {}, \"method\": \"{}\", \"op\": \"{}\", "
+        "\"ns_per_op\": {}, \"mops_per_s\": {}, \"cycles_per_op\": {}}}",
+        w, method, op, json_number(r.ns), json_number(1e3 / r.ns),
+        json_number(r.cycles)));
+}
+
+static void bench_singles() {
+    unsigned w;
+
+    for (w = 1; w <= 32; w++) {
+        bench_single("default", "multiply", w, galois_single_multiply);
+        bench_single("default", "divide", w, galois_single_divide);
+
+        if (w <= 12 && galois_create_mult_tables(w) == 0) {
+            bench_single("multtable", "multiply", w,
+                         galois_multtable_multiply);
+            bench_single("multtable", "divide", w, galois_multtable_divide);
+        }
+        if (w <= 22 && galois_create_log_tables(w) == 0) {
+            bench_single("logtable", "multiply", w, galois_logtable_multiply);
+            bench_single("logtable", "divide", w, galois_logtable_divide);
+        }
+        bench_single("shift", "multiply", w, galois_shift_multiply);
+        bench_single("shift", "divide", w, galois_shift_divide);
+    }
+    if (galois_create_split_w8_tables() == 0)
+        bench_single("split_w8", "multiply", 32, split_w8_multiply);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Region functions                                                        */
+/* ---------------------------------------------------------------------- */
+
+typedef void (*region_op)(char *region, unsigned multby, unsigned nbytes,
+                          char *r2, unsigned add);
+
+static std::vector<std::string> region_results;
+
+static void bench_region(const char *name, const char *mode, unsigned nbytes,
+                         const std::function<void()> &call) {
+    bench_result r;
+
+    r = bench_run([&](unsigned long iters) {
+        unsigned long n;
+
+        for (n = 0; n < iters; n++)
+            call();
+    });
+
+    region_results.push_back(fmt::format(
+        "    {{\"function\": \"{}\", \"mode\": \"{}\", \"bytes\": {}, "
+        "\"ns_per_op\": {}, \"gb_per_s\": {}, \"cycles_per_byte\": {}}}",
+        name, mode, nbytes, json_number(r.ns), json_number(nbytes / r.ns),
+        json_number(r.cycles < 0 ? -1 : r.cycles / nbytes)));
+}
+
+static long cache_size(int name, long fallback) {
+    long s = sysconf(name);
+    return (s > 0) ? s : fallback;
+}
+
+static std::vector<unsigned> region_sizes() {
+    std::vector<unsigned> sizes;
+    unsigned long s, top;
+
+    top = 2 * (unsigned long)cache_size(_SC_LEVEL3_CACHE_SIZE,
+                                        cache_size(_SC_LEVEL2_CACHE_SIZE,
+                                                   8 << 20));
+    top = std::min(std::max(top, 16UL << 20), 512UL << 20);
+    for (s = 4096; s <= top; s *= 4)
+        sizes.push_back(s);
+    if (sizes.back() < top)
+        sizes.push_back(top);
+    return sizes;
+}
+
+static void bench_regions() {
+    static const struct {
+        const char *name;
+        region_op fn;
+    } multiplies[] = {
+        {"galois_w08_region_multiply", galois_w08_region_multiply},
+        {"galois_w16_region_multiply", galois_w16_region_multiply},
+        {"galois_w32_region_multiply", galois_w32_region_multiply},
+    };
+    static const unsigned multby[] = {0x8e, 0x8e3d, 0x8e3d5a1fu};
+    std::vector<unsigned> sizes = region_sizes();
+    unsigned top = sizes.back(), i, f;
+    char *src, *dst;
+
+    if (posix_memalign((void **)&src, 64, top) != 0 ||
+        posix_memalign((void **)&dst, 64, top) != 0) {
+        fmt::print(stderr, "galois_bench: cannot allocate {} bytes\n", top);
+        exit(1);
+    }
+    for (i = 0; i < top; i++) {
+        src[i] = (char)(i * 131 + 7);
+        dst[i] = (char)(i * 17 + 3);
+    }
+
+    for (unsigned nbytes : sizes) {
+        bench_region("galois_region_xor", "add", nbytes,
+                     [&] { galois_region_xor(src, dst, dst, nbytes); });
+        for (f = 0; f < 3; f++) {
+            bench_region(multiplies[f].name, "overwrite", nbytes, [&] {
+                multiplies[f].fn(src, multby[f], nbytes, dst, 0);
+            });
+            bench_region(multiplies[f].name, "add", nbytes, [&] {
+                multiplies[f].fn(src, multby[f], nbytes, dst, 1);
+            });
+        }
+    }
+    free(src);
+    free(dst);
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void print_list(const char *name, const std::vector<std::string> &v,
+                       bool last) {
+    size_t i;
+
+    fmt::print("  \"{}\": [\n", name);
+    for (i = 0; i < v.size(); i++)
+        fmt::print("{}{}\n", v[i], (i + 1 < v.size()) ? "," : "");
+    fmt::print("  ]{}\n", last ? "" : ",");
+}
+
+int main(int argc, char **argv) {
+    static const char *levels[] = {"none", "ssse3", "avx2", "avx512"};
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_time = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--simd") == 0 && i + 1 < argc) {
+            if (galois_set_simd_level(atoi(argv[++i])) != 0) {
+                fmt::print(stderr, "galois_bench: SIMD level {} is not "
+                                   "supported here\n",
+                           argv[i]);
+                return 1;
+            }
+        } else {
+            fmt::print(stderr,
+                       "usage: galois_bench [--min-time SECONDS] "
+                       "[--simd LEVEL]\n");
+            return 1;
+        }
+    }
+
+    bench_singles();
+    bench_regions();
+
+    fmt::print("{{\n");
+    fmt::print("  \"library\": \"libgalois\",\n");
+    fmt::print("  \"version\": \"{}\",\n", GALOIS_VERSION);
+    fmt::print("  \"simd_level\": \"{}\",\n",
+               levels[std::min(galois_get_simd_level(), 3u)]);
+    fmt::print("  \"min_time\": {},\n", min_time);
+    fmt::print("  \"cache_bytes\": {{\"l1d\": {}, \"l2\": {}, \"l3\": {}}},\n",
+               cache_size(_SC_LEVEL1_DCACHE_SIZE, 0),
+               cache_size(_SC_LEVEL2_CACHE_SIZE, 0),
+               cache_size(_SC_LEVEL3_CACHE_SIZE, 0));
+    print_list("single", single_results, false);
+    print_list("region", region_results, true);
+    fmt::print("}}\n");
+    return 0;
+}
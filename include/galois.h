@@ -52,10 +52,100 @@ unsigned galois_split_w8_multiply(unsigned x, unsigned y);
 unsigned galois_inverse(unsigned x, unsigned w);
 unsigned galois_shift_inverse(unsigned y, unsigned w);
 
+/* Inverts the rows x rows matrix mat over GF(2^w), row-major, into inv.
+   mat is destroyed.  For w = 8, 16 and 32 the row operations are region
+   multiplies.  Returns 0 on success, -1 if mat is singular or w is bad. */
+unsigned galois_invert_matrix(unsigned *mat, unsigned *inv, unsigned rows,
+                              unsigned w);
+
+/* Element-wise arithmetic on arrays of n elements:
+
+     out[i] = x[i] * y[i],   out[i] = x[i] / y[i],   out[i] = 1 / y[i]
+
+   The elements are bytes for w <= 8, 16-bit words for w <= 16 and
+   unsigned ints above that.  Zeros give the same results as
+   galois_single_multiply/divide and galois_inverse.  out may be the same
+   array as x or y.  w = 8 and 16 use the log tables with vector gathers,
+   w = 32 uses carry-less multiplication, and for w > 22 n inverses cost
+   about one galois_inverse() per 1024 elements plus three multiplies
+   each. */
+
+void galois_batch_multiply(const void *x, const void *y, void *out,
+                           unsigned long n, unsigned w);
+void galois_batch_divide(const void *x, const void *y, void *out,
+                         unsigned long n, unsigned w);
+void galois_batch_inverse(const void *y, void *out, unsigned long n,
+                          unsigned w);
+
+/* The tables as the library keeps them.  Entries are unsigned char for
+   w <= 8, unsigned short for w <= 16 and unsigned above that.  For nonzero
+   x and y,
+
+     x * y = mult[(x << w) | y] = ilog[log[x] + log[y]]
+     x / y = div[(x << w) | y]  = ilog[log[x] + (2^w - 1) - log[y]]
+
+   ilog has 2 (2^w - 1) + 1 entries, log[0] is 2^w - 1, and div holds all
+   ones (in the entry type) for y = 0.  The mult/div tables exist for
+   w <= 13 and the log tables for w <= 30.  These return NULL if the
+   tables cannot be made. */
+const void *galois_get_compact_mult_table(unsigned w);
+const void *galois_get_compact_div_table(unsigned w);
+const void *galois_get_compact_log_table(unsigned w);
+const void *galois_get_compact_ilog_table(unsigned w);
+
+/* Unsigned copies of the tables above, in the layout these functions have
+   always returned:  the ilog pointer is in the middle of three copies of
+   the powers, so log[x] - log[y] may be used as an index, and div holds -1
+   for y = 0.  A copy is made the first time it is asked for, so these cost
+   memory; new code should use the compact tables. */
 unsigned *galois_get_mult_table(unsigned w);
 unsigned *galois_get_div_table(unsigned w);
 unsigned *galois_get_log_table(unsigned w);
 unsigned *galois_get_ilog_table(unsigned w);
+unsigned *galois_get_split_w8_table(unsigned i); /* 0 <= i < 7 */
+
+/* Persistent tables.  By default every process builds the tables it uses
+   on its own heap.  After galois_set_table_store(dir, flags), the log,
+   mult/div and split_w8 tables created from then on are kept in files
+   under dir:  the first process to need a set builds it and writes it
+   there, and the others map the file read-only, so they start without
+   building anything and the host holds one copy of each set however many
+   processes use it.  dir must exist and be writable; a tmpfs such as
+   /dev/shm keeps the files in memory.  Each file carries a format version
+   and a checksum, and one that does not match is rebuilt.  If the store
+   cannot be used, the tables are built privately as before.
+
+   GALOIS_STORE_HUGE_PAGES asks for the mappings to be backed with
+   transparent huge pages, which the kernel only does where the filesystem
+   supports it (e.g. tmpfs mounted with huge=within_size).  Passing NULL
+   turns the store off; tables that already exist stay as they are.
+   Returns 0 on success, -1 if dir is not a directory or flags are bad. */
+
+enum galois_store_flags : unsigned {
+    GALOIS_STORE_HUGE_PAGES = 1
+};
+
+unsigned galois_set_table_store(const char *dir, unsigned flags);
+
+/* NUMA replicas.  Normally each table is one allocation, on whichever node
+   the thread that built it ran on, and threads on the other nodes of a
+   multi-socket host look it up remotely.  After galois_set_numa_replicas(1)
+   the table lookups of the single-element, batch and scalar region
+   functions go to a copy of the table on the calling thread's node:  the
+   log/ilog, mult/div and split_w8 tables, of the C functions' fields and of
+   field contexts alike.  Each node's copy is made from the original the
+   first time a thread running there looks the table up, and is kept for
+   as long as the table.  The tables are read-only, so the copies never go
+   stale.  The vectorized region kernels build their small tables per call,
+   on the caller's stack, and need no copies.
+
+   Replicas cost one copy of each table in use per node, so they are off by
+   default; turning them off sends lookups back to the originals.  Threads
+   should be pinned, since a thread's node is only checked every few
+   thousand lookups.  Returns 0, or -1 if the library was built without
+   NUMA support or the system has none. */
+
+unsigned galois_set_numa_replicas(unsigned on);
 
 void galois_region_xor(
     char *r1,         /* Region 1 */
@@ -63,10 +153,45 @@ void galois_region_xor(
     char *r3,         /* Sum region (r3 = r1 ^ r2) -- can be r1 or r2 */
     unsigned nbytes); /* Number of bytes in region */
 
+/* dst = srcs[0] ^ srcs[1] ^ ... ^ srcs[nsrc - 1] over nbytes bytes, in one
+   pass:  each source is read once and dst written once, where chaining
+   galois_region_xor() would pass over dst nsrc - 1 times.  dst may be one
+   of the sources, and is zeroed if nsrc is 0.  The regions need no
+   alignment.
+
+   GALOIS_XOR_STREAM writes dst with non-temporal stores, which bypass the
+   caches.  Use it when dst is bigger than the last-level cache and will
+   not be read again soon (e.g. parity on its way to disk), so that writing
+   it does not evict the data being worked on.  Throws
+   std::invalid_argument for unknown flags. */
+
+enum galois_xor_flags : unsigned {
+    GALOIS_XOR_STREAM = 1
+};
+
+void galois_region_xor_n(const char *const *srcs, unsigned nsrc, char *dst,
+                         unsigned nbytes, unsigned flags);
+
 /* These multiply regions in w=8, w=16 and w=32.  They are much faster
    than calling galois_single_multiply.  The regions must be long word aligned.
+
+   The region multiplies use SIMD kernels when the CPU has them.  The best
+   level is picked when the library is loaded; galois_set_simd_level() lets
+   you force a lower one (e.g. for testing), and returns -1 if the CPU does
+   not support the requested level.  It is not safe to call while other
+   threads are multiplying regions.
  */
 
+enum galois_simd_level : unsigned {
+    GALOIS_SIMD_NONE = 0, /* Portable C++ */
+    GALOIS_SIMD_SSSE3 = 1,
+    GALOIS_SIMD_AVX2 = 2,
+    GALOIS_SIMD_AVX512 = 3 /* AVX-512F + AVX-512BW */
+};
+
+unsigned galois_get_simd_level();
+unsigned galois_set_simd_level(unsigned level);
+
 void galois_w08_region_multiply(
     char *region,    /* Region to multiply */
     unsigned multby, /* Number to multiply by */
@@ -90,3 +215,109 @@ void galois_w32_region_multiply(
     char *r2,        /* If r2 != NULL, products go here.
                         Otherwise region is overwritten */
     unsigned add);   /* If (r2 != NULL && add) the produce is XOR'd with r2 */
+
+/* The altmap layout for w=32 regions.  Each whole 64-byte block of 16 words
+   is stored as byte 0 (the least significant) of all 16 words, then byte
+   1, 2 and 3, which is the order the SIMD kernels work in, so
+   galois_w32_region_multiply_altmap() skips the shuffles that
+   galois_w32_region_multiply() spends moving bytes into place.  Bytes after
+   the last whole block keep the standard layout.  XOR works the same in
+   either layout, so a program can convert its data once, encode or decode
+   with the altmap multiply and galois_region_xor(), and convert back.  The
+   conversions work in place. */
+void galois_w32_region_to_altmap(char *region, unsigned nbytes);
+void galois_w32_region_from_altmap(char *region, unsigned nbytes);
+
+/* As galois_w32_region_multiply(), for regions in the altmap layout. */
+void galois_w32_region_multiply_altmap(char *region, unsigned multby,
+                                       unsigned nbytes, char *r2,
+                                       unsigned add);
+
+/* Parallel versions of the region multiplies.  They give the same results
+   as the plain versions, but split large regions into chunks that are
+   multiplied on a pool of threads.  The pool starts out empty, so these run
+   on the calling thread until galois_set_region_threads() is called with
+   nthreads > 1.  Regions are split into chunks of at least 256 KB, and if
+   another thread is already using the pool, the call runs on the calling
+   thread rather than waiting.
+
+   galois_set_region_threads() returns 0 on success, -1 on failure, and must
+   not be called while a parallel multiply is running.  Table creation is
+   thread-safe, so the plain functions may also be called from any number of
+   threads.  The pool also fills the larger tables:  log tables for w > 16
+   and mult tables for w > 8. */
+
+unsigned galois_set_region_threads(unsigned nthreads);
+unsigned galois_get_region_threads();
+
+void galois_w08_region_multiply_parallel(char *region, unsigned multby,
+                                         unsigned nbytes, char *r2,
+                                         unsigned add);
+void galois_w16_region_multiply_parallel(char *region, unsigned multby,
+                                         unsigned nbytes, char *r2,
+                                         unsigned add);
+void galois_w32_region_multiply_parallel(char *region, unsigned multby,
+                                         unsigned nbytes, char *r2,
+                                         unsigned add);
+
+/* These multiply a matrix by a set of regions in w=8, w=16 and w=32, which
+   is how you encode m parity regions from k data regions:
+
+     dst[i] = sum over j of matrix[i*k+j] * src[j],   for 0 <= i < m
+
+   This is equivalent to k*m calls to galois_wXX_region_multiply (with add
+   set for all but the first source of each output), but the regions are
+   processed in cache-sized blocks, and each block of source data is read
+   from memory once rather than m times.  The dst regions are overwritten,
+   and must not overlap the src regions. */
+
+void galois_w08_matrix_region_multiply(
+    unsigned *matrix, /* m x k coefficients, row-major */
+    unsigned k,       /* Number of source regions */
+    unsigned m,       /* Number of destination regions */
+    char **src,       /* k source regions */
+    char **dst,       /* m destination regions */
+    unsigned nbytes); /* Number of bytes in each region */
+
+void galois_w16_matrix_region_multiply(
+    unsigned *matrix, /* m x k coefficients, row-major */
+    unsigned k,       /* Number of source regions */
+    unsigned m,       /* Number of destination regions */
+    char **src,       /* k source regions */
+    char **dst,       /* m destination regions */
+    unsigned nbytes); /* Number of bytes in each region */
+
+void galois_w32_matrix_region_multiply(
+    unsigned *matrix, /* m x k coefficients, row-major */
+    unsigned k,       /* Number of source regions */
+    unsigned m,       /* Number of destination regions */
+    char **src,       /* k source regions */
+    char **dst,       /* m destination regions */
+    unsigned nbytes); /* Number of bytes in each region */
+
+/* Delta parity updates, for when one data region changes from old_data to
+   new_data and its m parity regions must follow:
+
+     parity[i] ^= coeffs[i] * (old_data ^ new_data),   for 0 <= i < m
+
+   where coeffs[i] is the data region's coefficient in parity row i (its
+   column of the matrix above).  The delta is computed once, a block at a
+   time, and added into every parity region while it is still in cache, so
+   a small write costs one pass over nbytes of data and parity rather than
+   a re-encode of the stripe.  For a write to part of a region, pass
+   pointers and nbytes for just that part, with the same offset in every
+   region.  The regions must not overlap, except that old_data and
+   new_data may be equal (a no-op). */
+
+void galois_w08_region_delta_update(const char *old_data,
+                                    const char *new_data,
+                                    const unsigned *coeffs, unsigned m,
+                                    char **parity, unsigned nbytes);
+void galois_w16_region_delta_update(const char *old_data,
+                                    const char *new_data,
+                                    const unsigned *coeffs, unsigned m,
+                                    char **parity, unsigned nbytes);
+void galois_w32_region_delta_update(const char *old_data,
+                                    const char *new_data,
+                                    const unsigned *coeffs, unsigned m,
+                                    char **parity, unsigned nbytes);
@@ -0,0 +1,68 @@
+/* galois_bitmatrix.h
+ *
+ * Erasure coding with XORs only.  Each element e of an m x k coding matrix
+ * over GF(2^w) is expanded into the w x w binary matrix whose column c holds
+ * the bits of e * 2^c, which turns the code into an (m*w) x (k*w) matrix
+ * over GF(2).  Every block is then cut into w packets, and each parity
+ * packet is the XOR of the data packets picked out by a row of the
+ * bit-matrix.  That works for any w from 1 to 32, and never multiplies.
+ *
+ * The XORs are ordered by a schedule.  Rows are computed greedily, cheapest
+ * first, and a row may start from a parity packet that was computed before
+ * it rather than from scratch, when the two rows differ in fewer bits than
+ * the row has ones.  This is Plank's "smart" scheduling (CSHR), and it
+ * cuts the XOR count of a Cauchy code substantially.
+ *
+ * Blocks are nbytes long, where nbytes is a multiple of w * packetsize,
+ * and are processed w * packetsize bytes at a time.  As in galois_rs.h,
+ * ids 0 .. k-1 are data and k .. k+m-1 parity, encoding may be done by
+ * several threads at once, and decoding by only one thread at a time per
+ * code.  Neither allocates.
+ */
+
+#ifndef GALOIS_BITMATRIX_H
+#define GALOIS_BITMATRIX_H
+
+/* Writes the (m*w) x (k*w) bit-matrix of the m x k matrix over GF(2^w)
+   into bitmatrix, row-major, one 0/1 byte per bit. */
+void galois_matrix_to_bitmatrix(unsigned k, unsigned m, unsigned w,
+                                const unsigned *matrix,
+                                unsigned char *bitmatrix);
+
+/* Writes an m x k Cauchy matrix over GF(2^w) into matrix.  Its rows and
+   columns are scaled to keep the number of ones in the bit-matrix low, which
+   leaves it MDS.  k + m must be at most 2^w.  Returns 0 on success, -1 on
+   bad parameters. */
+unsigned galois_cauchy_good_matrix(unsigned k, unsigned m, unsigned w,
+                                   unsigned *matrix);
+
+struct galois_bitmatrix_code;
+
+/* matrix is the m x k coding matrix; if it is NULL,
+   galois_cauchy_good_matrix() is used.  w may be 1 .. 32.  Throws
+   std::invalid_argument if the parameters are bad. */
+galois_bitmatrix_code *galois_bitmatrix_create(unsigned k, unsigned m,
+                                               unsigned w,
+                                               const unsigned *matrix,
+                                               unsigned packetsize);
+void galois_bitmatrix_free(galois_bitmatrix_code *code);
+
+/* The (m*w) x (k*w) bit-matrix, and the number of packet XORs (copies not
+   counted) that encoding does for every w * packetsize bytes of each
+   block. */
+const unsigned char *galois_bitmatrix_get(const galois_bitmatrix_code *code);
+unsigned galois_bitmatrix_xors(const galois_bitmatrix_code *code);
+
+void galois_bitmatrix_encode(const galois_bitmatrix_code *code,
+                             char **data,   /* k data blocks */
+                             char **parity, /* m parity blocks, overwritten */
+                             unsigned nbytes);
+
+/* Same interface as galois_rs_decode():  blocks has k+m entries by id,
+   out[i] receives block erased[i].  Returns 0 on success, and -1 if nerased
+   > m or erased holds a bad or repeated id. */
+unsigned galois_bitmatrix_decode(galois_bitmatrix_code *code, char **blocks,
+                                 const unsigned *erased, unsigned nerased,
+                                 char **out, unsigned nbytes);
+
+#endif
@@ -0,0 +1,80 @@
+/* galois_ctx.h
+ *
+ * Field contexts.  The functions in galois.h work in one fixed field for
+ * each w, with the polynomials listed in galois.cpp.  A galois_ctx is a
+ * field with a polynomial and multiplication method chosen at run time, so
+ * that a program can work in GF(2^w) as some other format or standard
+ * defines it, or in several such fields at once.
+ *
+ * A context owns its tables, which it builds lazily, the first time an
+ * operation needs them, just as the C functions do.  Any number of threads
+ * may use a context at once, and contexts may be created and freed from
+ * any thread; freeing one must not race with its use.  Contexts made by
+ * galois_ctx_create() never use the table store (galois_store.h), which
+ * only holds the default fields' tables.
+ *
+ *   galois_ctx *f = galois_ctx_create(16, 0x1100b, GALOIS_METHOD_DEFAULT);
+ *   p = galois_ctx_multiply(f, a, b);
+ *   galois_ctx_region_multiply(f, region, p, nbytes, NULL, 0);
+ *   galois_ctx_free(f);
+ *
+ * The C functions are the default contexts:  galois_single_multiply(x, y,
+ * w) is galois_ctx_multiply(galois_default_ctx(w), x, y), and so on.
+ */
+
+#ifndef GALOIS_CTX_H
+#define GALOIS_CTX_H
+
+enum galois_method : unsigned {
+    GALOIS_METHOD_DEFAULT = 0,
+    GALOIS_METHOD_MULTTABLE = 1,
+    GALOIS_METHOD_LOGTABLE = 2,
+    GALOIS_METHOD_SHIFT = 3,
+    GALOIS_METHOD_SPLITW8 = 4,
+    GALOIS_METHOD_CLMUL = 5 /* For GaloisField, needs pclmul enabled at
+                               compile time */
+};
+
+struct galois_ctx;
+
+/* Makes GF(2^w), 1 <= w <= 32, modulo x^w + poly.  poly may be given with
+   or without the x^w bit (for w = 32, without), and must make x a
+   generator of the field, i.e. the polynomial must be primitive.  The
+   method is that of the single-element functions:
+
+     GALOIS_METHOD_DEFAULT    what galois_single_multiply() uses for w
+     GALOIS_METHOD_MULTTABLE  w <= 13
+     GALOIS_METHOD_LOGTABLE   w <= 30
+     GALOIS_METHOD_SHIFT      any w
+     GALOIS_METHOD_SPLITW8    w == 32, carry-less multiply if the CPU has it
+     GALOIS_METHOD_CLMUL      w == 32, the same as SPLITW8
+
+   Region multiplies always use the fastest kernel for w.  Throws
+   std::invalid_argument if w, poly or method is bad. */
+galois_ctx *galois_ctx_create(unsigned w, unsigned poly, unsigned method);
+
+/* Frees ctx and its tables.  NULL and the default contexts are ignored. */
+void galois_ctx_free(galois_ctx *ctx);
+
+/* The field the C functions use for w.  It is never freed.  Throws
+   std::invalid_argument unless 1 <= w <= 32. */
+galois_ctx *galois_default_ctx(unsigned w);
+
+/* Any of the pointers may be NULL.  poly is without the x^w bit, and the
+   method is never GALOIS_METHOD_DEFAULT. */
+void galois_ctx_get_params(const galois_ctx *ctx, unsigned *w, unsigned *poly,
+                           unsigned *method);
+
+/* As galois_single_multiply(), galois_single_divide() and
+   galois_inverse(). */
+unsigned galois_ctx_multiply(galois_ctx *ctx, unsigned x, unsigned y);
+unsigned galois_ctx_divide(galois_ctx *ctx, unsigned a, unsigned b);
+unsigned galois_ctx_inverse(galois_ctx *ctx, unsigned y);
+
+/* As galois_w08/w16/w32_region_multiply(), for w = 8, 16 or 32.  Throws
+   std::invalid_argument for any other w. */
+void galois_ctx_region_multiply(galois_ctx *ctx, char *region,
+                                unsigned multby, unsigned nbytes, char *r2,
+                                unsigned add);
+
+#endif
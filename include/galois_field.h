@@ -0,0 +1,243 @@
+/* galois_field.h
+ *
+ * GaloisField<W, Method> is GF(2^W) as a C++17 type, for code that does
+ * its own arithmetic in inner loops.  W and the method are template
+ * parameters, so each multiply compiles down to the method's table lookup
+ * or shift loop with no w or mult_type dispatch, and inlines into the
+ * caller.  Elements are the narrowest unsigned type that holds W bits.
+ *
+ * The tables are the library's own compact ones, fetched through
+ * galois_get_compact_*_table() when the object is constructed, and kept in
+ * the object with their entry type, which is element, so a field is
+ * cheap to copy and the C functions and every GaloisField of the same W
+ * share one set of tables.  Construction throws std::invalid_argument if
+ * the tables cannot be made.
+ *
+ *   GaloisField<8> gf;
+ *   for (i = 0; i < n; i++)
+ *       out[i] = gf.multiply(a[i], b[i]);
+ *
+ * Method defaults to the one galois_single_multiply() uses for W.  The
+ * default does not depend on compiler flags, so GaloisField<W> is the same
+ * class in every translation unit.  Carry-less multiplication is asked for
+ * by name, e.g. GaloisField<32, GALOIS_METHOD_CLMUL>, and only compiles
+ * where it is enabled (e.g. -mpclmul or -march=native).  The methods are:
+ *
+ *   GALOIS_METHOD_MULTTABLE  W <= 13:  one lookup in a 2^(2W) table
+ *   GALOIS_METHOD_LOGTABLE   W <= 30:  log/antilog lookups
+ *   GALOIS_METHOD_SHIFT      any W:    shift and reduce, no tables
+ *   GALOIS_METHOD_SPLITW8    W == 32:  sixteen lookups in 8-bit split tables
+ *   GALOIS_METHOD_CLMUL      any W:    pclmulqdq and Barrett reduction
+ *
+ * Dividing by zero gives all ones, as galois_single_divide() does.
+ */
+
+#ifndef GALOIS_FIELD_H
+#define GALOIS_FIELD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+#ifdef __PCLMUL__
+#include <immintrin.h>
+#endif
+
+#include "galois.h"
+#include "galois_ctx.h"
+
+/* Whether this translation unit may use GALOIS_METHOD_CLMUL */
+#ifdef __PCLMUL__
+#define GALOIS_HAVE_CLMUL true
+#else
+#define GALOIS_HAVE_CLMUL false
+#endif
+
+/* The multiply of GALOIS_METHOD_CLMUL:  x * y mod x^W + poly, with mu the
+   low W bits of x^(2W) / (x^W + poly).  Everything that depends on pclmul
+   being enabled is in here, so that GaloisField itself reads the same in
+   every translation unit. */
+template <unsigned W>
+struct galois_field_clmul {
+#ifdef __PCLMUL__
+    static constexpr bool available = true;
+
+    static uint32_t multiply(uint32_t x, uint32_t y, uint64_t poly,
+                             uint64_t mu) {
+        __m128i c, h, k, q;
+
+        /* k holds mu in the low quadword and poly in the high one. */
+        k = _mm_set_epi64x((long long)poly, (long long)mu);
+        c = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)x),
+                                 _mm_cvtsi32_si128((int)y), 0x00);
+        h = _mm_srli_epi64(c, W);
+        q = _mm_xor_si128(_mm_srli_epi64(_mm_clmulepi64_si128(h, k, 0x00), W),
+                          h);
+        c = _mm_xor_si128(c, _mm_clmulepi64_si128(q, k, 0x10));
+        return (uint32_t)_mm_cvtsi128_si32(c) & (uint32_t)(~0ull >> (64 - W));
+    }
+#else
+    static constexpr bool available = false;
+
+    static uint32_t multiply(uint32_t, uint32_t, uint64_t, uint64_t);
+#endif
+};
+
+/* The method galois_single_multiply() picks for w.  This must not depend
+   on compiler flags:  GaloisField<W> with the default method is one type
+   across the whole program, so it must have one definition. */
+constexpr galois_method galois_default_method(unsigned w) {
+    return (w <= 9)    ? GALOIS_METHOD_MULTTABLE
+           : (w <= 22) ? GALOIS_METHOD_LOGTABLE
+           : (w <= 31) ? GALOIS_METHOD_SHIFT
+                       : GALOIS_METHOD_SPLITW8;
+}
+
+template <unsigned W, galois_method Method = GALOIS_METHOD_DEFAULT>
+class GaloisField {
+    static_assert(W >= 1 && W <= 32, "W must be 1 .. 32");
+
+  public:
+    static constexpr unsigned width = W;
+    static constexpr galois_method method =
+        (Method == GALOIS_METHOD_DEFAULT) ? galois_default_method(W) : Method;
+
+    static_assert(method != GALOIS_METHOD_MULTTABLE || W <= 13,
+                  "multiplication tables need W <= 13");
+    static_assert(method != GALOIS_METHOD_LOGTABLE || W <= 30,
+                  "log tables need W <= 30");
+    static_assert(method != GALOIS_METHOD_SPLITW8 || W == 32,
+                  "split_w8 tables need W == 32");
+
+    typedef typename std::conditional<
+        (W <= 8), uint8_t,
+        typename std::conditional<(W <= 16), uint16_t, uint32_t>::type>::type
+        element;
+
+    static constexpr element max_element = (element)(~0ull >> (64 - W));
+
+    GaloisField() {
+        unsigned i;
+
+        if constexpr (method == GALOIS_METHOD_CLMUL)
+            static_assert(galois_field_clmul<W>::available,
+                          "GALOIS_METHOD_CLMUL needs pclmul enabled "
+                          "(-mpclmul)");
+        if constexpr (method == GALOIS_METHOD_MULTTABLE) {
+            tables[0] = (const element *)galois_get_compact_mult_table(W);
+            tables[1] = (const element *)galois_get_compact_div_table(W);
+        } else if constexpr (method == GALOIS_METHOD_LOGTABLE) {
+            tables[0] = (const element *)galois_get_compact_log_table(W);
+            tables[1] = (const element *)galois_get_compact_ilog_table(W);
+        } else if constexpr (method == GALOIS_METHOD_SPLITW8) {
+            for (i = 0; i < 7; i++)
+                tables[i] = galois_get_split_w8_table(i);
+        }
+        for (i = 0; i < ntables; i++) {
+            if (tables[i] == NULL)
+                throw std::invalid_argument("cannot make GaloisField tables");
+        }
+        /* x^W reduced, i.e. the primitive polynomial without its top bit. */
+        poly = (element)galois_shift_multiply(1u << (W - 1), 2, W);
+        mu = barrett_mu(poly);
+    }
+
+    static element add(element a, element b) { return a ^ b; }
+
+    element multiply(element a, element b) const {
+        if constexpr (method == GALOIS_METHOD_MULTTABLE)
+            return (element)tables[0][((size_t)a << W) | b];
+        if constexpr (method == GALOIS_METHOD_LOGTABLE) {
+            if (a == 0 || b == 0)
+                return 0;
+            return (element)tables[1][tables[0][a] + tables[0][b]];
+        }
+        if constexpr (method == GALOIS_METHOD_SPLITW8)
+            return (element)split_w8_multiply(a, b);
+        if constexpr (method == GALOIS_METHOD_CLMUL)
+            return (element)galois_field_clmul<W>::multiply(a, b, poly, mu);
+        return shift_multiply(a, b);
+    }
+
+    element divide(element a, element b) const {
+        if constexpr (method == GALOIS_METHOD_MULTTABLE)
+            return (element)tables[1][((size_t)a << W) | b];
+        if (b == 0)
+            return max_element;
+        if (a == 0)
+            return 0;
+        if constexpr (method == GALOIS_METHOD_LOGTABLE)
+            return tables[1][tables[0][a] + max_element - tables[0][b]];
+        return multiply(a, inverse(b));
+    }
+
+    /* Returns all ones for 0.  Without tables, this is the library's
+       inverse:  a couple of multiplies and lookups for W = 32, and the
+       extended Euclidean algorithm for other W. */
+    element inverse(element a) const {
+        if constexpr (method == GALOIS_METHOD_MULTTABLE)
+            return (element)tables[1][((size_t)1 << W) | a];
+        if (a == 0)
+            return max_element;
+        if constexpr (method == GALOIS_METHOD_LOGTABLE)
+            return tables[1][max_element - tables[0][a]];
+        if constexpr (W == 32)
+            return (element)galois_inverse(a, W);
+        return (element)galois_shift_inverse(a, W);
+    }
+
+  private:
+    static constexpr unsigned ntables =
+        (method == GALOIS_METHOD_SPLITW8)     ? 7
+        : (method == GALOIS_METHOD_MULTTABLE) ? 2
+        : (method == GALOIS_METHOD_LOGTABLE)  ? 2
+                                              : 0;
+
+    /* The low W bits of x^(2W) / (x^W + poly), as in galois_barrett_mu(). */
+    static uint64_t barrett_mu(uint64_t poly) {
+        uint64_t rem = 0, quot = 0, full = (1ull << W) | poly;
+        int i;
+
+        for (i = 2 * W; i >= 0; i--) {
+            rem = (rem << 1) | (i == 2 * W);
+            quot <<= 1;
+            if (rem & (1ull << W)) {
+                rem ^= full;
+                quot |= 1;
+            }
+        }
+        return quot & max_element;
+    }
+
+    element shift_multiply(element a, element b) const {
+        element r = 0;
+        unsigned i;
+
+        for (i = 0; i < W; i++) {
+            r ^= (element)(-(element)((b >> i) & 1) & a);
+            a = (element)(((a << 1) & max_element) ^
+                          (-(element)(a >> (W - 1)) & poly));
+        }
+        return r;
+    }
+
+    uint32_t split_w8_multiply(uint32_t x, uint32_t y) const {
+        uint32_t acc = 0;
+        unsigned i, j;
+
+        for (i = 0; i < 4; i++) {
+            for (j = 0; j < 4; j++) {
+                acc ^= tables[i + j][(((x >> (8 * i)) & 255) << 8) |
+                                     ((y >> (8 * j)) & 255)];
+            }
+        }
+        return acc;
+    }
+
+    const element *tables[7] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+    element poly;
+    uint64_t mu;
+};
+
+#endif
@@ -0,0 +1,94 @@
+/* galois_jobs.h
+ *
+ * A job engine for running many independent encodes, decodes and region
+ * multiplies on a fixed set of worker threads.  Each worker has its own
+ * deque of tasks:  it takes its newest task first, and when it runs out it
+ * steals the oldest task of another worker, so a worker held up by a long
+ * job or a table build does not leave the others idle.  Small jobs are
+ * grouped into one task, up to batch_bytes of data, so a worker runs them
+ * back to back with its caches warm.  Each worker keeps its own decoding
+ * scratch, so decode jobs on the same code may run at once, unlike calls
+ * to galois_rs_decode().
+ *
+ *   galois_jobs *e = galois_jobs_create(NULL);
+ *   jobs[i].kind = GALOIS_JOB_ENCODE; jobs[i].code = code; ...
+ *   galois_jobs_submit(e, jobs, n);
+ *   galois_jobs_wait(e);
+ *   galois_jobs_free(e);
+ *
+ * The engine's workers are separate from the pool of the parallel region
+ * multiplies (galois_set_region_threads()); a job that calls one of those
+ * runs it on its own worker if the pool is busy.
+ */
+
+#ifndef GALOIS_JOBS_H
+#define GALOIS_JOBS_H
+
+#include "galois_rs.h"
+
+struct galois_jobs_options {
+    unsigned nthreads;    /* Workers.  0 means one per CPU. */
+    unsigned pin;         /* If set, worker i is pinned to the i-th CPU the
+                             process may run on, wrapping around */
+    unsigned batch_bytes; /* Jobs are grouped into tasks of up to this much
+                             data.  0 means 256 KB, and 1 runs every job as
+                             its own task. */
+};
+
+enum galois_job_kind : unsigned {
+    GALOIS_JOB_ENCODE = 0,         /* galois_rs_encode() */
+    GALOIS_JOB_DECODE = 1,         /* galois_rs_decode() */
+    GALOIS_JOB_REGION_MULTIPLY = 2 /* galois_wXX_region_multiply() */
+};
+
+/* One job.  The fields after kind are the arguments of the function the
+   kind names; the ones the kind does not use are ignored. */
+struct galois_job {
+    unsigned kind;
+
+    galois_rs_code *code;   /* ENCODE, DECODE */
+    char **blocks;          /* ENCODE:  the k data blocks.
+                               DECODE:  the k+m blocks, by id */
+    char **out;             /* ENCODE:  the m parity blocks.
+                               DECODE:  nerased blocks for the erased ids */
+    const unsigned *erased; /* DECODE */
+    unsigned nerased;       /* DECODE */
+
+    char *region;    /* REGION_MULTIPLY, as galois_wXX_region_multiply() */
+    char *r2;
+    unsigned multby;
+    unsigned add;
+    unsigned w; /* 8, 16 or 32 */
+
+    unsigned nbytes; /* All kinds */
+
+    /* Set by the engine before done is called:  0, or -1 if the function
+       returned -1 or threw. */
+    unsigned status;
+
+    /* If not NULL, called on the worker once the job has finished.  It may
+       submit more jobs, but must not call galois_jobs_wait(). */
+    void (*done)(galois_job *job);
+    void *user; /* For the caller */
+};
+
+struct galois_jobs;
+
+/* Starts the workers.  options may be NULL for the defaults.  Throws
+   std::system_error if a thread cannot be started. */
+galois_jobs *galois_jobs_create(const galois_jobs_options *options);
+
+/* Waits for every job submitted so far, then stops the workers. */
+void galois_jobs_free(galois_jobs *engine);
+
+/* Queues jobs[0 .. n-1] and returns at once.  The jobs, and everything
+   they point to, must stay valid until each job's done is called or
+   galois_jobs_wait() returns.  Any thread may submit, including workers
+   from within done. */
+void galois_jobs_submit(galois_jobs *engine, galois_job *jobs, unsigned n);
+
+/* Waits until every job submitted so far has finished, including any that
+   their done callbacks submitted.  Must not be called from a worker. */
+void galois_jobs_wait(galois_jobs *engine);
+
+#endif
@@ -0,0 +1,71 @@
+/* galois_rs.h
+ *
+ * Systematic Reed-Solomon erasure coding on top of the region multiplies in
+ * galois.h.  A code has k data blocks and m parity blocks, all nbytes long,
+ * with ids 0 .. k-1 for the data and k .. k+m-1 for the parity.  Any k of
+ * the k+m blocks are enough to rebuild the rest.
+ *
+ * The code object holds the m x k coding matrix, the multiplication tables
+ * for it, and all the scratch that decoding needs, so galois_rs_encode()
+ * never allocates, and galois_rs_decode() only does when it adds a matrix
+ * (and its tables) to its cache.
+ * Encoding only reads the code and may be done by any number of threads at
+ * once; decoding uses the code's scratch, so a code must only be decoded by
+ * one thread at a time.
+ */
+
+#ifndef GALOIS_RS_H
+#define GALOIS_RS_H
+
+enum galois_rs_matrix_kind : unsigned {
+    /* A (k+m) x k Vandermonde matrix, turned systematic by column
+       operations, as in Plank's RS tutorial. */
+    GALOIS_RS_VANDERMONDE = 0,
+    /* A Cauchy matrix, 1 / (i ^ (m + j)), under an identity. */
+    GALOIS_RS_CAUCHY = 1
+};
+
+struct galois_rs_code;
+
+/* w must be 8, 16 or 32, and k + m must be at most 2^w.  Throws
+   std::invalid_argument if the parameters are bad. */
+galois_rs_code *galois_rs_create(unsigned k, unsigned m, unsigned w,
+                                 unsigned kind);
+void galois_rs_free(galois_rs_code *code);
+
+/* The m x k coding matrix, row-major:  parity block i is the sum over j of
+   matrix[i*k+j] * data block j. */
+const unsigned *galois_rs_get_matrix(const galois_rs_code *code);
+
+/* The k, m and w the code was created with. */
+void galois_rs_get_params(const galois_rs_code *code, unsigned *k,
+                          unsigned *m, unsigned *w);
+
+/* Computes the m parity blocks from the k data blocks.  As with the region
+   multiplies, blocks must be long word aligned, and nbytes a multiple of
+   w/8. */
+void galois_rs_encode(const galois_rs_code *code,
+                      char **data,     /* k data blocks */
+                      char **parity,   /* m parity blocks, overwritten */
+                      unsigned nbytes);
+
+/* Rebuilds the blocks whose ids are listed in erased.  blocks has k+m
+   entries indexed by id; the entries for erased ids are not looked at.
+   out[i] receives block erased[i].  Returns 0 on success, and -1 if
+   nerased > m or erased holds a bad or repeated id.
+
+   When data blocks are lost, the decoding matrix for the erasure pattern is
+   kept in an LRU cache shared by all codes, so a pattern that repeats skips
+   the k x k inversion.  Only a miss allocates.  The cache holds 64 matrices
+   by default; galois_rs_set_cache_size() changes that, and 0 turns caching
+   off. */
+unsigned galois_rs_decode(galois_rs_code *code,
+                          char **blocks,          /* k+m blocks, by id */
+                          const unsigned *erased, /* Ids to rebuild */
+                          unsigned nerased,
+                          char **out,             /* nerased blocks */
+                          unsigned nbytes);
+
+void galois_rs_set_cache_size(unsigned entries);
+
+#endif
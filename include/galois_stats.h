@@ -0,0 +1,72 @@
+/* galois_stats.h
+ *
+ * Counters for what the library is doing:  which w the single-element
+ * functions are called with, how much each region multiply processes, and
+ * what the lazily built tables cost in time and memory.
+ *
+ * The per-call counters are kept per thread, without locks or atomic
+ * read-modify-writes, and summed when a snapshot is taken; counts from
+ * threads that have exited are kept.  They are off until
+ * galois_set_stats(1) is called, and then cost a flag test and an
+ * increment per call.  Building the library with -DGALOIS_STATS=OFF
+ * removes them altogether.  The table counters are always kept, since
+ * tables are built rarely.
+ */
+
+#ifndef GALOIS_STATS_H
+#define GALOIS_STATS_H
+
+/* Table sets, for the table counters. */
+enum galois_stats_table : unsigned {
+    GALOIS_STATS_LOG = 0,      /* log/ilog, galois_create_log_tables() */
+    GALOIS_STATS_MULT = 1,     /* mult/div, galois_create_mult_tables() */
+    GALOIS_STATS_SPLIT_W8 = 2, /* galois_create_split_w8_tables() */
+    GALOIS_STATS_INVERSE = 3,  /* The w = 32 inverse tables */
+    GALOIS_STATS_VIEW = 4,     /* Copies made by galois_get_*_table() */
+    GALOIS_STATS_REPLICA = 5,  /* Per-node copies, galois_set_numa_replicas() */
+    GALOIS_STATS_NTABLES = 6
+};
+
+struct galois_stats {
+    /* Calls by w, whatever the method.  The C functions use mult tables
+       for w <= 9, log tables for 10 <= w <= 22, shifting above that, and
+       carry-less multiplication or split_w8 tables for w = 32, but a field
+       context (galois_ctx.h) may use another method for the same w, and
+       its calls count under its w too.  These also include calls the
+       library makes itself, e.g. while building tables. */
+    unsigned long long single_multiply[33];
+    unsigned long long single_divide[33];
+
+    /* galois_w08/w16/w32/w64/w128_region_multiply, indexed 0 .. 4:  calls
+       that overwrite, calls that add into r2, and bytes multiplied.  The
+       parallel versions count each chunk as a call. */
+    unsigned long long region_overwrite[5];
+    unsigned long long region_add[5];
+    unsigned long long region_bytes[5];
+
+    /* By galois_stats_table:  table sets built, the time spent building
+       them, and the bytes held by the sets that still exist.  Builds, maps
+       and time add up over the life of the process; bytes go down again
+       when galois_ctx_free() frees a context's tables.  A set mapped from
+       the table store (galois_set_table_store()) counts as mapped rather
+       than built.  Tables compiled in with GALOIS_CONSTEXPR_TABLES are not
+       counted. */
+    unsigned long long table_builds[GALOIS_STATS_NTABLES];
+    unsigned long long table_maps[GALOIS_STATS_NTABLES];
+    unsigned long long table_build_ns[GALOIS_STATS_NTABLES];
+    unsigned long long table_bytes[GALOIS_STATS_NTABLES];
+};
+
+/* Turns the per-call counters on (on != 0) or off.  Returns 0, or -1 if
+   the library was built without them. */
+unsigned galois_set_stats(unsigned on);
+
+/* Fills in stats with the totals so far.  Counts from other threads may
+   be a few calls behind. */
+void galois_get_stats(galois_stats *stats);
+
+/* Zeroes the per-call counters.  The table counters are kept.  Calls racing with the reset may or may not
+   be counted. */
+void galois_reset_stats();
+
+#endif
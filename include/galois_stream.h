@@ -0,0 +1,41 @@
+/* galois_stream.h
+ *
+ * Streaming Reed-Solomon encoding of a file into shard files.  The input is
+ * cut into stripes of k * block_size bytes, and stripe s contributes
+ * block_size bytes at offset s * block_size to each of the k + m shards:
+ * data shard j gets bytes j * block_size .. (j+1) * block_size - 1 of the
+ * stripe, and the parity shards get galois_rs_encode() of those k blocks.
+ * The last stripe is padded with zeros, so every shard is
+ * ceil(size / (k * block_size)) * block_size bytes long; the caller keeps
+ * the input size to trim the padding after decoding.
+ *
+ * A reader thread reads stripes into a ring of page-aligned buffers with
+ * pread, the calling thread encodes them, and a writer thread writes the
+ * shards with pwrite, so reading, encoding and writing overlap and the
+ * whole thing runs at the speed of the slowest of the three.  The ring is
+ * set up once and galois_rs_encode() does not allocate, so nothing is
+ * allocated per stripe.
+ */
+
+#ifndef GALOIS_STREAM_H
+#define GALOIS_STREAM_H
+
+#include "galois_rs.h"
+
+struct galois_stream_options {
+    unsigned block_size; /* Bytes per shard per stripe, a multiple of 64.
+                            0 means 1 MB. */
+    unsigned depth;      /* Stripes in flight, at least 2.  0 means 4. */
+};
+
+/* Encodes the file input with code into the k + m files shards[0 .. k+m-1],
+   by id, which are created or truncated.  options may be NULL for the
+   defaults.  Returns 0 on success, and -1 with errno set if a file cannot
+   be opened, read or written; the shards are then incomplete.  Throws
+   std::invalid_argument if the options are bad. */
+unsigned galois_stream_encode_file(const galois_rs_code *code,
+                                   const char *input,
+                                   const char *const *shards,
+                                   const galois_stream_options *options);
+
+#endif
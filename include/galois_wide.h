@@ -0,0 +1,73 @@
+/* galois_wide.h
+ *
+ * GF(2^64) and GF(2^128), whose elements do not fit the unsigned that the
+ * functions in galois.h take.  The fields are
+ *
+ *   GF(2^64):   x^64 + x^4 + x^3 + x + 1
+ *   GF(2^128):  x^128 + x^7 + x^2 + x + 1
+ *
+ * and bit i of an element is the coefficient of x^i.  The GF(2^128)
+ * polynomial is the one GCM's GHASH uses, but GHASH numbers the bits of a
+ * block the other way round, so its blocks have to be bit-reflected to be
+ * hashed with galois_w128_region_mac().
+ *
+ * With carry-less multiply (pclmulqdq) a product costs a handful of
+ * instructions, and with AVX-512 and VPCLMULQDQ the region functions do
+ * four to eight elements per instruction.  Without it they fall back to
+ * 4-bit split tables of the multiplier, and the single multiply to
+ * shifting.
+ */
+
+#ifndef GALOIS_WIDE_H
+#define GALOIS_WIDE_H
+
+/* A GF(2^128) element, as it is laid out in a region. */
+struct galois_w128 {
+    unsigned long long lo; /* Coefficients of x^0 .. x^63 */
+    unsigned long long hi; /* Coefficients of x^64 .. x^127 */
+};
+
+/* Dividing by zero, and the inverse of zero, give all ones, as
+   galois_single_divide() does. */
+unsigned long long galois_w64_multiply(unsigned long long x,
+                                       unsigned long long y);
+unsigned long long galois_w64_divide(unsigned long long a,
+                                     unsigned long long b);
+unsigned long long galois_w64_inverse(unsigned long long y);
+
+galois_w128 galois_w128_multiply(galois_w128 x, galois_w128 y);
+galois_w128 galois_w128_divide(galois_w128 a, galois_w128 b);
+galois_w128 galois_w128_inverse(galois_w128 y);
+
+/* As galois_w32_region_multiply():  the regions hold 8- or 16-byte
+   elements, must be long word aligned, and nbytes is rounded down to a
+   whole number of elements.  With r2 != NULL and add set,
+   r2 += multby * region, which is the multiply-accumulate of erasure
+   coding. */
+void galois_w64_region_multiply(
+    char *region,              /* Region to multiply */
+    unsigned long long multby, /* Number to multiply by */
+    unsigned nbytes,           /* Number of bytes in region */
+    char *r2,                  /* If r2 != NULL, products go here.
+                                  Otherwise region is overwritten */
+    unsigned add); /* If (r2 != NULL && add) the product is XOR'd with r2 */
+
+void galois_w128_region_multiply(char *region, galois_w128 multby,
+                                 unsigned nbytes, char *r2, unsigned add);
+
+/* Polynomial evaluation over the elements x[0 .. n-1] of region, which is
+   the multiply-accumulate of polynomial MACs and checksums:
+
+     acc = (acc + x[i]) * h,   for i = 0 .. n-1
+
+   and returns the final acc.  GHASH is galois_w128_region_mac() with acc
+   starting at zero.  Calls can be chained over consecutive pieces of a
+   message by passing the result of one as the acc of the next.  nbytes is
+   rounded down as above. */
+unsigned long long galois_w64_region_mac(const char *region, unsigned nbytes,
+                                         unsigned long long h,
+                                         unsigned long long acc);
+galois_w128 galois_w128_region_mac(const char *region, unsigned nbytes,
+                                   galois_w128 h, galois_w128 acc);
+
+#endif
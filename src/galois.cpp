@@ -27,12 +27,27 @@ plank@cs.utk.edu
 
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <new>
 #include <stdexcept>
 #include <string>
+#include <vector>
+
+#include <sys/mman.h>
 
 #include "fmt/core.h"
 #include "fmt/format.h"
 #include "galois.h"
+#include "galois_counters.h"
+#include "galois_ctx.h"
+#include "galois_matrix.h"
+#include "galois_numa.h"
+#include "galois_simd.h"
+#include "galois_store.h"
+#include "galois_threads.h"
 
 constexpr unsigned NONE = 10;
 constexpr unsigned TABLE = 11;
@@ -40,7 +55,7 @@ constexpr unsigned SHIFT = 12;
 constexpr unsigned LOGS = 13;
 constexpr unsigned SPLITW8 = 14;
 
-static unsigned prim_poly[33] = {
+static constexpr unsigned prim_poly[33] = {
     0,
     /*  1 */ 1,
     /*  2 */ 07,
@@ -76,39 +91,39 @@ static unsigned prim_poly[33] = {
     /* 32 */ 00020000007}; /* Really 40020000007, but we're omitting the high
                               order bit */
 
-static unsigned mult_type[33] = {NONE,
-                                 /*  1 */ TABLE,
-                                 /*  2 */ TABLE,
-                                 /*  3 */ TABLE,
-                                 /*  4 */ TABLE,
-                                 /*  5 */ TABLE,
-                                 /*  6 */ TABLE,
-                                 /*  7 */ TABLE,
-                                 /*  8 */ TABLE,
-                                 /*  9 */ TABLE,
-                                 /* 10 */ LOGS,
-                                 /* 11 */ LOGS,
-                                 /* 12 */ LOGS,
-                                 /* 13 */ LOGS,
-                                 /* 14 */ LOGS,
-                                 /* 15 */ LOGS,
-                                 /* 16 */ LOGS,
-                                 /* 17 */ LOGS,
-                                 /* 18 */ LOGS,
-                                 /* 19 */ LOGS,
-                                 /* 20 */ LOGS,
-                                 /* 21 */ LOGS,
-                                 /* 22 */ LOGS,
-                                 /* 23 */ SHIFT,
-                                 /* 24 */ SHIFT,
-                                 /* 25 */ SHIFT,
-                                 /* 26 */ SHIFT,
-                                 /* 27 */ SHIFT,
-                                 /* 28 */ SHIFT,
-                                 /* 29 */ SHIFT,
-                                 /* 30 */ SHIFT,
-                                 /* 31 */ SHIFT,
-                                 /* 32 */ SPLITW8};
+static constexpr unsigned mult_type[33] = {NONE,
+                                           /*  1 */ TABLE,
+                                           /*  2 */ TABLE,
+                                           /*  3 */ TABLE,
+                                           /*  4 */ TABLE,
+                                           /*  5 */ TABLE,
+                                           /*  6 */ TABLE,
+                                           /*  7 */ TABLE,
+                                           /*  8 */ TABLE,
+                                           /*  9 */ TABLE,
+                                           /* 10 */ LOGS,
+                                           /* 11 */ LOGS,
+                                           /* 12 */ LOGS,
+                                           /* 13 */ LOGS,
+                                           /* 14 */ LOGS,
+                                           /* 15 */ LOGS,
+                                           /* 16 */ LOGS,
+                                           /* 17 */ LOGS,
+                                           /* 18 */ LOGS,
+                                           /* 19 */ LOGS,
+                                           /* 20 */ LOGS,
+                                           /* 21 */ LOGS,
+                                           /* 22 */ LOGS,
+                                           /* 23 */ SHIFT,
+                                           /* 24 */ SHIFT,
+                                           /* 25 */ SHIFT,
+                                           /* 26 */ SHIFT,
+                                           /* 27 */ SHIFT,
+                                           /* 28 */ SHIFT,
+                                           /* 29 */ SHIFT,
+                                           /* 30 */ SHIFT,
+                                           /* 31 */ SHIFT,
+                                           /* 32 */ SPLITW8};
 
 static unsigned nw[33] = {
     0,         (1 << 1),   (1 << 2),  (1 << 3),  (1 << 4),  (1 << 5),
@@ -152,286 +167,745 @@ static unsigned nwm1[33] = {0,
                             0x7fffffff,
                             0xffffffff};
 
-static unsigned *galois_log_tables[33] = {
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+/* The tables are created lazily, and may be created by any thread.  A table
+   is filled in completely, under galois_table_lock, before its pointer is
+   published with a release store.  Readers load the pointers with acquire
+   semantics, so once a table exists, using it costs one ordinary load and
+   no locking.  When two pointers are published together (log and ilog, mult
+   and div), the one that readers check is stored last.
+
+   Entries are the narrowest unsigned type that holds w bits:  unsigned char
+   for w <= 8, unsigned short for w <= 16 and unsigned above that, so the
+   w = 8 mult/div tables are 64 KB each rather than 256 KB.  ilog holds
+   the powers of the generator for exponents 0 .. 2 (2^w - 1), which is
+   every index that log x + log y and log x + (2^w - 1) - log y can reach,
+   even with log[0] = 2^w - 1.  Every table is allocated with four spare
+   bytes, so that the batch kernels may gather 32 bits at any entry.
+
+   When galois_set_table_store() has named a directory, the create functions
+   first try to map the tables from there, and hand what they build to the
+   store (galois_store.cpp), which may swap the heap copies for mapped ones
+   before they are published. */
+
+static std::recursive_mutex galois_table_lock;
+
+static inline unsigned galois_table_entry(const void *t, unsigned w,
+                                          unsigned long i) {
+    if (w <= 8)
+        return ((const unsigned char *)t)[i];
+    if (w <= 16)
+        return ((const unsigned short *)t)[i];
+    return ((const unsigned *)t)[i];
+}
 
-static unsigned *galois_ilog_tables[33] = {
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+static unsigned long galois_table_bytes(unsigned w, unsigned long n) {
+    return n * ((w <= 8) ? 1 : (w <= 16) ? 2 : 4);
+}
 
-static unsigned *galois_mult_tables[33] = {
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+/* Building a large table is mostly page faults, one per 4 KB page, so
+   tables of 2 MB and up are aligned to 2 MB and advised to use huge pages.
+   This is only advice, and the tables are freed with free() either way. */
 
-static unsigned *galois_div_tables[33] = {
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+#define GALOIS_HUGE_PAGE (1UL << 21)
 
-/* Special case for w = 32 */
+static void *galois_table_alloc(unsigned w, unsigned long n) {
+    unsigned long bytes = galois_table_bytes(w, n) + 4;
+    void *p;
 
-static unsigned *galois_split_w8[7] = {NULL, NULL, NULL, NULL,
-                                       NULL, NULL, NULL};
+    if (bytes < GALOIS_HUGE_PAGE)
+        return malloc(bytes);
+    bytes = (bytes + GALOIS_HUGE_PAGE - 1) & ~(GALOIS_HUGE_PAGE - 1);
+    p = aligned_alloc(GALOIS_HUGE_PAGE, bytes);
+    if (p != NULL)
+        madvise(p, bytes, MADV_HUGEPAGE);
+    return p;
+}
 
-unsigned galois_create_log_tables(unsigned w) {
-    unsigned j, b;
+/* The Barrett constant for carry-less multiplication in w = 32:  the low 32
+   bits of floor(x^64 / (x^32 + poly)).  This is plain polynomial long
+   division, one dividend bit at a time. */
+
+static constexpr unsigned long long galois_barrett_mu(unsigned poly) {
+    unsigned long long full = (1ULL << 32) | poly;
+    unsigned long long rem = 0, quot = 0;
+
+    for (int i = 64; i >= 0; i--) {
+        rem = (rem << 1) | (i == 64);
+        quot = quot << 1;
+        if (rem & (1ULL << 32)) {
+            rem ^= full;
+            quot |= 1;
+        }
+    }
+    return quot & 0xffffffffULL;
+}
+
+struct galois_w32_inverse_tables;
+
+/* Per-node copies of a field's tables, for galois_set_numa_replicas().
+   tables[n][slot] is made on node n the first time a thread there looks
+   the table up, or is the original table itself if the copy could not be
+   made.  Like the tables, the copies are kept until the field is freed. */
+
+enum galois_slot : unsigned {
+    GALOIS_SLOT_LOG,
+    GALOIS_SLOT_ILOG,
+    GALOIS_SLOT_MULT,
+    GALOIS_SLOT_DIV,
+    GALOIS_SLOT_SPLIT_W8, /* Seven slots, one per split_w8 table */
+    GALOIS_NSLOTS = GALOIS_SLOT_SPLIT_W8 + 7
+};
+
+struct galois_replicas {
+    std::atomic<void *> tables[GALOIS_NUMA_NODES][GALOIS_NSLOTS];
+};
+
+/* A field:  w, its polynomial, the method its single multiplies use, and
+   its tables, which are made lazily as described above.  galois_fields[w]
+   are the fields of the C functions, with the polynomials in prim_poly;
+   only their tables go through the table store or are compiled in.  The
+   ones galois_ctx_create() makes own private heap copies. */
+
+struct galois_ctx {
+    unsigned w;
+    unsigned poly;         /* Without the x^w term */
+    unsigned method;       /* TABLE, LOGS, SHIFT or SPLITW8 */
+    unsigned long long mu; /* galois_barrett_mu(poly), for w = 32 */
+    bool shared;           /* One of galois_fields */
+
+    std::atomic<void *> log, ilog, mult, div;
+    std::atomic<unsigned *> split_w8[7]; /* w = 32 only */
+    std::atomic<galois_w32_inverse_tables *> w32_inverse;
+    mutable std::atomic<galois_replicas *> replicas;
+
+    /* By galois_stats_table:  the bytes counted for this field's tables,
+       taken off the counters again when it is freed */
+    mutable std::atomic<unsigned long long> table_bytes[GALOIS_STATS_NTABLES];
+
+    constexpr galois_ctx(unsigned w_, unsigned poly_, unsigned method_,
+                         bool shared_, void *log_ = NULL, void *ilog_ = NULL,
+                         void *mult_ = NULL, void *div_ = NULL)
+        : w(w_), poly(poly_), method(method_),
+          mu((w_ == 32) ? galois_barrett_mu(poly_) : 0), shared(shared_),
+          log(log_), ilog(ilog_), mult(mult_), div(div_), split_w8{},
+          w32_inverse(NULL), replicas(NULL), table_bytes{} {}
+};
+
+static void galois_ctx_count_table(const galois_ctx *ctx, unsigned kind,
+                                   bool mapped, unsigned long long start,
+                                   unsigned long long bytes) {
+    galois_count_table(kind, mapped, start, bytes);
+    ctx->table_bytes[kind].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+static unsigned long galois_slot_bytes(const galois_ctx *ctx, unsigned slot) {
+    unsigned w = ctx->w;
+
+    switch (slot) {
+    case GALOIS_SLOT_LOG:
+        return galois_table_bytes(w, nw[w]);
+    case GALOIS_SLOT_ILOG:
+        return galois_table_bytes(w, 2 * (unsigned long)nwm1[w] + 1);
+    case GALOIS_SLOT_MULT:
+    case GALOIS_SLOT_DIV:
+        return galois_table_bytes(w, (unsigned long)nw[w] * nw[w]);
+    default:
+        return sizeof(unsigned) * (1 << 16);
+    }
+}
+
+/* The copies have the four bytes of padding that galois_table_alloc()
+   gives, zeroed. */
+
+static void *galois_make_replica(const galois_ctx *ctx, unsigned slot,
+                                 void *table, unsigned node) {
+    unsigned long long start;
+    unsigned long bytes;
+    galois_replicas *r;
+    void *p;
+
+    std::lock_guard<std::recursive_mutex> guard(galois_table_lock);
+    r = ctx->replicas.load(std::memory_order_relaxed);
+    if (r == NULL) {
+        r = new (std::nothrow) galois_replicas();
+        if (r == NULL)
+            return table;
+        ctx->replicas.store(r, std::memory_order_release);
+    }
+    p = r->tables[node][slot].load(std::memory_order_relaxed);
+    if (p != NULL)
+        return p;
+
+    start = galois_counters_now();
+    bytes = galois_slot_bytes(ctx, slot);
+    p = galois_numa_alloc(bytes + 4, node);
+    if (p == NULL) {
+        r->tables[node][slot].store(table, std::memory_order_release);
+        return table;
+    }
+    memcpy(p, table, bytes);
+    r->tables[node][slot].store(p, std::memory_order_release);
+    galois_ctx_count_table(ctx, GALOIS_STATS_REPLICA, false, start, bytes + 4);
+    return p;
+}
+
+__attribute__((noinline)) static void *
+galois_local_table_slow(const galois_ctx *ctx, unsigned slot, void *table) {
+    unsigned node = galois_numa_node();
+    galois_replicas *r;
+    void *p;
+
+    if (node >= GALOIS_NUMA_NODES)
+        return table;
+    r = ctx->replicas.load(std::memory_order_acquire);
+    if (r != NULL) {
+        p = r->tables[node][slot].load(std::memory_order_acquire);
+        if (p != NULL)
+            return p;
+    }
+    return galois_make_replica(ctx, slot, table, node);
+}
+
+/* table, which must exist and be ctx's table for slot, or the calling
+   thread's copy of it if replicas are on.  The test is kept off the hot
+   path, since with replicas off it is all this costs. */
+
+static inline void *galois_local_table(const galois_ctx *ctx, unsigned slot,
+                                       void *table) {
+    if (__builtin_expect(galois_numa_enabled.load(std::memory_order_relaxed),
+                         0))
+        return galois_local_table_slow(ctx, slot, table);
+    return table;
+}
+
+#ifdef GALOIS_CONSTEXPR_TABLES
+
+/* Built with GALOIS_CONSTEXPR_TABLES:  the log/ilog tables for w <= 16 and
+   the mult/div tables for w <= 8 are computed by the compiler and live in
+   read-only data.  Their pointers are constant-initialized, so they are
+   usable from process start, and the create functions find them already
+   present.  The const_cast is safe because the library never writes to a
+   table once it is published. */
+
+#include "galois_static_tables.h"
+
+template <unsigned W>
+static constexpr galois_log_data<W> galois_static_log =
+    galois_make_log_data<W>(prim_poly[W]);
+
+template <unsigned W>
+static constexpr galois_mult_data<W> galois_static_mult =
+    galois_make_mult_data<W>(prim_poly[W]);
+
+#define GALOIS_STATIC_LOG(w)                                                   \
+    const_cast<galois_static_entry<w> *>(galois_static_log<w>.log)
+#define GALOIS_STATIC_ILOG(w)                                                  \
+    const_cast<galois_static_entry<w> *>(galois_static_log<w>.ilog)
+#define GALOIS_STATIC_MULT(w)                                                  \
+    const_cast<galois_static_entry<w> *>(galois_static_mult<w>.mult)
+#define GALOIS_STATIC_DIV(w)                                                   \
+    const_cast<galois_static_entry<w> *>(galois_static_mult<w>.div)
+
+#define GALOIS_FIELD_LM(w)                                                     \
+    galois_ctx(w, prim_poly[w], mult_type[w], true, GALOIS_STATIC_LOG(w),      \
+               GALOIS_STATIC_ILOG(w), GALOIS_STATIC_MULT(w),                   \
+               GALOIS_STATIC_DIV(w))
+#define GALOIS_FIELD_L(w)                                                      \
+    galois_ctx(w, prim_poly[w], mult_type[w], true, GALOIS_STATIC_LOG(w),      \
+               GALOIS_STATIC_ILOG(w))
+
+#else
+
+#define GALOIS_FIELD_LM(w) GALOIS_FIELD(w)
+#define GALOIS_FIELD_L(w) GALOIS_FIELD(w)
+
+#endif
+
+#define GALOIS_FIELD(w) galois_ctx(w, prim_poly[w], mult_type[w], true)
+
+/* The fields of the C functions, and of galois_default_ctx(). */
+
+static galois_ctx galois_fields[33] = {
+    GALOIS_FIELD(0),     GALOIS_FIELD_LM(1),  GALOIS_FIELD_LM(2),
+    GALOIS_FIELD_LM(3),  GALOIS_FIELD_LM(4),  GALOIS_FIELD_LM(5),
+    GALOIS_FIELD_LM(6),  GALOIS_FIELD_LM(7),  GALOIS_FIELD_LM(8),
+    GALOIS_FIELD_L(9),   GALOIS_FIELD_L(10),  GALOIS_FIELD_L(11),
+    GALOIS_FIELD_L(12),  GALOIS_FIELD_L(13),  GALOIS_FIELD_L(14),
+    GALOIS_FIELD_L(15),  GALOIS_FIELD_L(16),  GALOIS_FIELD(17),
+    GALOIS_FIELD(18),    GALOIS_FIELD(19),    GALOIS_FIELD(20),
+    GALOIS_FIELD(21),    GALOIS_FIELD(22),    GALOIS_FIELD(23),
+    GALOIS_FIELD(24),    GALOIS_FIELD(25),    GALOIS_FIELD(26),
+    GALOIS_FIELD(27),    GALOIS_FIELD(28),    GALOIS_FIELD(29),
+    GALOIS_FIELD(30),    GALOIS_FIELD(31),    GALOIS_FIELD(32)};
+
+/* The unsigned copies handed out by galois_get_*_table(), built on first
+   use.  They keep the layout those functions have always returned:  ilog
+   points into the middle of three copies of the powers, and the div table
+   holds -1 for y = 0. */
+
+static std::atomic<unsigned *> galois_log_views[33] = {};
+static std::atomic<unsigned *> galois_ilog_views[33] = {};
+static std::atomic<unsigned *> galois_mult_views[33] = {};
+static std::atomic<unsigned *> galois_div_views[33] = {};
+
+/* Shift-and-add:  for each bit of x, add in y times that power of two,
+   doubling y (multiplying it by x, and reducing) as we go. */
+
+static unsigned galois_ctx_shift_multiply(const galois_ctx *ctx, unsigned x,
+                                          unsigned y) {
+    unsigned prod, top, w = ctx->w;
+
+    prod = 0;
+    top = w - 1;
+    for (; x != 0; x >>= 1) {
+        prod ^= y & (0 - (x & 1));
+        y = ((y << 1) ^ (ctx->poly & (0 - (y >> top)))) & nwm1[w];
+    }
+    return prod;
+}
+
+static unsigned galois_ctx_power(const galois_ctx *ctx, unsigned x,
+                                 unsigned long long e) {
+    unsigned r = 1;
+
+    for (; e != 0; e >>= 1) {
+        if (e & 1)
+            r = galois_ctx_shift_multiply(ctx, r, x);
+        x = galois_ctx_shift_multiply(ctx, x, x);
+    }
+    return r;
+}
+
+/* The tables of large fields are filled in chunks of GALOIS_FILL_CHUNK
+   entries, or rows of about that many entries, spread over the region
+   thread pool (galois_set_region_threads()).  Smaller tables are filled on
+   the calling thread. */
+
+#define GALOIS_FILL_CHUNK (1UL << 16)
+
+static unsigned galois_fill_chunks(unsigned long n) {
+    return (n + GALOIS_FILL_CHUNK - 1) / GALOIS_FILL_CHUNK;
+}
+
+/* Walks the powers of x from x^j = b for j in [start, end), writing both
+   copies of ilog as it goes.  Since x generates the field, the chunks of
+   the walk write disjoint entries of log, and can run in parallel, each
+   seeded with its own power of x.  Every nonzero element is written, so
+   only log[0] is left to set.
+
+   The writes to log are scattered over the whole table, so a second walk
+   runs GALOIS_LOG_PREFETCH powers ahead and prefetches them; without it
+   each write waits for the one before to miss. */
+
+#define GALOIS_LOG_PREFETCH 64
+
+template <class T>
+static void galois_fill_log_range(T *log, T *ilog, const galois_ctx *ctx,
+                                  unsigned long start, unsigned long end) {
+    unsigned long j, n = nwm1[ctx->w];
+    unsigned a, b, top = ctx->w - 1, poly = ctx->poly;
+
+    b = (start == 0) ? 1 : galois_ctx_power(ctx, 2, start);
+    a = b;
+    for (j = 0; j < GALOIS_LOG_PREFETCH; j++)
+        a = ((a << 1) ^ (poly & (0 - (a >> top)))) & n;
+    for (j = start; j < end; j++) {
+        __builtin_prefetch(&log[a], 1);
+        log[b] = j;
+        ilog[j] = b;
+        ilog[j + n] = b;
+        a = ((a << 1) ^ (poly & (0 - (a >> top)))) & n;
+        b = ((b << 1) ^ (poly & (0 - (b >> top)))) & n;
+    }
+}
+
+template <class T>
+static void galois_fill_log_tables(T *log, T *ilog, const galois_ctx *ctx) {
+    unsigned long n = nwm1[ctx->w];
+
+    log[0] = n;
+    galois_parallel_for(galois_fill_chunks(n), [&](unsigned i) {
+        unsigned long start = i * GALOIS_FILL_CHUNK;
+        galois_fill_log_range(log, ilog, ctx, start,
+                              std::min(start + GALOIS_FILL_CHUNK, n));
+    });
+    ilog[2 * n] = 1;
+}
+
+static unsigned galois_ctx_create_log_tables(galois_ctx *ctx) {
+    unsigned long long start;
+    unsigned long sizes[2];
+    void *tables[2], *log, *ilog;
+    unsigned w = ctx->w;
 
     if (w > 30)
         return -1;
-    if (galois_log_tables[w] != NULL)
+    if (ctx->log.load(std::memory_order_acquire) != NULL)
+        return 0;
+
+    std::lock_guard<std::recursive_mutex> guard(galois_table_lock);
+    if (ctx->log.load(std::memory_order_relaxed) != NULL)
         return 0;
-    galois_log_tables[w] = (unsigned *)malloc(sizeof(unsigned) * nw[w]);
-    if (galois_log_tables[w] == NULL)
+
+    start = galois_counters_now();
+    sizes[0] = galois_table_bytes(w, nw[w]);
+    sizes[1] = galois_table_bytes(w, 2 * (unsigned long)nwm1[w] + 1);
+    if (ctx->shared &&
+        galois_store_map(GALOIS_STORE_LOG, w, ctx->poly, 2, sizes, tables)) {
+        ctx->ilog.store(tables[1], std::memory_order_release);
+        ctx->log.store(tables[0], std::memory_order_release);
+        galois_ctx_count_table(ctx, GALOIS_STATS_LOG, true, start,
+                               sizes[0] + sizes[1]);
+        return 0;
+    }
+
+    log = galois_table_alloc(w, nw[w]);
+    if (log == NULL)
         return -1;
 
-    galois_ilog_tables[w] = (unsigned *)malloc(sizeof(unsigned) * nw[w] * 3);
-    if (galois_ilog_tables[w] == NULL) {
-        free(galois_log_tables[w]);
-        galois_log_tables[w] = NULL;
+    ilog = galois_table_alloc(w, 2 * (unsigned long)nwm1[w] + 1);
+    if (ilog == NULL) {
+        free(log);
         return -1;
     }
 
-    for (j = 0; j < nw[w]; j++) {
-        galois_log_tables[w][j] = nwm1[w];
-        galois_ilog_tables[w][j] = 0;
+    if (w <= 8) {
+        galois_fill_log_tables((unsigned char *)log, (unsigned char *)ilog,
+                               ctx);
+    } else if (w <= 16) {
+        galois_fill_log_tables((unsigned short *)log, (unsigned short *)ilog,
+                               ctx);
+    } else {
+        galois_fill_log_tables((unsigned *)log, (unsigned *)ilog, ctx);
     }
 
-    b = 1;
-    for (j = 0; j < nwm1[w]; j++) {
-        if (galois_log_tables[w][b] != nwm1[w]) {
-            throw std::logic_error(fmt::format(
-                "Galois_create_log_tables Error: j={}, b={}, B->J[b]={}, "
-                "J->B[j]={} (0{})",
-                j, b, galois_log_tables[w][b], galois_ilog_tables[w][j],
-                (b << 1) ^ prim_poly[w]));
-        }
-        galois_log_tables[w][b] = j;
-        galois_ilog_tables[w][j] = b;
-        b = b << 1;
-        if (b & nw[w])
-            b = (b ^ prim_poly[w]) & nwm1[w];
-    }
-    for (j = 0; j < nwm1[w]; j++) {
-        galois_ilog_tables[w][j + nwm1[w]] = galois_ilog_tables[w][j];
-        galois_ilog_tables[w][j + nwm1[w] * 2] = galois_ilog_tables[w][j];
-    }
-    galois_ilog_tables[w] += nwm1[w];
+    tables[0] = log;
+    tables[1] = ilog;
+    if (ctx->shared)
+        galois_store_offer(GALOIS_STORE_LOG, w, ctx->poly, 2, sizes, tables);
+    ctx->ilog.store(tables[1], std::memory_order_release);
+    ctx->log.store(tables[0], std::memory_order_release);
+    galois_ctx_count_table(ctx, GALOIS_STATS_LOG, false, start,
+                           sizes[0] + sizes[1]);
     return 0;
 }
 
+unsigned galois_create_log_tables(unsigned w) {
+    if (w > 30)
+        return -1;
+    return galois_ctx_create_log_tables(&galois_fields[w]);
+}
+
 unsigned galois_logtable_multiply(unsigned x, unsigned y, unsigned w) {
+    galois_ctx *ctx = &galois_fields[w];
     unsigned sum_j;
+    void *log, *ilog;
 
     if (x == 0 || y == 0)
         return 0;
 
-    sum_j = galois_log_tables[w][x] + galois_log_tables[w][y];
+    log = galois_local_table(ctx, GALOIS_SLOT_LOG,
+                             ctx->log.load(std::memory_order_acquire));
+    ilog = galois_local_table(ctx, GALOIS_SLOT_ILOG,
+                              ctx->ilog.load(std::memory_order_acquire));
+    sum_j = galois_table_entry(log, w, x) + galois_table_entry(log, w, y);
     /* if (sum_j >= nwm1[w]) sum_j -= nwm1[w];    Don't need to do this,
                                      because we replicate the ilog table twice.
      */
-    return galois_ilog_tables[w][sum_j];
+    return galois_table_entry(ilog, w, sum_j);
 }
 
 unsigned galois_logtable_divide(unsigned x, unsigned y, unsigned w) {
+    galois_ctx *ctx = &galois_fields[w];
     unsigned sum_j;
     unsigned z;
+    void *log, *ilog;
 
     if (y == 0)
         return -1;
     if (x == 0)
         return 0;
-    sum_j = galois_log_tables[w][x] - galois_log_tables[w][y];
-    /* if (sum_j < 0) sum_j += nwm1[w];   Don't need to do this, because we
-     * replicate the ilog table twice.   */
-    z = galois_ilog_tables[w][sum_j];
+    log = galois_local_table(ctx, GALOIS_SLOT_LOG,
+                             ctx->log.load(std::memory_order_acquire));
+    ilog = galois_local_table(ctx, GALOIS_SLOT_ILOG,
+                              ctx->ilog.load(std::memory_order_acquire));
+    sum_j = galois_table_entry(log, w, x) + nwm1[w] -
+            galois_table_entry(log, w, y);
+    /* if (sum_j < 0) sum_j += nwm1[w];   Offsetting by nwm1[w] does this,
+     * because we replicate the ilog table twice.   */
+    z = galois_table_entry(ilog, w, sum_j);
     return z;
 }
 
-unsigned galois_create_mult_tables(unsigned w) {
-    unsigned j, x, y, logx;
+/* Row x of the mult table is linear in y, so it is built by doubling:  the
+   products for y in [2^k, 2^(k+1)) are those for y - 2^k plus x * 2^k.
+   Row x of the div table is then row x of the mult table, permuted by the
+   inverses, x / y = x * (1 / y). */
+
+template <class T>
+static void galois_fill_mult_rows(T *mult, T *div, const T *log,
+                                  const T *ilog, const T *inv, unsigned w,
+                                  unsigned xstart, unsigned xend) {
+    unsigned x, y, k, basis;
+    T *mrow, *drow;
+
+    for (x = xstart; x < xend; x++) {
+        mrow = mult + (unsigned long)x * nw[w];
+        drow = div + (unsigned long)x * nw[w];
+        mrow[0] = 0;
+        for (k = 0; k < w; k++) {
+            basis = (x == 0) ? 0 : ilog[log[x] + k];
+            for (y = 0; y < (1u << k); y++)
+                mrow[(1u << k) + y] = mrow[y] ^ basis;
+        }
+        drow[0] = nwm1[w];
+        for (y = 1; y < nw[w]; y++)
+            drow[y] = mrow[inv[y]];
+    }
+}
+
+template <class T>
+static void galois_fill_mult_tables(T *mult, T *div, const T *log,
+                                    const T *ilog, unsigned w) {
+    std::vector<T> inv(nw[w]);
+    unsigned y, rows;
+
+    for (y = 1; y < nw[w]; y++)
+        inv[y] = ilog[nwm1[w] - log[y]];
+
+    rows = std::max(1UL, GALOIS_FILL_CHUNK / nw[w]);
+    galois_parallel_for(galois_fill_chunks((unsigned long)nw[w] * nw[w]),
+                        [&](unsigned i) {
+                            galois_fill_mult_rows(
+                                mult, div, log, ilog, inv.data(), w, i * rows,
+                                std::min((i + 1) * rows, nw[w]));
+                        });
+}
+
+static unsigned galois_ctx_create_mult_tables(galois_ctx *ctx) {
+    unsigned long long start;
+    unsigned long sizes[2];
+    void *tables[2], *mult, *div, *log, *ilog;
+    unsigned w = ctx->w;
 
     if (w >= 14)
         return -1;
 
-    if (galois_mult_tables[w] != NULL)
+    if (ctx->mult.load(std::memory_order_acquire) != NULL)
+        return 0;
+
+    std::lock_guard<std::recursive_mutex> guard(galois_table_lock);
+    if (ctx->mult.load(std::memory_order_relaxed) != NULL)
         return 0;
-    galois_mult_tables[w] =
-        (unsigned *)malloc(sizeof(unsigned) * nw[w] * nw[w]);
-    if (galois_mult_tables[w] == NULL)
-        return -1;
 
-    galois_div_tables[w] = (unsigned *)malloc(sizeof(unsigned) * nw[w] * nw[w]);
-    if (galois_div_tables[w] == NULL) {
-        free(galois_mult_tables[w]);
-        galois_mult_tables[w] = NULL;
+    if (galois_ctx_create_log_tables(ctx) != 0)
         return -1;
+    log = ctx->log.load(std::memory_order_relaxed);
+    ilog = ctx->ilog.load(std::memory_order_relaxed);
+
+    start = galois_counters_now();
+    sizes[0] = sizes[1] = galois_table_bytes(w, (unsigned long)nw[w] * nw[w]);
+    if (ctx->shared &&
+        galois_store_map(GALOIS_STORE_MULT, w, ctx->poly, 2, sizes, tables)) {
+        ctx->div.store(tables[1], std::memory_order_release);
+        ctx->mult.store(tables[0], std::memory_order_release);
+        galois_ctx_count_table(ctx, GALOIS_STATS_MULT, true, start,
+                               2 * sizes[0]);
+        return 0;
     }
-    if (galois_log_tables[w] == NULL) {
-        if (galois_create_log_tables(w) < 0) {
-            free(galois_mult_tables[w]);
-            free(galois_div_tables[w]);
-            galois_mult_tables[w] = NULL;
-            galois_div_tables[w] = NULL;
-            return -1;
-        }
-    }
 
-    /* Set mult/div tables for x = 0 */
-    j = 0;
-    galois_mult_tables[w][j] = 0; /* y = 0 */
-    galois_div_tables[w][j] = -1;
-    j++;
-    for (y = 1; y < nw[w]; y++) { /* y > 0 */
-        galois_mult_tables[w][j] = 0;
-        galois_div_tables[w][j] = 0;
-        j++;
+    mult = galois_table_alloc(w, (unsigned long)nw[w] * nw[w]);
+    if (mult == NULL)
+        return -1;
+
+    div = galois_table_alloc(w, (unsigned long)nw[w] * nw[w]);
+    if (div == NULL) {
+        free(mult);
+        return -1;
     }
 
-    for (x = 1; x < nw[w]; x++) {     /* x > 0 */
-        galois_mult_tables[w][j] = 0; /* y = 0 */
-        galois_div_tables[w][j] = -1;
-        j++;
-        logx = galois_log_tables[w][x];
-        for (y = 1; y < nw[w]; y++) { /* y > 0 */
-            galois_mult_tables[w][j] =
-                galois_ilog_tables[w][logx + galois_log_tables[w][y]];
-            galois_div_tables[w][j] =
-                galois_ilog_tables[w][logx - galois_log_tables[w][y]];
-            j++;
-        }
+    if (w <= 8) {
+        galois_fill_mult_tables((unsigned char *)mult, (unsigned char *)div,
+                                (unsigned char *)log, (unsigned char *)ilog,
+                                w);
+    } else {
+        galois_fill_mult_tables((unsigned short *)mult, (unsigned short *)div,
+                                (unsigned short *)log, (unsigned short *)ilog,
+                                w);
     }
+
+    tables[0] = mult;
+    tables[1] = div;
+    if (ctx->shared)
+        galois_store_offer(GALOIS_STORE_MULT, w, ctx->poly, 2, sizes, tables);
+    ctx->div.store(tables[1], std::memory_order_release);
+    ctx->mult.store(tables[0], std::memory_order_release);
+    galois_ctx_count_table(ctx, GALOIS_STATS_MULT, false, start, 2 * sizes[0]);
     return 0;
 }
 
+unsigned galois_create_mult_tables(unsigned w) {
+    if (w >= 14)
+        return -1;
+    return galois_ctx_create_mult_tables(&galois_fields[w]);
+}
+
+/* Above w = 16 the log tables take megabytes, or gigabytes, and seconds to
+   build, so galois_ilog() only uses them if something else has built them,
+   and otherwise raises x to the power.  galois_log() has no such shortcut:
+   a discrete log needs the tables. */
+
 unsigned galois_ilog(unsigned value, unsigned w) {
-    if (galois_ilog_tables[w] == NULL) {
-        if (galois_create_log_tables(w) < 0) {
-            throw std::invalid_argument("galois_ilog - w is too big");
-        }
-    }
-    return galois_ilog_tables[w][value];
+    if (w > 16 && w <= 30 &&
+        galois_fields[w].ilog.load(std::memory_order_acquire) == NULL)
+        return galois_ctx_power(&galois_fields[w], 2, value % nwm1[w]);
+    if (galois_create_log_tables(w) != 0)
+        throw std::invalid_argument("galois_ilog - w is too big");
+    return galois_table_entry(
+        galois_fields[w].ilog.load(std::memory_order_acquire), w,
+        value % nwm1[w]);
 }
 
 unsigned galois_log(unsigned value, unsigned w) {
-    if (galois_log_tables[w] == NULL) {
-        if (galois_create_log_tables(w) < 0) {
-            throw std::invalid_argument("galois_log - w is too big");
-        }
-    }
-    return galois_log_tables[w][value];
+    if (galois_create_log_tables(w) != 0)
+        throw std::invalid_argument("galois_log - w is too big");
+    return galois_table_entry(
+        galois_fields[w].log.load(std::memory_order_acquire), w, value);
 }
 
 unsigned galois_shift_multiply(unsigned x, unsigned y, unsigned w) {
-    unsigned prod;
-    unsigned i, j, ind;
-    unsigned k;
-    unsigned scratch[33];
-
-    prod = 0;
-    for (i = 0; i < w; i++) {
-        scratch[i] = y;
-        if (y & (1 << (w - 1))) {
-            y = y << 1;
-            y = (y ^ prim_poly[w]) & nwm1[w];
-        } else {
-            y = y << 1;
-        }
-    }
-    for (i = 0; i < w; i++) {
-        ind = (1 << i);
-        if (ind & x) {
-            j = 1;
-            for (k = 0; k < w; k++) {
-                prod = prod ^ (j & scratch[i]);
-                j = (j << 1);
-            }
-        }
-    }
-    return prod;
+    return galois_ctx_shift_multiply(&galois_fields[w], x, y);
 }
 
-unsigned galois_single_multiply(unsigned x, unsigned y, unsigned w) {
+static unsigned galois_ctx_create_split_w8_tables(galois_ctx *ctx);
+static unsigned galois_ctx_split_w8_multiply(const galois_ctx *ctx,
+                                             unsigned x, unsigned y);
+static unsigned galois_ctx_shift_inverse(const galois_ctx *ctx, unsigned y);
+
+unsigned galois_ctx_multiply(galois_ctx *ctx, unsigned x, unsigned y) {
     unsigned sum_j;
     unsigned z;
+    void *table, *log, *ilog;
+    unsigned w = ctx->w;
 
+    GALOIS_COUNT(single_multiply[w], 1);
     if (x == 0 || y == 0)
         return 0;
 
-    if (mult_type[w] == TABLE) {
-        if (galois_mult_tables[w] == NULL) {
-            if (galois_create_mult_tables(w) < 0) {
+    if (ctx->method == TABLE) {
+        table = ctx->mult.load(std::memory_order_acquire);
+        if (table == NULL) {
+            if (galois_ctx_create_mult_tables(ctx) != 0) {
                 throw std::invalid_argument(
                     "cannot make multiplication tables for w");
             }
+            table = ctx->mult.load(std::memory_order_acquire);
         }
-        return galois_mult_tables[w][(x << w) | y];
-    } else if (mult_type[w] == LOGS) {
-        if (galois_log_tables[w] == NULL) {
-            if (galois_create_log_tables(w) < 0) {
+        table = galois_local_table(ctx, GALOIS_SLOT_MULT, table);
+        return galois_table_entry(table, w, (x << w) | y);
+    } else if (ctx->method == LOGS) {
+        log = ctx->log.load(std::memory_order_acquire);
+        if (log == NULL) {
+            if (galois_ctx_create_log_tables(ctx) != 0) {
                 throw std::invalid_argument(
                     fmt::format("Cannot make log tables for w={}", w));
             }
+            log = ctx->log.load(std::memory_order_acquire);
         }
-        sum_j = galois_log_tables[w][x] + galois_log_tables[w][y];
-        z = galois_ilog_tables[w][sum_j];
+        log = galois_local_table(ctx, GALOIS_SLOT_LOG, log);
+        ilog = galois_local_table(ctx, GALOIS_SLOT_ILOG,
+                                  ctx->ilog.load(std::memory_order_relaxed));
+        sum_j = galois_table_entry(log, w, x) + galois_table_entry(log, w, y);
+        z = galois_table_entry(ilog, w, sum_j);
         return z;
-    } else if (mult_type[w] == SPLITW8) {
-        if (galois_split_w8[0] == NULL) {
-            if (galois_create_split_w8_tables() < 0) {
+    } else if (ctx->method == SPLITW8) {
+        if (galois_kernels.w32_multiply != NULL)
+            return galois_kernels.w32_multiply(x, y, ctx->poly, ctx->mu);
+        if (ctx->split_w8[0].load(std::memory_order_acquire) == NULL) {
+            if (galois_ctx_create_split_w8_tables(ctx) != 0) {
                 throw std::invalid_argument(
                     fmt::format("cannot make log split_w8_tables for w={}", w));
             }
         }
-        return galois_split_w8_multiply(x, y);
-    } else if (mult_type[w] == SHIFT) {
-        return galois_shift_multiply(x, y, w);
+        return galois_ctx_split_w8_multiply(ctx, x, y);
+    } else if (ctx->method == SHIFT) {
+        return galois_ctx_shift_multiply(ctx, x, y);
     }
     throw std::invalid_argument(fmt::format("no implementation for w={}", w));
 }
 
+unsigned galois_single_multiply(unsigned x, unsigned y, unsigned w) {
+    if (w > 32)
+        throw std::invalid_argument(
+            fmt::format("no implementation for w={}", w));
+    return galois_ctx_multiply(&galois_fields[w], x, y);
+}
+
 unsigned galois_multtable_multiply(unsigned x, unsigned y, unsigned w) {
-    return galois_mult_tables[w][(x << w) | y];
+    galois_ctx *ctx = &galois_fields[w];
+
+    return galois_table_entry(
+        galois_local_table(ctx, GALOIS_SLOT_MULT,
+                           ctx->mult.load(std::memory_order_acquire)),
+        w, (x << w) | y);
 }
 
-unsigned galois_single_divide(unsigned a, unsigned b, unsigned w) {
+unsigned galois_ctx_divide(galois_ctx *ctx, unsigned a, unsigned b) {
     unsigned sum_j;
+    void *table, *log, *ilog;
+    unsigned w = ctx->w;
 
-    if (mult_type[w] == TABLE) {
-        if (galois_div_tables[w] == NULL) {
-            if (galois_create_mult_tables(w) < 0) {
+    GALOIS_COUNT(single_divide[w], 1);
+    if (ctx->method == TABLE) {
+        if (b == 0)
+            return -1;
+        table = ctx->div.load(std::memory_order_acquire);
+        if (table == NULL) {
+            if (galois_ctx_create_mult_tables(ctx) != 0) {
                 throw std::invalid_argument(fmt::format(
                     "Cannot make multiplication tables for w={}", w));
             }
+            table = ctx->div.load(std::memory_order_acquire);
         }
-        return galois_div_tables[w][(a << w) | b];
-    } else if (mult_type[w] == LOGS) {
+        table = galois_local_table(ctx, GALOIS_SLOT_DIV, table);
+        return galois_table_entry(table, w, (a << w) | b);
+    } else if (ctx->method == LOGS) {
         if (b == 0)
             return -1;
         if (a == 0)
             return 0;
-        if (galois_log_tables[w] == NULL) {
-            if (galois_create_log_tables(w) < 0) {
-                std::logic_error(
+        log = ctx->log.load(std::memory_order_acquire);
+        if (log == NULL) {
+            if (galois_ctx_create_log_tables(ctx) != 0) {
+                throw std::logic_error(
                     fmt::format("Cannot make log tables for w={}", w));
             }
+            log = ctx->log.load(std::memory_order_acquire);
         }
-        sum_j = galois_log_tables[w][a] - galois_log_tables[w][b];
-        return galois_ilog_tables[w][sum_j];
+        log = galois_local_table(ctx, GALOIS_SLOT_LOG, log);
+        ilog = galois_local_table(ctx, GALOIS_SLOT_ILOG,
+                                  ctx->ilog.load(std::memory_order_relaxed));
+        sum_j = galois_table_entry(log, w, a) + nwm1[w] -
+                galois_table_entry(log, w, b);
+        return galois_table_entry(ilog, w, sum_j);
     } else {
         if (b == 0)
             return -1;
         if (a == 0)
             return 0;
-        sum_j = galois_inverse(b, w);
-        return galois_single_multiply(a, sum_j, w);
+        sum_j = galois_ctx_inverse(ctx, b);
+        return galois_ctx_multiply(ctx, a, sum_j);
     }
     std::logic_error(fmt::format("No implementation for w={}", w));
 }
 
+unsigned galois_single_divide(unsigned a, unsigned b, unsigned w) {
+    if (w > 32)
+        throw std::invalid_argument(
+            fmt::format("no implementation for w={}", w));
+    return galois_ctx_divide(&galois_fields[w], a, b);
+}
+
 unsigned galois_shift_divide(unsigned a, unsigned b, unsigned w) {
     unsigned inverse;
 
@@ -444,21 +918,53 @@ unsigned galois_shift_divide(unsigned a, unsigned b, unsigned w) {
 }
 
 unsigned galois_multtable_divide(unsigned x, unsigned y, unsigned w) {
-    return galois_div_tables[w][(x << w) | y];
+    galois_ctx *ctx = &galois_fields[w];
+
+    if (y == 0)
+        return -1;
+    return galois_table_entry(
+        galois_local_table(ctx, GALOIS_SLOT_DIV,
+                           ctx->div.load(std::memory_order_acquire)),
+        w, (x << w) | y);
 }
 
-void galois_w08_region_multiply(char *region,    /* Region to multiply */
-                                unsigned multby, /* Number to multiply by */
-                                unsigned nbytes, /* Number of bytes in region */
-                                char *r2, /* If r2 != NULL, products go here */
-                                unsigned add) {
-    unsigned char *ur1, *ur2, *cp;
-    unsigned char prod;
-    unsigned i, srow, j;
-    unsigned long l, *lp2;
-    unsigned char *lp;
-    unsigned sol;
+/* Builds the nibble tables for the w = 8, 16 and 32 region kernels (see
+   galois_simd.h):  for nibble k of the source, byte b of multby * (n << 4k)
+   goes in tables[16 (w / 8) k + 16 b + n].  Every entry is an XOR of
+   multby * x^i for some i < w, so this only needs w shifts of multby, and
+   never touches the log or mult tables. */
+
+static void galois_split_tables(const galois_ctx *ctx, unsigned multby,
+                                unsigned char *tables) {
+    unsigned basis[32], prod[16];
+    unsigned i, k, b, n, w = ctx->w;
+
+    for (i = 0; i < w; i++) {
+        basis[i] = multby;
+        multby = ((multby << 1) ^ (ctx->poly & (0 - (multby >> (w - 1))))) &
+                 nwm1[w];
+    }
+    for (k = 0; k < w / 4; k++) {
+        prod[0] = 0;
+        for (b = 0; b < 4; b++) {
+            for (n = (1 << b); n < (2u << b); n++)
+                prod[n] = prod[n ^ (1 << b)] ^ basis[4 * k + b];
+        }
+        for (b = 0; b < w / 8; b++) {
+            for (n = 0; n < 16; n++)
+                tables[2 * w * k + 16 * b + n] = prod[n] >> (8 * b);
+        }
+    }
+}
 
+static void galois_ctx_w08_region_multiply(const galois_ctx *ctx,
+                                           char *region, unsigned multby,
+                                           unsigned nbytes, char *r2,
+                                           unsigned add) {
+    unsigned char *ur1, *ur2;
+    unsigned char tables[32];
+
+    GALOIS_COUNT_REGION(0, nbytes, r2 != NULL && add);
     ur1 = (unsigned char *)region;
     ur2 = (r2 == NULL) ? ur1 : (unsigned char *)r2;
 
@@ -471,46 +977,32 @@ void galois_w08_region_multiply(char *region,    /* Region to multiply */
       }
      */
 
-    if (galois_mult_tables[8] == NULL) {
-        if (galois_create_mult_tables(8) < 0) {
-            std::logic_error("Could not make multiplication tables");
-        }
-    }
-    srow = multby * nw[8];
-    if (r2 == NULL || !add) {
-        for (i = 0; i < nbytes; i++) {
-            prod = galois_mult_tables[8][srow + ur1[i]];
-            ur2[i] = prod;
-        }
-    } else {
-        sol = sizeof(long);
-        lp2 = &l;
-        lp = (unsigned char *)lp2;
-        for (i = 0; i < nbytes; i += sol) {
-            cp = ur2 + i;
-            lp2 = (unsigned long *)cp;
-            for (j = 0; j < sol; j++) {
-                prod = galois_mult_tables[8][srow + ur1[i + j]];
-                lp[j] = prod;
-            }
-            *lp2 = (*lp2) ^ l;
-        }
-    }
-    return;
+    galois_split_tables(ctx, multby, tables);
+    galois_kernels.w08(ur1, ur2, nbytes, tables, (r2 != NULL && add));
 }
 
-void galois_w16_region_multiply(char *region,    /* Region to multiply */
+void galois_w08_region_multiply(char *region,    /* Region to multiply */
                                 unsigned multby, /* Number to multiply by */
                                 unsigned nbytes, /* Number of bytes in region */
                                 char *r2, /* If r2 != NULL, products go here */
                                 unsigned add) {
+    galois_ctx_w08_region_multiply(&galois_fields[8], region, multby, nbytes,
+                                   r2, add);
+}
+
+static void galois_ctx_w16_region_multiply(galois_ctx *ctx, char *region,
+                                           unsigned multby, unsigned nbytes,
+                                           char *r2, unsigned add) {
     unsigned short *ur1, *ur2, *cp;
     unsigned prod;
     unsigned i, log1, j, log2;
-    unsigned long l, *lp2, *lptop;
+    unsigned long l, dl, *lp2;
     unsigned short *lp;
     unsigned sol;
+    unsigned char tables[128];
+    unsigned short *log, *ilog;
 
+    GALOIS_COUNT_REGION(1, nbytes, r2 != NULL && add);
     ur1 = (unsigned short *)region;
     ur2 = (r2 == NULL) ? ur1 : (unsigned short *)r2;
     nbytes /= 2;
@@ -527,57 +1019,75 @@ void galois_w16_region_multiply(char *region,    /* Region to multiply */
       return;
       */
 
+    /* The product is 0:  nothing to add, or zeros to write */
     if (multby == 0) {
-        if (!add) {
-            lp2 = (unsigned long *)ur2;
-            ur2 += nbytes;
-            lptop = (unsigned long *)ur2;
-            while (lp2 < lptop) {
-                *lp2 = 0;
-                lp2++;
-            }
-        }
+        if (r2 == NULL || !add)
+            memset(ur2, 0, nbytes * 2);
         return;
     }
 
-    if (galois_log_tables[16] == NULL) {
-        if (galois_create_log_tables(16) < 0) {
-            std::logic_error("Could not make log tables");
-        }
+    /* Branch-free split tables when the CPU has byte shuffles.  The log
+       tables below are the scalar fallback. */
+    if (galois_kernels.w16 != NULL) {
+        galois_split_tables(ctx, multby, tables);
+        galois_kernels.w16(ur1, ur2, nbytes, tables, (r2 != NULL && add));
+        return;
     }
-    log1 = galois_log_tables[16][multby];
+
+    if (galois_ctx_create_log_tables(ctx) != 0)
+        throw std::logic_error("Could not make log tables");
+    log = (unsigned short *)galois_local_table(
+        ctx, GALOIS_SLOT_LOG, ctx->log.load(std::memory_order_acquire));
+    ilog = (unsigned short *)galois_local_table(
+        ctx, GALOIS_SLOT_ILOG, ctx->ilog.load(std::memory_order_relaxed));
+    log1 = log[multby];
 
     if (r2 == NULL || !add) {
         for (i = 0; i < nbytes; i++) {
             if (ur1[i] == 0) {
                 ur2[i] = 0;
             } else {
-                prod = galois_log_tables[16][ur1[i]] + log1;
-                ur2[i] = galois_ilog_tables[16][prod];
+                prod = log[ur1[i]] + log1;
+                ur2[i] = ilog[prod];
             }
         }
     } else {
         sol = sizeof(long) / 2;
         lp2 = &l;
         lp = (unsigned short *)lp2;
-        for (i = 0; i < nbytes; i += sol) {
+        for (i = 0; i + sol <= nbytes; i += sol) {
             cp = ur2 + i;
-            lp2 = (unsigned long *)cp;
             for (j = 0; j < sol; j++) {
                 if (ur1[i + j] == 0) {
                     lp[j] = 0;
                 } else {
-                    log2 = galois_log_tables[16][ur1[i + j]];
+                    log2 = log[ur1[i + j]];
                     prod = log2 + log1;
-                    lp[j] = galois_ilog_tables[16][prod];
+                    lp[j] = ilog[prod];
                 }
             }
-            *lp2 = (*lp2) ^ l;
+            memcpy(&dl, cp, sizeof(long));
+            dl ^= l;
+            memcpy(cp, &dl, sizeof(long));
         }
+
+        /* Words past the last whole long word */
+        for (; i < nbytes; i++)
+            if (ur1[i] != 0)
+                ur2[i] ^= ilog[log[ur1[i]] + log1];
     }
     return;
 }
 
+void galois_w16_region_multiply(char *region,    /* Region to multiply */
+                                unsigned multby, /* Number to multiply by */
+                                unsigned nbytes, /* Number of bytes in region */
+                                char *r2, /* If r2 != NULL, products go here */
+                                unsigned add) {
+    galois_ctx_w16_region_multiply(&galois_fields[16], region, multby,
+                                   nbytes, r2, add);
+}
+
 /* This will destroy mat, by the way */
 
 void galois_invert_binary_matrix(unsigned *mat, unsigned *inv, unsigned rows) {
@@ -622,7 +1132,7 @@ void galois_invert_binary_matrix(unsigned *mat, unsigned *inv, unsigned rows) {
     /* Now the matrix is upper triangular.  Start at the top and multiply down
      */
 
-    for (i = rows - 1; i >= 0; i--) {
+    for (i = rows - 1; i > 0; i--) {
         for (j = 0; j < i; j++) {
             if (mat[j] & (1 << i)) {
                 /*        mat[j] ^= mat[i]; */
@@ -632,70 +1142,435 @@ void galois_invert_binary_matrix(unsigned *mat, unsigned *inv, unsigned rows) {
     }
 }
 
-unsigned galois_inverse(unsigned y, unsigned w) {
+/* Inversion of a rows x rows matrix over GF(2^w) by Gauss-Jordan
+   elimination.  The row operations are region multiplies on packed rows of
+   w-bit elements:  for w = 32 the unsigned rows already are such rows, and
+   for w = 8 and w = 16 they are packed in place, since a packed row never
+   reaches past the start of the unsigned row it comes from.  The inverse is
+   unpacked from the back for the same reason.  Other values of w use the
+   same elimination one element at a time.  Nothing is allocated. */
 
-    if (y == 0)
-        return -1;
-    if (mult_type[w] == SHIFT || mult_type[w] == SPLITW8)
-        return galois_shift_inverse(y, w);
-    return galois_single_divide(1, y, w);
+template <typename T>
+static inline unsigned galois_elt(const char *p, unsigned i) {
+    T v;
+
+    memcpy(&v, p + i * sizeof(T), sizeof(T));
+    return v;
 }
 
-unsigned galois_shift_inverse(unsigned y, unsigned w) {
-    unsigned mat[1024], mat2[32];
-    unsigned inv[1024], inv2[32];
-    unsigned ind, i, j, k, prod;
+template <typename T>
+static inline void galois_set_elt(char *p, unsigned i, unsigned v) {
+    T t = v;
 
-    for (i = 0; i < w; i++) {
-        mat2[i] = y;
+    memcpy(p + i * sizeof(T), &t, sizeof(T));
+}
 
-        if (y & nw[w - 1]) {
-            y = y << 1;
-            y = (y ^ prim_poly[w]) & nwm1[w];
-        } else {
-            y = y << 1;
+/* rowop(src, multby, count, dst, add) multiplies count elements of src by
+   multby, into dst, or in place if dst is NULL. */
+
+template <typename T, typename F>
+static unsigned galois_gauss_jordan(char *a, char *b, unsigned n, unsigned w,
+                                    F rowop) {
+    unsigned i, j, p;
+
+    for (i = 0; i < n; i++)
+        for (j = 0; j < n; j++)
+            galois_set_elt<T>(b, i * n + j, (i == j));
+
+    for (i = 0; i < n; i++) {
+
+        /* Find a non-zero pivot in column i, and swap its row up */
+
+        for (j = i; j < n && galois_elt<T>(a, j * n + i) == 0; j++)
+            ;
+        if (j == n)
+            return -1;
+        if (j != i) {
+            std::swap_ranges(a + i * n * sizeof(T), a + (i + 1) * n * sizeof(T),
+                             a + j * n * sizeof(T));
+            std::swap_ranges(b + i * n * sizeof(T), b + (i + 1) * n * sizeof(T),
+                             b + j * n * sizeof(T));
         }
+
+        /* Scale the pivot to one.  Columns before i are already zero in row
+           i, so only the rest of the row is multiplied. */
+
+        p = galois_elt<T>(a, i * n + i);
+        if (p != 1) {
+            p = galois_inverse(p, w);
+            rowop(a + (i * n + i) * sizeof(T), p, n - i, NULL, 0);
+            rowop(b + i * n * sizeof(T), p, n, NULL, 0);
+        }
+
+        /* Clear column i from the other rows */
+
+        for (j = 0; j < n; j++) {
+            p = galois_elt<T>(a, j * n + i);
+            if (j == i || p == 0)
+                continue;
+            rowop(a + (i * n + i) * sizeof(T), p, n - i,
+                  a + (j * n + i) * sizeof(T), 1);
+            rowop(b + i * n * sizeof(T), p, n, b + j * n * sizeof(T), 1);
+        }
+    }
+    return 0;
+}
+
+template <typename T, typename F>
+static unsigned galois_invert_packed(unsigned *mat, unsigned *inv,
+                                     unsigned rows, unsigned w, F rowop) {
+    char *a = (char *)mat, *b = (char *)inv;
+    unsigned i, n;
+
+    n = rows * rows;
+    for (i = 0; i < n; i++)
+        galois_set_elt<T>(a, i, mat[i]);
+    if (galois_gauss_jordan<T>(a, b, rows, w, rowop) != 0)
+        return -1;
+    for (i = n; i-- > 0;)
+        inv[i] = galois_elt<T>(b, i);
+    return 0;
+}
+
+unsigned galois_invert_matrix(unsigned *mat, unsigned *inv, unsigned rows,
+                              unsigned w) {
+    if (w == 0 || w > 32)
+        return -1;
+
+    if (w == 8) {
+        return galois_invert_packed<unsigned char>(
+            mat, inv, rows, w,
+            [](char *src, unsigned multby, unsigned count, char *dst,
+               unsigned add) {
+                galois_w08_region_multiply(src, multby, count, dst, add);
+            });
     }
+    if (w == 16) {
+        return galois_invert_packed<unsigned short>(
+            mat, inv, rows, w,
+            [](char *src, unsigned multby, unsigned count, char *dst,
+               unsigned add) {
+                galois_w16_region_multiply(src, multby, count * 2, dst, add);
+            });
+    }
+    if (w == 32) {
+        return galois_gauss_jordan<unsigned>(
+            (char *)mat, (char *)inv, rows, w,
+            [](char *src, unsigned multby, unsigned count, char *dst,
+               unsigned add) {
+                galois_w32_region_multiply(src, multby, count * 4, dst, add);
+            });
+    }
+    return galois_gauss_jordan<unsigned>(
+        (char *)mat, (char *)inv, rows, w,
+        [w](char *src, unsigned multby, unsigned count, char *dst,
+            unsigned add) {
+            unsigned *s = (unsigned *)src;
+            unsigned *d = (dst == NULL) ? s : (unsigned *)dst;
+            unsigned i, prod;
+
+            for (i = 0; i < count; i++) {
+                prod = galois_single_multiply(s[i], multby, w);
+                d[i] = (add) ? (d[i] ^ prod) : prod;
+            }
+        });
+}
 
-    galois_invert_binary_matrix(mat2, inv2, w);
+/* Inverses for w = 32.  GF(2^32) holds GF(2^16) as the elements with
+   x^(2^16) = x, and for any a the norm N = a * a^(2^16) = a^(2^16 + 1) is
+   one of them, so 1 / a = a^(2^16) / N:  two multiplies, plus an inverse
+   in a field small enough to tabulate.  Squaring is linear over GF(2), so
+   a^(2^16) is the XOR of four lookups, one per byte of a.  The subfield
+   table is indexed by 16 bits that tell the subfield elements apart,
+   gathered with four more lookups. */
+
+struct galois_w32_inverse_tables {
+    unsigned frob[4][256];       /* (b << 8k)^(2^16) */
+    unsigned short pick[4][256]; /* The index bits of b << 8k */
+    unsigned inv[1 << 16];       /* 1 / N, indexed by N's index bits */
+};
+
+static inline unsigned
+galois_w32_inverse_lookup(const unsigned short (*t)[256], unsigned x) {
+    return t[0][x & 0xff] ^ t[1][(x >> 8) & 0xff] ^ t[2][(x >> 16) & 0xff] ^
+           t[3][x >> 24];
+}
 
-    return inv2[0];
+static inline unsigned galois_w32_inverse_lookup(const unsigned (*t)[256],
+                                                 unsigned x) {
+    return t[0][x & 0xff] ^ t[1][(x >> 8) & 0xff] ^ t[2][(x >> 16) & 0xff] ^
+           t[3][x >> 24];
 }
 
-unsigned *galois_get_mult_table(unsigned w) {
-    if (galois_mult_tables[w] == NULL) {
-        if (galois_create_mult_tables(w)) {
-            return NULL;
+static galois_w32_inverse_tables *
+galois_create_w32_inverse_tables(galois_ctx *ctx) {
+    galois_w32_inverse_tables *t;
+    unsigned long long start;
+    unsigned basis[32], beta, x, i, j, k, n;
+    std::vector<unsigned> sub;
+
+    t = ctx->w32_inverse.load(std::memory_order_acquire);
+    if (t != NULL)
+        return t;
+
+    std::lock_guard<std::recursive_mutex> guard(galois_table_lock);
+    t = ctx->w32_inverse.load(std::memory_order_relaxed);
+    if (t != NULL)
+        return t;
+
+    start = galois_counters_now();
+    t = (galois_w32_inverse_tables *)malloc(sizeof(*t));
+    if (t == NULL)
+        return NULL;
+
+    for (k = 0; k < 4; k++) {
+        for (i = 0; i < 256; i++) {
+            x = i << (8 * k);
+            for (j = 0; j < 16; j++)
+                x = galois_ctx_multiply(ctx, x, x);
+            t->frob[k][i] = x;
         }
     }
-    return galois_mult_tables[w];
-}
 
-unsigned *galois_get_div_table(unsigned w) {
-    if (galois_mult_tables[w] == NULL) {
-        if (galois_create_mult_tables(w)) {
-            return NULL;
+    /* x is primitive, so beta = 2^(2^16 + 1) generates the multiplicative
+       group of the subfield, which is beta^0 .. beta^65534 and zero. */
+    beta = 2;
+    for (j = 0; j < 16; j++)
+        beta = galois_ctx_multiply(ctx, beta, beta);
+    beta = galois_ctx_multiply(ctx, beta, 2);
+    sub.resize(65535);
+    sub[0] = 1;
+    for (i = 1; i < 65535; i++)
+        sub[i] = galois_ctx_multiply(ctx, sub[i - 1], beta);
+
+    /* beta^0 .. beta^15 are a basis of the subfield.  Reduced so that each
+       vector has a different leading bit, a nonzero combination always
+       has the highest of its vectors' leading bits set, so those 16 bits
+       are enough to tell subfield elements apart. */
+    memset(basis, 0, sizeof(basis));
+    for (i = 0; i < 16; i++) {
+        x = sub[i];
+        while (x != 0 && basis[31 - __builtin_clz(x)] != 0)
+            x ^= basis[31 - __builtin_clz(x)];
+        if (x == 0) {
+            free(t);
+            throw std::logic_error("galois_w32_inverse: bad subfield basis");
         }
+        basis[31 - __builtin_clz(x)] = x;
     }
-    return galois_div_tables[w];
+
+    for (k = 0; k < 4; k++) {
+        for (i = 0; i < 256; i++) {
+            x = i << (8 * k);
+            t->pick[k][i] = 0;
+            for (n = 0, j = 0; j < 32; j++) {
+                if (basis[j] == 0)
+                    continue;
+                if (x & (1u << j))
+                    t->pick[k][i] |= 1 << n;
+                n++;
+            }
+        }
+    }
+
+    t->inv[0] = 0;
+    for (i = 0; i < 65535; i++) {
+        x = galois_w32_inverse_lookup(t->pick, sub[i]);
+        t->inv[x] = sub[(65535 - i) % 65535];
+    }
+
+    ctx->w32_inverse.store(t, std::memory_order_release);
+    galois_ctx_count_table(ctx, GALOIS_STATS_INVERSE, false, start, sizeof(*t));
+    return t;
 }
 
-unsigned *galois_get_log_table(unsigned w) {
-    if (galois_log_tables[w] == NULL) {
-        if (galois_create_log_tables(w)) {
-            return NULL;
+unsigned galois_ctx_inverse(galois_ctx *ctx, unsigned y) {
+    galois_w32_inverse_tables *t;
+    unsigned f, n;
+
+    if (y == 0)
+        return -1;
+    if (ctx->w == 32) {
+        t = galois_create_w32_inverse_tables(ctx);
+        if (t != NULL) {
+            f = galois_w32_inverse_lookup(t->frob, y);
+            n = galois_ctx_multiply(ctx, y, f);
+            n = t->inv[galois_w32_inverse_lookup(t->pick, n)];
+            return galois_ctx_multiply(ctx, f, n);
         }
     }
-    return galois_log_tables[w];
+    if (ctx->method == SHIFT || ctx->method == SPLITW8)
+        return galois_ctx_shift_inverse(ctx, y);
+    return galois_ctx_divide(ctx, 1, y);
 }
 
-unsigned *galois_get_ilog_table(unsigned w) {
-    if (galois_ilog_tables[w] == NULL) {
-        if (galois_create_log_tables(w)) {
-            return NULL;
+unsigned galois_inverse(unsigned y, unsigned w) {
+    if (w > 32)
+        throw std::invalid_argument(
+            fmt::format("no implementation for w={}", w));
+    return galois_ctx_inverse(&galois_fields[w], y);
+}
+
+/* The binary extended Euclidean algorithm on polynomials over GF(2).  It
+   keeps g1 * y = u and g2 * y = v (mod the field polynomial), starting
+   from u = y and v = the polynomial itself, and cancels the top bit of
+   whichever of u and v has the higher degree with a shifted copy of the
+   other, until u = 1 and g1 is the inverse.  Each step lowers the degree
+   of u or v by at least one, so there are at most 2w steps, each a few
+   shifts and XORs, where building and inverting a w x w bit matrix cost
+   O(w^2). */
+
+static unsigned galois_ctx_shift_inverse(const galois_ctx *ctx, unsigned y) {
+    unsigned long long u, v, g1, g2, t;
+    int shift;
+
+    if (y == 0)
+        return -1;
+
+    u = y;
+    v = (1ULL << ctx->w) | ctx->poly;
+    g1 = 1;
+    g2 = 0;
+    while (u != 1) {
+        shift = __builtin_clzll(v) - __builtin_clzll(u);
+        if (shift < 0) {
+            t = u;
+            u = v;
+            v = t;
+            t = g1;
+            g1 = g2;
+            g2 = t;
+            shift = -shift;
         }
+        u ^= v << shift;
+        g1 ^= g2 << shift;
     }
-    return galois_ilog_tables[w];
+    return (unsigned)g1;
+}
+
+unsigned galois_shift_inverse(unsigned y, unsigned w) {
+    return galois_ctx_shift_inverse(&galois_fields[w], y);
+}
+
+const void *galois_get_compact_mult_table(unsigned w) {
+    if (galois_create_mult_tables(w) != 0)
+        return NULL;
+    return galois_fields[w].mult.load(std::memory_order_acquire);
+}
+
+const void *galois_get_compact_div_table(unsigned w) {
+    if (galois_create_mult_tables(w) != 0)
+        return NULL;
+    return galois_fields[w].div.load(std::memory_order_acquire);
+}
+
+const void *galois_get_compact_log_table(unsigned w) {
+    if (galois_create_log_tables(w) != 0)
+        return NULL;
+    return galois_fields[w].log.load(std::memory_order_acquire);
+}
+
+const void *galois_get_compact_ilog_table(unsigned w) {
+    if (galois_create_log_tables(w) != 0)
+        return NULL;
+    return galois_fields[w].ilog.load(std::memory_order_acquire);
+}
+
+/* Returns view, building it from entry(0 .. n-1) first if need be.  The
+   pointer returned is offset entries into the copy. */
+template <class F>
+static unsigned *galois_table_view(std::atomic<unsigned *> &view,
+                                   unsigned long n, unsigned long offset,
+                                   F entry) {
+    unsigned long long start;
+    unsigned *v;
+    unsigned long i;
+
+    v = view.load(std::memory_order_acquire);
+    if (v != NULL)
+        return v;
+
+    std::lock_guard<std::recursive_mutex> guard(galois_table_lock);
+    v = view.load(std::memory_order_relaxed);
+    if (v != NULL)
+        return v;
+
+    start = galois_counters_now();
+    v = (unsigned *)malloc(sizeof(unsigned) * n);
+    if (v == NULL)
+        return NULL;
+    for (i = 0; i < n; i++)
+        v[i] = entry(i);
+    view.store(v + offset, std::memory_order_release);
+    galois_count_table(GALOIS_STATS_VIEW, false, start, sizeof(unsigned) * n);
+    return v + offset;
+}
+
+unsigned *galois_get_mult_table(unsigned w) {
+    const void *mult = galois_get_compact_mult_table(w);
+
+    if (mult == NULL)
+        return NULL;
+    return galois_table_view(
+        galois_mult_views[w], (unsigned long)nw[w] * nw[w], 0,
+        [&](unsigned long i) { return galois_table_entry(mult, w, i); });
+}
+
+unsigned *galois_get_div_table(unsigned w) {
+    const void *div = galois_get_compact_div_table(w);
+
+    if (div == NULL)
+        return NULL;
+    return galois_table_view(
+        galois_div_views[w], (unsigned long)nw[w] * nw[w], 0,
+        [&](unsigned long i) {
+            return ((i & nwm1[w]) == 0) ? -1u : galois_table_entry(div, w, i);
+        });
+}
+
+unsigned *galois_get_log_table(unsigned w) {
+    const void *log = galois_get_compact_log_table(w);
+
+    if (log == NULL)
+        return NULL;
+    return galois_table_view(
+        galois_log_views[w], nw[w], 0,
+        [&](unsigned long i) { return galois_table_entry(log, w, i); });
+}
+
+unsigned *galois_get_ilog_table(unsigned w) {
+    const void *ilog = galois_get_compact_ilog_table(w);
+
+    if (ilog == NULL)
+        return NULL;
+    return galois_table_view(
+        galois_ilog_views[w], 3 * (unsigned long)nw[w], nwm1[w],
+        [&](unsigned long i) {
+            return galois_table_entry(ilog, w, i % nwm1[w]);
+        });
+}
+
+unsigned *galois_get_split_w8_table(unsigned i) {
+    if (i >= 7)
+        return NULL;
+    if (galois_create_split_w8_tables() != 0)
+        return NULL;
+    return galois_fields[32].split_w8[i].load(std::memory_order_acquire);
+}
+
+static void galois_ctx_w32_region_multiply(galois_ctx *ctx, char *region,
+                                           unsigned multby, unsigned nbytes,
+                                           char *r2, unsigned add) {
+    unsigned *ur1, *ur2;
+    unsigned char tables[512];
+
+    GALOIS_COUNT_REGION(2, nbytes, r2 != NULL && add);
+    ur1 = (unsigned *)region;
+    ur2 = (r2 == NULL) ? ur1 : (unsigned *)r2;
+    nbytes /= sizeof(unsigned);
+
+    galois_split_tables(ctx, multby, tables);
+    galois_kernels.w32_split(ur1, ur2, nbytes, tables, (r2 != NULL && add));
 }
 
 void galois_w32_region_multiply(char *region,    /* Region to multiply */
@@ -703,62 +1578,539 @@ void galois_w32_region_multiply(char *region,    /* Region to multiply */
                                 unsigned nbytes, /* Number of bytes in region */
                                 char *r2, /* If r2 != NULL, products go here */
                                 unsigned add) {
-    unsigned *ur1, *ur2, *cp, *ur2top;
-    unsigned long *lp2, *lptop;
-    unsigned i, j, a, b, accumulator, i8, j8, k;
-    unsigned acache[4];
+    galois_ctx_w32_region_multiply(&galois_fields[32], region, multby,
+                                   nbytes, r2, add);
+}
 
-    ur1 = (unsigned *)region;
-    ur2 = (r2 == NULL) ? ur1 : (unsigned *)r2;
-    nbytes /= sizeof(unsigned);
-    ur2top = ur2 + nbytes;
+/* Byte b of word i of an altmap block is at byte 16 b + i. */
 
-    if (galois_split_w8[0] == NULL) {
-        if (galois_create_split_w8_tables(/*8*/) < 0) {
-            throw std::logic_error(
-                "galois_32_region_multiply -- couldn't make split");
+void galois_w32_region_to_altmap(char *region, unsigned nbytes) {
+    unsigned char *p;
+    unsigned w[16];
+    unsigned long off;
+    unsigned i, b;
+
+    for (off = 0; off + 64 <= nbytes; off += 64) {
+        p = (unsigned char *)region + off;
+        memcpy(w, p, 64);
+        for (b = 0; b < 4; b++) {
+            for (i = 0; i < 16; i++)
+                p[16 * b + i] = w[i] >> (8 * b);
         }
     }
+}
 
-    /* If we're overwriting r2, then we can't do better than just calling
-       split_multiply.
-       We'll inline it here to save on the procedure call overhead */
+void galois_w32_region_from_altmap(char *region, unsigned nbytes) {
+    unsigned char *p;
+    unsigned w[16];
+    unsigned long off;
+    unsigned i;
+
+    for (off = 0; off + 64 <= nbytes; off += 64) {
+        p = (unsigned char *)region + off;
+        for (i = 0; i < 16; i++) {
+            w[i] = p[i] | (p[16 + i] << 8) | (p[32 + i] << 16) |
+                   ((unsigned)p[48 + i] << 24);
+        }
+        memcpy(p, w, 64);
+    }
+}
 
-    i8 = 0;
-    for (i = 0; i < 4; i++) {
-        acache[i] = (((multby >> i8) & 255) << 8);
-        i8 += 8;
+void galois_w32_region_multiply_altmap(char *region, unsigned multby,
+                                       unsigned nbytes, char *r2,
+                                       unsigned add) {
+    unsigned *ur1, *ur2;
+    unsigned char tables[512];
+
+    GALOIS_COUNT_REGION(2, nbytes, r2 != NULL && add);
+    ur1 = (unsigned *)region;
+    ur2 = (r2 == NULL) ? ur1 : (unsigned *)r2;
+    galois_split_tables(&galois_fields[32], multby, tables);
+    galois_kernels.w32_altmap(ur1, ur2, nbytes / sizeof(unsigned), tables,
+                              (r2 != NULL && add));
+}
+
+void galois_ctx_region_multiply(galois_ctx *ctx, char *region,
+                                unsigned multby, unsigned nbytes, char *r2,
+                                unsigned add) {
+    if (ctx->w == 8) {
+        galois_ctx_w08_region_multiply(ctx, region, multby, nbytes, r2, add);
+    } else if (ctx->w == 16) {
+        galois_ctx_w16_region_multiply(ctx, region, multby, nbytes, r2, add);
+    } else if (ctx->w == 32) {
+        galois_ctx_w32_region_multiply(ctx, region, multby, nbytes, r2, add);
+    } else {
+        throw std::invalid_argument(fmt::format(
+            "galois_ctx_region_multiply - no region multiply for w={}",
+            ctx->w));
     }
-    if (!add) {
-        for (k = 0; k < nbytes; k++) {
-            accumulator = 0;
-            for (i = 0; i < 4; i++) {
-                a = acache[i];
-                j8 = 0;
-                for (j = 0; j < 4; j++) {
-                    b = ((ur1[k] >> j8) & 255);
-                    accumulator ^= galois_split_w8[i + j][a | b];
-                    j8 += 8;
+}
+
+/* Matrix region multiplies.  The regions are cut into blocks small enough
+   that the k source blocks and m destination blocks all fit in L2.  Within
+   a block, each kernel call produces up to GALOIS_DOT_MAX outputs from one
+   pass over the sources, so the source data comes from memory once and
+   from cache ceil(m / GALOIS_DOT_MAX) - 1 more times.
+
+   Nothing here allocates once the coefficient tables exist.  The block
+   pointers for the sources live on the stack, GALOIS_MATRIX_SRCS of them,
+   and wider matrices take their sources that many at a time.  That only
+   happens when k + m is large enough that blocks are MATRIX_MIN_BLOCK
+   bytes, so the partial sums fit in a stack buffer too. */
+
+constexpr unsigned MATRIX_CACHE_BYTES = 256 * 1024;
+constexpr unsigned MATRIX_MIN_BLOCK = 1024;
+constexpr unsigned GALOIS_MATRIX_SRCS = 256;
+
+static_assert(GALOIS_MATRIX_SRCS >= MATRIX_CACHE_BYTES / MATRIX_MIN_BLOCK,
+              "wide matrices must have blocks of MATRIX_MIN_BLOCK bytes");
+
+/* Calls dot(src blocks, nsrc, first src, dst blocks, ndst, first row,
+   elements), which overwrites the dst blocks, for each block and each
+   group of at most GALOIS_DOT_MAX output rows.  With more than
+   GALOIS_MATRIX_SRCS sources, it is called one row and one group of
+   sources at a time, and the groups after the first are added in. */
+
+template <typename T, typename Dot>
+static void galois_matrix_blocks(unsigned k, unsigned m, char **src,
+                                 char **dst, unsigned nbytes, Dot dot) {
+    const T *sp[GALOIS_MATRIX_SRCS];
+    T *dp[GALOIS_DOT_MAX];
+    alignas(64) T sum[MATRIX_MIN_BLOCK / sizeof(T)];
+    T *sum_p = sum;
+    unsigned block, off, len, i, j, n, ndst, first, nsrc;
+
+    if (k == 0) {
+        for (i = 0; i < m; i++)
+            memset(dst[i], 0, nbytes);
+        return;
+    }
+
+    block = std::max((MATRIX_CACHE_BYTES / (k + m)) & ~255u, MATRIX_MIN_BLOCK);
+    for (off = 0; off < nbytes; off += block) {
+        len = std::min(block, nbytes - off);
+        if (k <= GALOIS_MATRIX_SRCS) {
+            for (j = 0; j < k; j++)
+                sp[j] = (const T *)(src[j] + off);
+            for (i = 0; i < m; i += ndst) {
+                ndst = std::min(m - i, (unsigned)GALOIS_DOT_MAX);
+                for (n = 0; n < ndst; n++)
+                    dp[n] = (T *)(dst[i + n] + off);
+                dot(sp, k, 0, dp, ndst, i, len / sizeof(T));
+            }
+            continue;
+        }
+
+        for (i = 0; i < m; i++) {
+            dp[0] = (T *)(dst[i] + off);
+            for (first = 0; first < k; first += nsrc) {
+                nsrc = std::min(k - first, GALOIS_MATRIX_SRCS);
+                for (j = 0; j < nsrc; j++)
+                    sp[j] = (const T *)(src[first + j] + off);
+                if (first == 0) {
+                    dot(sp, nsrc, first, dp, 1, i, len / sizeof(T));
+                } else {
+                    dot(sp, nsrc, first, &sum_p, 1, i, len / sizeof(T));
+                    galois_kernels.region_xor(
+                        (const unsigned char *)sum, (unsigned char *)dp[0],
+                        (unsigned char *)dp[0], len);
                 }
             }
-            ur2[k] = accumulator;
         }
-    } else {
-        for (k = 0; k < nbytes; k++) {
-            accumulator = 0;
-            for (i = 0; i < 4; i++) {
-                a = acache[i];
-                j8 = 0;
-                for (j = 0; j < 4; j++) {
-                    b = ((ur1[k] >> j8) & 255);
-                    accumulator ^= galois_split_w8[i + j][a | b];
-                    j8 += 8;
+    }
+}
+
+/* Without a dot-product kernel, one region multiply per coefficient, still
+   block by block. */
+
+template <typename T>
+static void galois_matrix_fallback(const unsigned *matrix, unsigned k,
+                                   unsigned m, char **src, char **dst,
+                                   unsigned nbytes,
+                                   void (*multiply)(char *, unsigned,
+                                                    unsigned, char *,
+                                                    unsigned)) {
+    galois_matrix_blocks<T>(
+        k, m, src, dst, nbytes,
+        [&](const T *const *s, unsigned nsrc, unsigned first, T *const *d,
+            unsigned ndst, unsigned row, unsigned long len) {
+            unsigned n, j;
+            for (n = 0; n < ndst; n++) {
+                for (j = 0; j < nsrc; j++) {
+                    multiply((char *)s[j], matrix[(row + n) * k + first + j],
+                             len * sizeof(T), (char *)d[n], j != 0);
                 }
             }
-            ur2[k] = (ur2[k] ^ accumulator);
+        });
+}
+
+unsigned galois_matrix_table_bytes(unsigned w) {
+    return (w == 8) ? 32 : (w == 16) ? 128 : 0;
+}
+
+void galois_matrix_tables(unsigned w, const unsigned *matrix, unsigned k,
+                          unsigned m, unsigned char *tables) {
+    unsigned size = galois_matrix_table_bytes(w);
+    unsigned i;
+
+    for (i = 0; size != 0 && i < k * m; i++)
+        galois_split_tables(&galois_fields[w], matrix[i], tables + size * i);
+}
+
+void galois_matrix_region_multiply(unsigned w, const unsigned *matrix,
+                                   const unsigned char *tables, unsigned k,
+                                   unsigned m, char **src, char **dst,
+                                   unsigned nbytes) {
+    if (w == 8 && galois_kernels.w08_dot != NULL) {
+        galois_matrix_blocks<unsigned char>(
+            k, m, src, dst, nbytes,
+            [&](const unsigned char *const *s, unsigned nsrc, unsigned first,
+                unsigned char *const *d, unsigned ndst, unsigned row,
+                unsigned long len) {
+                galois_kernels.w08_dot(s, nsrc, d, ndst,
+                                       tables + 32 * (row * k + first), len);
+            });
+    } else if (w == 8) {
+        galois_matrix_fallback<unsigned char>(matrix, k, m, src, dst, nbytes,
+                                              galois_w08_region_multiply);
+    } else if (w == 16 && galois_kernels.w16_dot != NULL) {
+        galois_matrix_blocks<unsigned short>(
+            k, m, src, dst, nbytes,
+            [&](const unsigned short *const *s, unsigned nsrc, unsigned first,
+                unsigned short *const *d, unsigned ndst, unsigned row,
+                unsigned long len) {
+                galois_kernels.w16_dot(s, nsrc, d, ndst,
+                                       tables + 128 * (row * k + first), len);
+            });
+    } else if (w == 16) {
+        galois_matrix_fallback<unsigned short>(matrix, k, m, src, dst, nbytes,
+                                               galois_w16_region_multiply);
+    } else if (galois_kernels.w32_dot != NULL) {
+        galois_matrix_blocks<unsigned>(
+            k, m, src, dst, nbytes,
+            [&](const unsigned *const *s, unsigned nsrc, unsigned first,
+                unsigned *const *d, unsigned ndst, unsigned row,
+                unsigned long len) {
+                galois_kernels.w32_dot(s, nsrc, d, ndst,
+                                       matrix + row * k + first,
+                                       galois_fields[32].poly,
+                                       galois_fields[32].mu, len);
+            });
+    } else {
+        galois_matrix_fallback<unsigned>(matrix, k, m, src, dst, nbytes,
+                                         galois_w32_region_multiply);
+    }
+}
+
+void galois_w08_matrix_region_multiply(unsigned *matrix, unsigned k,
+                                       unsigned m, char **src, char **dst,
+                                       unsigned nbytes) {
+    std::vector<unsigned char> tables(32 * k * m);
+
+    galois_matrix_tables(8, matrix, k, m, tables.data());
+    galois_matrix_region_multiply(8, matrix, tables.data(), k, m, src, dst,
+                                  nbytes);
+}
+
+void galois_w16_matrix_region_multiply(unsigned *matrix, unsigned k,
+                                       unsigned m, char **src, char **dst,
+                                       unsigned nbytes) {
+    std::vector<unsigned char> tables(128 * k * m);
+
+    galois_matrix_tables(16, matrix, k, m, tables.data());
+    galois_matrix_region_multiply(16, matrix, tables.data(), k, m, src, dst,
+                                  nbytes);
+}
+
+void galois_w32_matrix_region_multiply(unsigned *matrix, unsigned k,
+                                       unsigned m, char **src, char **dst,
+                                       unsigned nbytes) {
+    galois_matrix_region_multiply(32, matrix, NULL, k, m, src, dst, nbytes);
+}
+
+/* Delta parity updates.  The data is taken GALOIS_DELTA_BLOCK bytes at a
+   time:  the block of old ^ new goes into a buffer on the stack, and each
+   parity region adds its multiple of the buffer while it is still in L1.
+   So old and new are read once, each parity region is read and written
+   once, and the delta never goes to memory.  Coefficients of 0 are
+   skipped and coefficients of 1 are a plain XOR.
+
+   The split tables for the coefficients are on the stack too, so nothing
+   is allocated.  They are built for GALOIS_DELTA_PARITY parity regions at
+   a time; more parity regions than that take more passes over the data. */
+
+constexpr unsigned GALOIS_DELTA_BLOCK = 8192;
+constexpr unsigned GALOIS_DELTA_PARITY = 16;
+
+/* Calls add(i, delta block, parity i block, elements) for each block and
+   each parity region with a coefficient other than 0 or 1. */
+
+template <typename T, typename Add>
+static void galois_delta_blocks(const char *old_data, const char *new_data,
+                                const unsigned *coeffs, unsigned m,
+                                char **parity, unsigned nbytes, Add add) {
+    alignas(64) unsigned char delta[GALOIS_DELTA_BLOCK];
+    unsigned off, len, i;
+
+    nbytes -= nbytes % sizeof(T);
+    for (off = 0; off < nbytes; off += GALOIS_DELTA_BLOCK) {
+        len = std::min(GALOIS_DELTA_BLOCK, nbytes - off);
+        galois_kernels.region_xor((const unsigned char *)old_data + off,
+                                  (const unsigned char *)new_data + off,
+                                  delta, len);
+        for (i = 0; i < m; i++) {
+            if (coeffs[i] == 0)
+                continue;
+            if (coeffs[i] == 1) {
+                galois_kernels.region_xor(
+                    delta, (unsigned char *)parity[i] + off,
+                    (unsigned char *)parity[i] + off, len);
+            } else {
+                add(i, (const T *)delta, (T *)(parity[i] + off),
+                    len / sizeof(T));
+            }
         }
     }
-    return;
+}
+
+void galois_w08_region_delta_update(const char *old_data,
+                                    const char *new_data,
+                                    const unsigned *coeffs, unsigned m,
+                                    char **parity, unsigned nbytes) {
+    unsigned char tables[32 * GALOIS_DELTA_PARITY];
+    unsigned first, n, i;
+
+    for (first = 0; first < m; first += n) {
+        n = std::min(m - first, GALOIS_DELTA_PARITY);
+        for (i = 0; i < n; i++) {
+            GALOIS_COUNT_REGION(0, nbytes, 1);
+            galois_split_tables(&galois_fields[8], coeffs[first + i],
+                                &tables[32 * i]);
+        }
+        galois_delta_blocks<unsigned char>(
+            old_data, new_data, coeffs + first, n, parity + first, nbytes,
+            [&](unsigned i, const unsigned char *delta, unsigned char *p,
+                unsigned long len) {
+                galois_kernels.w08(delta, p, len, &tables[32 * i], 1);
+            });
+    }
+}
+
+void galois_w16_region_delta_update(const char *old_data,
+                                    const char *new_data,
+                                    const unsigned *coeffs, unsigned m,
+                                    char **parity, unsigned nbytes) {
+    unsigned char tables[128 * GALOIS_DELTA_PARITY];
+    unsigned first, n, i;
+
+    /* Without the shuffle kernel, fall back to the log tables of the
+       region multiply, still block by block. */
+    if (galois_kernels.w16 == NULL) {
+        galois_delta_blocks<unsigned short>(
+            old_data, new_data, coeffs, m, parity, nbytes,
+            [&](unsigned i, const unsigned short *delta, unsigned short *p,
+                unsigned long len) {
+                galois_w16_region_multiply((char *)delta, coeffs[i], len * 2,
+                                           (char *)p, 1);
+            });
+        return;
+    }
+
+    for (first = 0; first < m; first += n) {
+        n = std::min(m - first, GALOIS_DELTA_PARITY);
+        for (i = 0; i < n; i++) {
+            GALOIS_COUNT_REGION(1, nbytes, 1);
+            galois_split_tables(&galois_fields[16], coeffs[first + i],
+                                &tables[128 * i]);
+        }
+        galois_delta_blocks<unsigned short>(
+            old_data, new_data, coeffs + first, n, parity + first, nbytes,
+            [&](unsigned i, const unsigned short *delta, unsigned short *p,
+                unsigned long len) {
+                galois_kernels.w16(delta, p, len, &tables[128 * i], 1);
+            });
+    }
+}
+
+void galois_w32_region_delta_update(const char *old_data,
+                                    const char *new_data,
+                                    const unsigned *coeffs, unsigned m,
+                                    char **parity, unsigned nbytes) {
+    unsigned char tables[512 * GALOIS_DELTA_PARITY];
+    unsigned first, n, i;
+
+    for (first = 0; first < m; first += n) {
+        n = std::min(m - first, GALOIS_DELTA_PARITY);
+        for (i = 0; i < n; i++) {
+            GALOIS_COUNT_REGION(2, nbytes, 1);
+            galois_split_tables(&galois_fields[32], coeffs[first + i],
+                                &tables[512 * i]);
+        }
+        galois_delta_blocks<unsigned>(
+            old_data, new_data, coeffs + first, n, parity + first, nbytes,
+            [&](unsigned i, const unsigned *delta, unsigned *p,
+                unsigned long len) {
+                galois_kernels.w32_split(delta, p, len, &tables[512 * i], 1);
+            });
+    }
+}
+
+/* Element-wise arithmetic on arrays.  w = 8 and 16 go to the log/antilog
+   kernels, and w = 32 multiplies with the carry-less kernel when the CPU
+   has one.  Inverses are done with Montgomery's trick wherever a single
+   inverse is expensive (the shift and split_w8 fields):  the running
+   products y[0] * ... * y[i-1] are saved on the way forward, the product
+   of the whole chunk is inverted once, and walking back, each inverse is
+   the saved prefix times the inverse of the suffix.  That is 3 multiplies
+   per element and one inversion per GALOIS_BATCH_CHUNK elements.  The
+   prefixes live on the stack, so out may alias x or y. */
+
+constexpr unsigned GALOIS_BATCH_MULTIPLY = 0;
+constexpr unsigned GALOIS_BATCH_DIVIDE = 1;
+constexpr unsigned GALOIS_BATCH_INVERSE = 2;
+constexpr unsigned long GALOIS_BATCH_CHUNK = 1024;
+
+/* out[i] = 1 / y[i] for n <= GALOIS_BATCH_CHUNK, and zero for y[i] = 0. */
+template <class T, class F>
+static void galois_batch_montgomery(const T *y, T *out, unsigned long n,
+                                    unsigned w, T zero, F multiply) {
+    unsigned prefix[GALOIS_BATCH_CHUNK];
+    unsigned long i;
+    unsigned acc, inv, t;
+
+    acc = 1;
+    for (i = 0; i < n; i++) {
+        prefix[i] = acc;
+        if (y[i] != 0)
+            acc = multiply(acc, y[i]);
+    }
+    inv = galois_inverse(acc, w);
+    for (i = n; i-- > 0;) {
+        t = y[i];
+        if (t == 0) {
+            out[i] = zero;
+        } else {
+            out[i] = multiply(inv, prefix[i]);
+            inv = multiply(inv, t);
+        }
+    }
+}
+
+/* x is NULL for inverses.  T is the narrowest type that holds w bits. */
+template <class T>
+static void galois_batch(const T *x, const T *y, T *out, unsigned long n,
+                         unsigned w, unsigned op) {
+    T inv[GALOIS_BATCH_CHUNK];
+    unsigned long base, len, i;
+    galois_w32_multiply_fn clmul;
+    galois_w32_batch_kernel clmul_batch;
+
+    if (galois_fields[w].method == TABLE || galois_fields[w].method == LOGS) {
+        for (i = 0; i < n; i++) {
+            if (op == GALOIS_BATCH_MULTIPLY)
+                out[i] = galois_single_multiply(x[i], y[i], w);
+            else
+                out[i] = galois_single_divide(x ? x[i] : 1, y[i], w);
+        }
+        return;
+    }
+
+    clmul = (w == 32) ? galois_kernels.w32_multiply : NULL;
+    clmul_batch = (w == 32) ? galois_kernels.w32_batch : NULL;
+    auto multiply = [clmul, w](unsigned a, unsigned b) {
+        if (clmul != NULL)
+            return clmul(a, b, galois_fields[32].poly, galois_fields[32].mu);
+        return galois_single_multiply(a, b, w);
+    };
+    auto multiply_all = [&](const T *a, const T *b, T *c, unsigned long len) {
+        if constexpr (sizeof(T) == sizeof(unsigned)) {
+            if (clmul_batch != NULL) {
+                clmul_batch(a, b, c, len, galois_fields[32].poly,
+                            galois_fields[32].mu);
+                return;
+            }
+        }
+        for (unsigned long j = 0; j < len; j++)
+            c[j] = multiply(a[j], b[j]);
+    };
+
+    if (op == GALOIS_BATCH_MULTIPLY) {
+        multiply_all(x, y, out, n);
+        return;
+    }
+    for (base = 0; base < n; base += len) {
+        len = std::min(n - base, GALOIS_BATCH_CHUNK);
+        if (op == GALOIS_BATCH_INVERSE) {
+            galois_batch_montgomery(y + base, out + base, len, w, (T)-1,
+                                    multiply);
+            continue;
+        }
+        /* x / y = x * (1 / y).  The inverse of a nonzero element is never
+           zero, so a zero in inv marks a division by zero. */
+        galois_batch_montgomery(y + base, inv, len, w, (T)0, multiply);
+        multiply_all(x + base, inv, out + base, len);
+        for (i = 0; i < len; i++) {
+            if (inv[i] == 0)
+                out[base + i] = (T)-1;
+        }
+    }
+}
+
+static void galois_batch(const void *x, const void *y, void *out,
+                         unsigned long n, unsigned w, unsigned op) {
+    void *log, *ilog;
+
+    if (w == 0 || w > 32)
+        throw std::invalid_argument(
+            fmt::format("no implementation for w={}", w));
+
+    if (w == 8 || w == 16) {
+        if (galois_create_log_tables(w) != 0) {
+            throw std::invalid_argument(
+                fmt::format("Cannot make log tables for w={}", w));
+        }
+        log = galois_local_table(
+            &galois_fields[w], GALOIS_SLOT_LOG,
+            galois_fields[w].log.load(std::memory_order_acquire));
+        ilog = galois_local_table(
+            &galois_fields[w], GALOIS_SLOT_ILOG,
+            galois_fields[w].ilog.load(std::memory_order_acquire));
+        if (w == 8) {
+            galois_kernels.w08_batch(
+                (const unsigned char *)x, (const unsigned char *)y,
+                (unsigned char *)out, n, (const unsigned char *)log,
+                (const unsigned char *)ilog, op != GALOIS_BATCH_MULTIPLY);
+        } else {
+            galois_kernels.w16_batch(
+                (const unsigned short *)x, (const unsigned short *)y,
+                (unsigned short *)out, n, (const unsigned short *)log,
+                (const unsigned short *)ilog, op != GALOIS_BATCH_MULTIPLY);
+        }
+    } else if (w < 8) {
+        galois_batch((const unsigned char *)x, (const unsigned char *)y,
+                     (unsigned char *)out, n, w, op);
+    } else if (w < 16) {
+        galois_batch((const unsigned short *)x, (const unsigned short *)y,
+                     (unsigned short *)out, n, w, op);
+    } else {
+        galois_batch((const unsigned *)x, (const unsigned *)y,
+                     (unsigned *)out, n, w, op);
+    }
+}
+
+void galois_batch_multiply(const void *x, const void *y, void *out,
+                           unsigned long n, unsigned w) {
+    galois_batch(x, y, out, n, w, GALOIS_BATCH_MULTIPLY);
+}
+
+void galois_batch_divide(const void *x, const void *y, void *out,
+                         unsigned long n, unsigned w) {
+    galois_batch(x, y, out, n, w, GALOIS_BATCH_DIVIDE);
+}
+
+void galois_batch_inverse(const void *y, void *out, unsigned long n,
+                          unsigned w) {
+    galois_batch(NULL, y, out, n, w, GALOIS_BATCH_INVERSE);
 }
 
 void galois_region_xor(
@@ -767,65 +2119,123 @@ void galois_region_xor(
     char *r3,        /* Sum region (r3 = r1 ^ r2) -- can be r1 or r2 */
     unsigned nbytes) /* Number of bytes in region */
 {
-    long *l1;
-    long *l2;
-    long *l3;
-    long *ltop;
-    char *ctop;
+    galois_kernels.region_xor((const unsigned char *)r1,
+                              (const unsigned char *)r2, (unsigned char *)r3,
+                              nbytes);
+}
 
-    ctop = r1 + nbytes;
-    ltop = (long *)ctop;
-    l1 = (long *)r1;
-    l2 = (long *)r2;
-    l3 = (long *)r3;
+void galois_region_xor_n(const char *const *srcs, unsigned nsrc, char *dst,
+                         unsigned nbytes, unsigned flags) {
+    if ((flags & ~GALOIS_XOR_STREAM) != 0) {
+        throw std::invalid_argument(
+            fmt::format("galois_region_xor_n - bad flags {}", flags));
+    }
+    if (nsrc == 0) {
+        memset(dst, 0, nbytes);
+        return;
+    }
+    galois_kernels.region_xor_n((const unsigned char *const *)srcs, nsrc,
+                                (unsigned char *)dst, nbytes,
+                                flags & GALOIS_XOR_STREAM);
+}
 
-    while (l1 < ltop) {
-        *l3 = ((*l1) ^ (*l2));
-        l1++;
-        l2++;
-        l3++;
+/* table[(p1 << 8) | p2] = (p1 << ishift) * (p2 << jshift), which is
+   linear in both p1 and p2:  each row p1 = 2^k is built by doubling from
+   the products of the two bits, and each other row is the sum of the rows
+   for its bits. */
+
+static void galois_fill_split_w8_table(const galois_ctx *ctx, unsigned *table,
+                                       unsigned ishift, unsigned jshift) {
+    unsigned k, m, p, basis, *row;
+
+    memset(table, 0, sizeof(unsigned) * 256);
+    for (k = 0; k < 8; k++) {
+        row = table + (256u << k);
+        row[0] = 0;
+        for (m = 0; m < 8; m++) {
+            basis = galois_ctx_shift_multiply(ctx, 1u << (k + ishift),
+                                              1u << (m + jshift));
+            for (p = 0; p < (1u << m); p++)
+                row[(1u << m) + p] = row[p] ^ basis;
+        }
+        for (p = 256; p < (256u << k); p++)
+            row[p] = table[p] ^ row[p & 255];
     }
 }
 
-unsigned galois_create_split_w8_tables() {
-    unsigned p1, p2, i, j, p1elt, p2elt, index, ishift, jshift, *table;
+static unsigned galois_ctx_create_split_w8_tables(galois_ctx *ctx) {
+    unsigned i;
+    unsigned long long start;
+    unsigned long sizes[7];
+    void *split[7];
 
-    if (galois_split_w8[0] != NULL)
+    if (ctx->split_w8[0].load(std::memory_order_acquire) != NULL)
         return 0;
 
-    if (galois_create_mult_tables(8) < 0)
-        return -1;
+    std::lock_guard<std::recursive_mutex> guard(galois_table_lock);
+    if (ctx->split_w8[0].load(std::memory_order_relaxed) != NULL)
+        return 0;
+
+    start = galois_counters_now();
+    for (i = 0; i < 7; i++)
+        sizes[i] = sizeof(unsigned) * (1 << 16);
+    if (ctx->shared && galois_store_map(GALOIS_STORE_SPLIT_W8, 32, ctx->poly,
+                                        7, sizes, split)) {
+        for (i = 6; i > 0; i--) {
+            ctx->split_w8[i].store((unsigned *)split[i],
+                                   std::memory_order_release);
+        }
+        ctx->split_w8[0].store((unsigned *)split[0], std::memory_order_release);
+        galois_ctx_count_table(ctx, GALOIS_STATS_SPLIT_W8, true, start,
+                               7 * sizes[0]);
+        return 0;
+    }
 
     for (i = 0; i < 7; i++) {
-        galois_split_w8[i] = (unsigned *)malloc(sizeof(unsigned) * (1 << 16));
-        if (galois_split_w8[i] == NULL) {
-            for (i--; i >= 0; i--)
-                free(galois_split_w8[i]);
+        split[i] = malloc(sizeof(unsigned) * (1 << 16));
+        if (split[i] == NULL) {
+            while (i > 0)
+                free(split[--i]);
             return -1;
         }
     }
 
-    for (i = 0; i < 4; i += 3) {
-        ishift = i * 8;
-        for (j = ((i == 0) ? 0 : 1); j < 4; j++) {
-            jshift = j * 8;
-            table = galois_split_w8[i + j];
-            index = 0;
-            for (p1 = 0; p1 < 256; p1++) {
-                p1elt = (p1 << ishift);
-                for (p2 = 0; p2 < 256; p2++) {
-                    p2elt = (p2 << jshift);
-                    table[index] = galois_shift_multiply(p1elt, p2elt, 32);
-                    index++;
-                }
-            }
-        }
+    galois_parallel_for(7, [&](unsigned t) {
+        /* Tables 0 .. 3 pair byte 0 of x with bytes 0 .. 3 of y, and tables
+           4 .. 6 pair byte 3 of x with bytes 1 .. 3 of y */
+        if (t < 4)
+            galois_fill_split_w8_table(ctx, (unsigned *)split[t], 0, t * 8);
+        else
+            galois_fill_split_w8_table(ctx, (unsigned *)split[t], 24,
+                                       (t - 3) * 8);
+    });
+
+    if (ctx->shared) {
+        galois_store_offer(GALOIS_STORE_SPLIT_W8, 32, ctx->poly, 7, sizes,
+                           split);
     }
+    for (i = 6; i > 0; i--)
+        ctx->split_w8[i].store((unsigned *)split[i], std::memory_order_release);
+    ctx->split_w8[0].store((unsigned *)split[0], std::memory_order_release);
+    galois_ctx_count_table(ctx, GALOIS_STATS_SPLIT_W8, false, start,
+                           7 * sizes[0]);
     return 0;
 }
 
-unsigned galois_split_w8_multiply(unsigned x, unsigned y) {
+unsigned galois_create_split_w8_tables() {
+    return galois_ctx_create_split_w8_tables(&galois_fields[32]);
+}
+
+static unsigned galois_ctx_split_w8_multiply(const galois_ctx *ctx,
+                                             unsigned x, unsigned y) {
     unsigned i, j, a, b, accumulator, i8, j8;
+    unsigned *split[7];
+
+    for (i = 0; i < 7; i++) {
+        split[i] = (unsigned *)galois_local_table(
+            ctx, GALOIS_SLOT_SPLIT_W8 + i,
+            ctx->split_w8[i].load(std::memory_order_acquire));
+    }
 
     accumulator = 0;
 
@@ -835,10 +2245,156 @@ unsigned galois_split_w8_multiply(unsigned x, unsigned y) {
         j8 = 0;
         for (j = 0; j < 4; j++) {
             b = ((y >> j8) & 255);
-            accumulator ^= galois_split_w8[i + j][a | b];
+            accumulator ^= split[i + j][a | b];
             j8 += 8;
         }
         i8 += 8;
     }
     return accumulator;
 }
+
+unsigned galois_split_w8_multiply(unsigned x, unsigned y) {
+    return galois_ctx_split_w8_multiply(&galois_fields[32], x, y);
+}
+
+/* Field contexts.  galois_ctx_create() checks that x generates the field:
+   x^(2^w - 1) = 1, and x^((2^w - 1) / q) != 1 for each prime q dividing
+   2^w - 1.  The primes are found by trial division, which for w = 32 takes
+   well under a millisecond. */
+
+static bool galois_ctx_primitive(const galois_ctx *ctx) {
+    unsigned long long order, n, q;
+    unsigned x;
+
+    /* In GF(2), x = poly (mod x + poly) */
+    x = (ctx->w == 1) ? ctx->poly : 2;
+    order = (1ULL << ctx->w) - 1;
+    if (galois_ctx_power(ctx, x, order) != 1)
+        return false;
+    n = order;
+    for (q = 2; q * q <= n; q++) {
+        if (n % q != 0)
+            continue;
+        if (galois_ctx_power(ctx, x, order / q) == 1)
+            return false;
+        while (n % q == 0)
+            n /= q;
+    }
+    return n == 1 || galois_ctx_power(ctx, x, order / n) != 1;
+}
+
+galois_ctx *galois_ctx_create(unsigned w, unsigned poly, unsigned method) {
+    galois_ctx *ctx;
+    unsigned type;
+
+    if (w == 0 || w > 32) {
+        throw std::invalid_argument(
+            fmt::format("galois_ctx_create - bad w={}", w));
+    }
+    if (w < 32 && (poly >> w) == 1)
+        poly ^= nw[w];
+    if (w < 32 && (poly >> w) != 0) {
+        throw std::invalid_argument(fmt::format(
+            "galois_ctx_create - poly 0{:o} is too big for w={}", poly, w));
+    }
+
+    switch (method) {
+    case GALOIS_METHOD_DEFAULT:
+        type = mult_type[w];
+        break;
+    case GALOIS_METHOD_MULTTABLE:
+        type = (w <= 13) ? TABLE : NONE;
+        break;
+    case GALOIS_METHOD_LOGTABLE:
+        type = (w <= 30) ? LOGS : NONE;
+        break;
+    case GALOIS_METHOD_SHIFT:
+        type = SHIFT;
+        break;
+    case GALOIS_METHOD_SPLITW8:
+    case GALOIS_METHOD_CLMUL:
+        type = (w == 32) ? SPLITW8 : NONE;
+        break;
+    default:
+        type = NONE;
+    }
+    if (type == NONE) {
+        throw std::invalid_argument(fmt::format(
+            "galois_ctx_create - method {} does not work for w={}", method,
+            w));
+    }
+
+    ctx = new galois_ctx(w, poly, type, false);
+    if (!galois_ctx_primitive(ctx)) {
+        delete ctx;
+        throw std::invalid_argument(fmt::format(
+            "galois_ctx_create - poly 0{:o} is not primitive for w={}", poly,
+            w));
+    }
+    return ctx;
+}
+
+static void galois_free_replicas(galois_ctx *ctx) {
+    galois_replicas *r = ctx->replicas.load(std::memory_order_relaxed);
+    void *master[GALOIS_NSLOTS], *p;
+    unsigned node, slot;
+
+    if (r == NULL)
+        return;
+    master[GALOIS_SLOT_LOG] = ctx->log.load(std::memory_order_relaxed);
+    master[GALOIS_SLOT_ILOG] = ctx->ilog.load(std::memory_order_relaxed);
+    master[GALOIS_SLOT_MULT] = ctx->mult.load(std::memory_order_relaxed);
+    master[GALOIS_SLOT_DIV] = ctx->div.load(std::memory_order_relaxed);
+    for (slot = 0; slot < 7; slot++) {
+        master[GALOIS_SLOT_SPLIT_W8 + slot] =
+            ctx->split_w8[slot].load(std::memory_order_relaxed);
+    }
+    for (node = 0; node < GALOIS_NUMA_NODES; node++) {
+        for (slot = 0; slot < GALOIS_NSLOTS; slot++) {
+            p = r->tables[node][slot].load(std::memory_order_relaxed);
+            if (p != NULL && p != master[slot])
+                galois_numa_free(p, galois_slot_bytes(ctx, slot) + 4);
+        }
+    }
+    delete r;
+}
+
+void galois_ctx_free(galois_ctx *ctx) {
+    unsigned i;
+
+    if (ctx == NULL || ctx->shared)
+        return;
+    galois_free_replicas(ctx);
+    for (i = 0; i < GALOIS_STATS_NTABLES; i++)
+        galois_uncount_table(i, ctx->table_bytes[i].load());
+    free(ctx->log.load(std::memory_order_relaxed));
+    free(ctx->ilog.load(std::memory_order_relaxed));
+    free(ctx->mult.load(std::memory_order_relaxed));
+    free(ctx->div.load(std::memory_order_relaxed));
+    for (i = 0; i < 7; i++)
+        free(ctx->split_w8[i].load(std::memory_order_relaxed));
+    free(ctx->w32_inverse.load(std::memory_order_relaxed));
+    delete ctx;
+}
+
+galois_ctx *galois_default_ctx(unsigned w) {
+    if (w == 0 || w > 32) {
+        throw std::invalid_argument(
+            fmt::format("galois_default_ctx - bad w={}", w));
+    }
+    return &galois_fields[w];
+}
+
+void galois_ctx_get_params(const galois_ctx *ctx, unsigned *w, unsigned *poly,
+                           unsigned *method) {
+    if (w != NULL)
+        *w = ctx->w;
+    if (poly != NULL)
+        *poly = ctx->poly;
+    if (method != NULL) {
+        *method = (ctx->method == TABLE)  ? GALOIS_METHOD_MULTTABLE
+                  : (ctx->method == LOGS) ? GALOIS_METHOD_LOGTABLE
+                  : (ctx->method == SHIFT) ? GALOIS_METHOD_SHIFT
+                                           : GALOIS_METHOD_SPLITW8;
+    }
+}
@@ -0,0 +1,505 @@
+/* galois_bitmatrix.cpp
+ *
+ * Bit-matrix (XOR-only) erasure coding.  Internally the bit-matrices are
+ * kept as rows of 64-bit words, so that inverting them, multiplying them and
+ * comparing rows for the scheduler work on 64 bits at a time.  Decoding
+ * follows galois_rs.cpp:  invert the rows of k survivors, fold every erased
+ * block into one decoding bit-matrix, then schedule and run it.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "fmt/core.h"
+#include "fmt/format.h"
+#include "galois.h"
+#include "galois_bitmatrix.h"
+
+enum { XOR_COPY, XOR_ADD, XOR_ZERO };
+
+/* One step of a schedule.  Block numbers below k are sources, and k and up
+   are outputs; offsets are in bytes within a w * packetsize chunk. */
+struct galois_xor_op {
+    unsigned kind;
+    unsigned src_block, src_off;
+    unsigned dst_block, dst_off;
+};
+
+struct galois_bitmatrix_code {
+    unsigned k, m, w, packetsize;
+    std::vector<unsigned char> bitmatrix; /* (m*w) x (k*w) bytes */
+    unsigned stride;                      /* Words per packed row */
+    std::vector<unsigned long long> bits; /* Packed bitmatrix */
+    std::vector<galois_xor_op> encode_ops;
+    unsigned encode_xors;
+
+    /* Decoding scratch, sized for the worst case at creation time */
+    std::vector<unsigned long long> survivor_rows; /* (k*w) x (k*w) */
+    std::vector<unsigned long long> inverse;       /* (k*w) x (k*w) */
+    std::vector<unsigned long long> decoding;      /* (m*w) x (k*w) */
+    std::vector<galois_xor_op> decode_ops;
+    std::vector<unsigned> cost, from;              /* Scheduler state */
+    std::vector<unsigned char> done;
+    std::vector<unsigned char> is_erased;          /* k + m flags */
+    std::vector<char *> src;                       /* k regions */
+};
+
+static inline unsigned galois_bit(const unsigned long long *row, unsigned j) {
+    return (row[j / 64] >> (j % 64)) & 1;
+}
+
+static inline void galois_set_bit(unsigned long long *row, unsigned j) {
+    row[j / 64] |= 1ULL << (j % 64);
+}
+
+static unsigned galois_row_ones(const unsigned long long *row,
+                                unsigned stride) {
+    unsigned i, n;
+
+    n = 0;
+    for (i = 0; i < stride; i++)
+        n += __builtin_popcountll(row[i]);
+    return n;
+}
+
+static unsigned galois_row_distance(const unsigned long long *a,
+                                    const unsigned long long *b,
+                                    unsigned stride) {
+    unsigned i, n;
+
+    n = 0;
+    for (i = 0; i < stride; i++)
+        n += __builtin_popcountll(a[i] ^ b[i]);
+    return n;
+}
+
+void galois_matrix_to_bitmatrix(unsigned k, unsigned m, unsigned w,
+                                const unsigned *matrix,
+                                unsigned char *bitmatrix) {
+    unsigned i, j, r, c, e, cols;
+
+    cols = k * w;
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < k; j++) {
+            e = matrix[i * k + j];
+            for (c = 0; c < w; c++) {
+                for (r = 0; r < w; r++)
+                    bitmatrix[(i * w + r) * cols + j * w + c] = (e >> r) & 1;
+                if (c + 1 < w)
+                    e = galois_single_multiply(e, 2, w);
+            }
+        }
+    }
+}
+
+/* Number of ones in the w x w bit-matrix of e. */
+
+static unsigned galois_element_ones(unsigned e, unsigned w) {
+    unsigned c, n;
+
+    n = 0;
+    for (c = 0; c < w; c++) {
+        n += __builtin_popcount(e);
+        if (c + 1 < w)
+            e = galois_single_multiply(e, 2, w);
+    }
+    return n;
+}
+
+/* Start from 1 / (i ^ (m + j)).  Dividing a column or a row of a Cauchy
+   matrix by a non-zero element keeps every square submatrix invertible, so
+   divide each column by its row 0 element, making row 0 all ones, and then
+   divide each other row by whichever of its elements leaves it with the
+   fewest ones. */
+
+unsigned galois_cauchy_good_matrix(unsigned k, unsigned m, unsigned w,
+                                   unsigned *matrix) {
+    unsigned i, j, l, e, best, best_ones, ones;
+
+    if (w == 0 || w > 32 || k == 0 || m == 0 ||
+        (unsigned long long)k + m > (1ULL << w))
+        return -1;
+
+    for (i = 0; i < m; i++)
+        for (j = 0; j < k; j++)
+            matrix[i * k + j] = galois_inverse(i ^ (m + j), w);
+
+    for (j = 0; j < k; j++) {
+        e = matrix[j];
+        if (e == 1)
+            continue;
+        for (i = 0; i < m; i++)
+            matrix[i * k + j] = galois_single_divide(matrix[i * k + j], e, w);
+    }
+
+    for (i = 1; i < m; i++) {
+        best = 1;
+        best_ones = 0;
+        for (j = 0; j < k; j++)
+            best_ones += galois_element_ones(matrix[i * k + j], w);
+        for (l = 0; l < k; l++) {
+            e = matrix[i * k + l];
+            if (e == 1)
+                continue;
+            ones = 0;
+            for (j = 0; j < k; j++)
+                ones += galois_element_ones(
+                    galois_single_divide(matrix[i * k + j], e, w), w);
+            if (ones < best_ones) {
+                best = e;
+                best_ones = ones;
+            }
+        }
+        if (best != 1)
+            for (j = 0; j < k; j++)
+                matrix[i * k + j] =
+                    galois_single_divide(matrix[i * k + j], best, w);
+    }
+    return 0;
+}
+
+/* Inverts the n x n GF(2) matrix mat into inv.  mat is destroyed.  Returns
+   0 on success, -1 if mat is singular. */
+
+static unsigned galois_invert_bits(unsigned long long *mat,
+                                   unsigned long long *inv, unsigned n,
+                                   unsigned stride) {
+    unsigned i, j, l;
+    unsigned long long *ri, *rj;
+
+    std::fill(inv, inv + n * stride, 0ULL);
+    for (i = 0; i < n; i++)
+        galois_set_bit(inv + i * stride, i);
+
+    for (i = 0; i < n; i++) {
+        for (j = i; j < n && !galois_bit(mat + j * stride, i); j++)
+            ;
+        if (j == n)
+            return -1;
+        if (j != i) {
+            std::swap_ranges(mat + i * stride, mat + (i + 1) * stride,
+                             mat + j * stride);
+            std::swap_ranges(inv + i * stride, inv + (i + 1) * stride,
+                             inv + j * stride);
+        }
+        ri = mat + i * stride;
+        for (j = 0; j < n; j++) {
+            rj = mat + j * stride;
+            if (j == i || !galois_bit(rj, i))
+                continue;
+            for (l = 0; l < stride; l++) {
+                rj[l] ^= ri[l];
+                inv[j * stride + l] ^= inv[i * stride + l];
+            }
+        }
+    }
+    return 0;
+}
+
+/* out = a * b, where a has rows rows and b is n x n. */
+
+static void galois_multiply_bits(const unsigned long long *a, unsigned rows,
+                                 const unsigned long long *b, unsigned n,
+                                 unsigned stride, unsigned long long *out) {
+    unsigned i, j, l;
+
+    std::fill(out, out + rows * stride, 0ULL);
+    for (i = 0; i < rows; i++)
+        for (j = 0; j < n; j++)
+            if (galois_bit(a + i * stride, j))
+                for (l = 0; l < stride; l++)
+                    out[i * stride + l] ^= b[j * stride + l];
+}
+
+/* Smart scheduling.  cost[i] is the number of XORs row i needs:  its ones
+   minus one from scratch, or its distance to from[i] if it starts as a copy
+   of that already computed row.  Each round computes the cheapest remaining
+   row, and then lowers the cost of the others that are closer to it.
+   Returns the number of XORs. */
+
+static unsigned galois_schedule(galois_bitmatrix_code *code,
+                                const unsigned long long *rows,
+                                unsigned nrows,
+                                std::vector<galois_xor_op> &ops) {
+    unsigned k = code->k, w = code->w, ps = code->packetsize;
+    unsigned stride = code->stride, ncols = k * w;
+    unsigned *cost = code->cost.data(), *from = code->from.data();
+    unsigned char *done = code->done.data();
+    unsigned i, j, n, top, d, xors;
+    const unsigned long long *row;
+    galois_xor_op op;
+    bool first;
+
+    ops.clear();
+    xors = 0;
+    for (i = 0; i < nrows; i++) {
+        n = galois_row_ones(rows + i * stride, stride);
+        cost[i] = (n == 0) ? 0 : n - 1;
+        from[i] = -1;
+        done[i] = 0;
+    }
+
+    for (n = 0; n < nrows; n++) {
+        top = -1;
+        for (i = 0; i < nrows; i++)
+            if (!done[i] && (top == (unsigned)-1 || cost[i] < cost[top]))
+                top = i;
+        done[top] = 1;
+        row = rows + top * stride;
+        op.dst_block = k + top / w;
+        op.dst_off = (top % w) * ps;
+
+        if (from[top] != (unsigned)-1) {
+            op.kind = XOR_COPY;
+            op.src_block = k + from[top] / w;
+            op.src_off = (from[top] % w) * ps;
+            ops.push_back(op);
+            for (j = 0; j < ncols; j++) {
+                if (galois_bit(row, j) !=
+                    galois_bit(rows + from[top] * stride, j)) {
+                    op.kind = XOR_ADD;
+                    op.src_block = j / w;
+                    op.src_off = (j % w) * ps;
+                    ops.push_back(op);
+                }
+            }
+        } else {
+            first = true;
+            for (j = 0; j < ncols; j++) {
+                if (galois_bit(row, j)) {
+                    op.kind = first ? XOR_COPY : XOR_ADD;
+                    op.src_block = j / w;
+                    op.src_off = (j % w) * ps;
+                    ops.push_back(op);
+                    first = false;
+                }
+            }
+            if (first) {
+                op.kind = XOR_ZERO;
+                ops.push_back(op);
+            }
+        }
+        xors += cost[top];
+
+        for (i = 0; i < nrows; i++) {
+            if (done[i])
+                continue;
+            d = galois_row_distance(rows + i * stride, row, stride);
+            if (d < cost[i]) {
+                cost[i] = d;
+                from[i] = top;
+            }
+        }
+    }
+    return xors;
+}
+
+/* Every output packet's ops are a zero, or a copy followed by adds.  The
+   copy and adds are done together by galois_region_xor_n(), so the packet
+   is written once rather than once per add; the sources go in batches of
+   XOR_N_BATCH, each after the first starting from the packet itself. */
+
+constexpr unsigned XOR_N_BATCH = 16;
+
+static void galois_run_schedule(const std::vector<galois_xor_op> &ops,
+                                unsigned k, char **src, char **dst,
+                                unsigned nbytes, unsigned ps,
+                                unsigned chunk) {
+    const char *srcs[XOR_N_BATCH];
+    unsigned off, n;
+    size_t i;
+    char *d;
+
+    auto source = [&](const galois_xor_op &op) {
+        return ((op.src_block < k) ? src[op.src_block]
+                                   : dst[op.src_block - k]) +
+               off + op.src_off;
+    };
+
+    for (off = 0; off < nbytes; off += chunk) {
+        for (i = 0; i < ops.size();) {
+            d = dst[ops[i].dst_block - k] + off + ops[i].dst_off;
+            if (ops[i].kind == XOR_ZERO) {
+                memset(d, 0, ps);
+                i++;
+                continue;
+            }
+            n = 0;
+            srcs[n++] = source(ops[i++]);
+            for (; i < ops.size() && ops[i].kind == XOR_ADD; i++) {
+                if (n == XOR_N_BATCH) {
+                    galois_region_xor_n(srcs, n, d, ps, 0);
+                    srcs[0] = d;
+                    n = 1;
+                }
+                srcs[n++] = source(ops[i]);
+            }
+            galois_region_xor_n(srcs, n, d, ps, 0);
+        }
+    }
+}
+
+galois_bitmatrix_code *galois_bitmatrix_create(unsigned k, unsigned m,
+                                               unsigned w,
+                                               const unsigned *matrix,
+                                               unsigned packetsize) {
+    galois_bitmatrix_code *code;
+    std::vector<unsigned> cauchy;
+    unsigned i, j, rows, cols;
+
+    if (w == 0 || w > 32) {
+        throw std::invalid_argument(
+            fmt::format("galois_bitmatrix_create - bad w={}", w));
+    }
+    if (k == 0 || m == 0 || packetsize == 0 ||
+        (matrix == NULL && (unsigned long long)k + m > (1ULL << w))) {
+        throw std::invalid_argument(fmt::format(
+            "galois_bitmatrix_create - bad k={}, m={}, packetsize={} for w={}",
+            k, m, packetsize, w));
+    }
+
+    if (matrix == NULL) {
+        cauchy.resize(m * k);
+        galois_cauchy_good_matrix(k, m, w, cauchy.data());
+        matrix = cauchy.data();
+    }
+
+    code = new galois_bitmatrix_code;
+    code->k = k;
+    code->m = m;
+    code->w = w;
+    code->packetsize = packetsize;
+    rows = m * w;
+    cols = k * w;
+    code->stride = (cols + 63) / 64;
+
+    code->bitmatrix.resize(rows * cols);
+    galois_matrix_to_bitmatrix(k, m, w, matrix, code->bitmatrix.data());
+    code->bits.assign(rows * code->stride, 0ULL);
+    for (i = 0; i < rows; i++)
+        for (j = 0; j < cols; j++)
+            if (code->bitmatrix[i * cols + j])
+                galois_set_bit(code->bits.data() + i * code->stride, j);
+
+    code->survivor_rows.resize(cols * code->stride);
+    code->inverse.resize(cols * code->stride);
+    code->decoding.resize(rows * code->stride);
+    code->cost.resize(rows);
+    code->from.resize(rows);
+    code->done.resize(rows);
+    code->is_erased.resize(k + m);
+    code->src.resize(k);
+
+    /* A row takes at most cols operations, so this is enough for any
+       decoding schedule, and decode_ops never reallocates. */
+    code->decode_ops.reserve((size_t)rows * cols);
+
+    code->encode_xors =
+        galois_schedule(code, code->bits.data(), rows, code->encode_ops);
+    code->encode_ops.shrink_to_fit();
+    return code;
+}
+
+void galois_bitmatrix_free(galois_bitmatrix_code *code) { delete code; }
+
+const unsigned char *galois_bitmatrix_get(const galois_bitmatrix_code *code) {
+    return code->bitmatrix.data();
+}
+
+unsigned galois_bitmatrix_xors(const galois_bitmatrix_code *code) {
+    return code->encode_xors;
+}
+
+static unsigned galois_bitmatrix_chunk(const galois_bitmatrix_code *code,
+                                       unsigned nbytes) {
+    unsigned chunk = code->w * code->packetsize;
+
+    if (nbytes % chunk != 0) {
+        throw std::invalid_argument(fmt::format(
+            "galois_bitmatrix - nbytes={} is not a multiple of w * "
+            "packetsize={}",
+            nbytes, chunk));
+    }
+    return chunk;
+}
+
+void galois_bitmatrix_encode(const galois_bitmatrix_code *code, char **data,
+                             char **parity, unsigned nbytes) {
+    unsigned chunk = galois_bitmatrix_chunk(code, nbytes);
+
+    galois_run_schedule(code->encode_ops, code->k, data, parity, nbytes,
+                        code->packetsize, chunk);
+}
+
+unsigned galois_bitmatrix_decode(galois_bitmatrix_code *code, char **blocks,
+                                 const unsigned *erased, unsigned nerased,
+                                 char **out, unsigned nbytes) {
+    unsigned k = code->k, m = code->m, w = code->w, stride = code->stride;
+    unsigned chunk = galois_bitmatrix_chunk(code, nbytes);
+    unsigned long long *rows = code->survivor_rows.data();
+    unsigned long long *inv = code->inverse.data();
+    unsigned long long *dec = code->decoding.data();
+    const unsigned long long *bits = code->bits.data();
+    unsigned i, r, id, n;
+    bool data_lost;
+
+    if (nerased > m)
+        return -1;
+    if (nerased == 0)
+        return 0;
+
+    std::fill(code->is_erased.begin(), code->is_erased.end(), 0);
+    data_lost = false;
+    for (i = 0; i < nerased; i++) {
+        if (erased[i] >= k + m || code->is_erased[erased[i]])
+            return -1;
+        code->is_erased[erased[i]] = 1;
+        if (erased[i] < k)
+            data_lost = true;
+    }
+
+    for (i = 0, id = 0; i < k; id++) {
+        if (!code->is_erased[id]) {
+            code->src[i] = blocks[id];
+            if (data_lost) {
+                /* The w rows that produce block id from the data */
+                for (r = 0; r < w; r++) {
+                    unsigned long long *row = rows + (i * w + r) * stride;
+                    if (id < k) {
+                        std::fill(row, row + stride, 0ULL);
+                        galois_set_bit(row, id * w + r);
+                    } else {
+                        std::copy(bits + ((id - k) * w + r) * stride,
+                                  bits + ((id - k) * w + r + 1) * stride, row);
+                    }
+                }
+            }
+            i++;
+        }
+    }
+
+    n = k * w;
+    if (data_lost && galois_invert_bits(rows, inv, n, stride) != 0)
+        return -1;
+
+    for (i = 0; i < nerased; i++) {
+        id = erased[i];
+        if (id < k) {
+            std::copy(inv + id * w * stride, inv + (id + 1) * w * stride,
+                      dec + i * w * stride);
+        } else if (!data_lost) {
+            std::copy(bits + (id - k) * w * stride,
+                      bits + (id - k + 1) * w * stride, dec + i * w * stride);
+        } else {
+            galois_multiply_bits(bits + (id - k) * w * stride, w, inv, n,
+                                 stride, dec + i * w * stride);
+        }
+    }
+
+    galois_schedule(code, dec, nerased * w, code->decode_ops);
+    galois_run_schedule(code->decode_ops, k, code->src.data(), out, nbytes,
+                        code->packetsize, chunk);
+    return 0;
+}
@@ -0,0 +1,91 @@
+/* galois_counters.h
+ *
+ * The library's side of galois_stats.h:  the per-thread counters, and the
+ * hooks that galois.cpp calls.  The counters are defined in
+ * galois_stats.cpp.
+ *
+ * This header is not installed.
+ */
+
+#ifndef GALOIS_COUNTERS_H
+#define GALOIS_COUNTERS_H
+
+#include <atomic>
+
+#include "galois_stats.h"
+
+/* One thread's per-call counters.  Only that thread writes them, with a
+   relaxed load and store rather than a locked add, and galois_get_stats()
+   reads them with relaxed loads. */
+struct galois_counters {
+    std::atomic<unsigned long long> single_multiply[33];
+    std::atomic<unsigned long long> single_divide[33];
+    std::atomic<unsigned long long> region_overwrite[5];
+    std::atomic<unsigned long long> region_add[5];
+    std::atomic<unsigned long long> region_bytes[5];
+};
+
+#ifdef GALOIS_STATS
+
+extern std::atomic<bool> galois_counters_on;
+
+/* The calling thread's counters, or NULL until it first counts something.
+   Being constant-initialized, this is a single TLS load, with none of the
+   guard checks of a thread_local that has a constructor. */
+inline thread_local galois_counters *galois_counters_mine = nullptr;
+
+/* Registers and returns the calling thread's counters. */
+galois_counters *galois_counters_register();
+
+static inline galois_counters &galois_counters_local() {
+    galois_counters *c = galois_counters_mine;
+
+    if (c == nullptr)
+        c = galois_counters_register();
+    return *c;
+}
+
+static inline void galois_count(std::atomic<unsigned long long> &c,
+                                unsigned long long n) {
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+#define GALOIS_COUNT(field, n)                                                 \
+    do {                                                                       \
+        if (galois_counters_on.load(std::memory_order_relaxed))                \
+            galois_count(galois_counters_local().field, (n));                  \
+    } while (0)
+
+/* i is 0 .. 4 for w = 8, 16, 32, 64 and 128. */
+#define GALOIS_COUNT_REGION(i, nbytes, add)                                    \
+    do {                                                                       \
+        if (galois_counters_on.load(std::memory_order_relaxed)) {              \
+            galois_counters &c_ = galois_counters_local();                     \
+            galois_count((add) ? c_.region_add[i] : c_.region_overwrite[i],    \
+                         1);                                                   \
+            galois_count(c_.region_bytes[i], (nbytes));                        \
+        }                                                                      \
+    } while (0)
+
+#else
+
+#define GALOIS_COUNT(field, n)                                                 \
+    do {                                                                       \
+    } while (0)
+#define GALOIS_COUNT_REGION(i, nbytes, add)                                    \
+    do {                                                                       \
+    } while (0)
+
+#endif
+
+/* The table counters are kept either way.  A create function takes
+   galois_counters_now() before it starts, and calls galois_count_table()
+   once the set is published, with mapped set if it came from the table
+   store.  Freeing tables calls galois_uncount_table() with the bytes they
+   were counted with. */
+unsigned long long galois_counters_now();
+void galois_count_table(unsigned kind, bool mapped, unsigned long long start,
+                        unsigned long long bytes);
+void galois_uncount_table(unsigned kind, unsigned long long bytes);
+
+#endif
@@ -0,0 +1,300 @@
+/* galois_jobs.cpp
+ *
+ * The job engine.  A task is a run of consecutive jobs from one
+ * galois_jobs_submit() call.  Tasks submitted from outside are dealt
+ * round-robin onto the workers' deques, and tasks a worker submits from a
+ * done callback go onto its own.  A worker pops from the back of its own
+ * deque and steals from the front of the others', so it runs the tasks it
+ * queued most recently itself, and the tasks that have waited longest are
+ * the ones that move.  A deque is touched once per task, not per job, so
+ * each has a plain mutex.
+ *
+ * Idle workers sleep on one condition variable.  queued counts the tasks in
+ * the deques; it is raised after a push and before the wakeup, and a worker
+ * only sleeps after seeing it at zero under the sleep lock, so no wakeup is
+ * lost.  pending counts unfinished jobs, for galois_jobs_wait().
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "galois.h"
+#include "galois_jobs.h"
+#include "galois_rs_scratch.h"
+
+constexpr unsigned GALOIS_JOBS_BATCH_BYTES = 256 * 1024;
+
+namespace {
+
+struct galois_task {
+    galois_job *jobs;
+    unsigned n;
+};
+
+struct galois_worker {
+    galois_jobs *engine;
+    unsigned index;
+
+    std::mutex lock; /* Protects tasks */
+    std::deque<galois_task> tasks;
+
+    galois_rs_scratch scratch; /* For decode jobs */
+    std::thread thread;
+};
+
+} // namespace
+
+struct galois_jobs {
+    std::vector<std::unique_ptr<galois_worker>> workers;
+    unsigned batch_bytes;
+    std::atomic<unsigned> next{0}; /* Where the next submit starts dealing */
+
+    std::mutex sleep_lock; /* Protects stop, and orders the wakeups */
+    std::condition_variable work_cv; /* queued > 0, or stop */
+    std::condition_variable done_cv; /* pending == 0 */
+    bool stop = false;
+
+    std::atomic<unsigned long> queued{0};
+    std::atomic<unsigned long> pending{0};
+};
+
+/* The worker the calling thread is, if any */
+static thread_local galois_worker *galois_current_worker = NULL;
+
+/* Roughly how many bytes a job reads and writes, for batching. */
+static unsigned long galois_job_bytes(const galois_job *job) {
+    unsigned k, m, w;
+
+    if ((job->kind == GALOIS_JOB_ENCODE || job->kind == GALOIS_JOB_DECODE) &&
+        job->code != NULL) {
+        galois_rs_get_params(job->code, &k, &m, &w);
+        if (job->kind == GALOIS_JOB_DECODE)
+            m = job->nerased;
+        return (unsigned long)job->nbytes * (k + m);
+    }
+    return 2 * (unsigned long)job->nbytes;
+}
+
+static void galois_run_job(galois_worker *self, galois_job *job) {
+    unsigned status = 0;
+
+    try {
+        if (job->kind == GALOIS_JOB_ENCODE && job->code != NULL) {
+            galois_rs_encode(job->code, job->blocks, job->out, job->nbytes);
+        } else if (job->kind == GALOIS_JOB_DECODE && job->code != NULL) {
+            status = galois_rs_decode_scratch(
+                job->code, &self->scratch, job->blocks, job->erased,
+                job->nerased, job->out, job->nbytes);
+        } else if (job->kind == GALOIS_JOB_REGION_MULTIPLY && job->w == 8) {
+            galois_w08_region_multiply(job->region, job->multby, job->nbytes,
+                                       job->r2, job->add);
+        } else if (job->kind == GALOIS_JOB_REGION_MULTIPLY && job->w == 16) {
+            galois_w16_region_multiply(job->region, job->multby, job->nbytes,
+                                       job->r2, job->add);
+        } else if (job->kind == GALOIS_JOB_REGION_MULTIPLY && job->w == 32) {
+            galois_w32_region_multiply(job->region, job->multby, job->nbytes,
+                                       job->r2, job->add);
+        } else {
+            status = -1;
+        }
+    } catch (...) {
+        status = -1;
+    }
+
+    job->status = status;
+    if (job->done != NULL)
+        job->done(job);
+}
+
+/* Takes a task from the back of self's deque, or else from the front of
+   another worker's, starting with the next one along. */
+static bool galois_take_task(galois_worker *self, galois_task *task) {
+    galois_jobs *e = self->engine;
+    unsigned i, n = e->workers.size();
+    galois_worker *victim;
+
+    {
+        std::lock_guard<std::mutex> guard(self->lock);
+        if (!self->tasks.empty()) {
+            *task = self->tasks.back();
+            self->tasks.pop_back();
+            e->queued.fetch_sub(1);
+            return true;
+        }
+    }
+    for (i = 1; i < n; i++) {
+        victim = e->workers[(self->index + i) % n].get();
+        std::lock_guard<std::mutex> guard(victim->lock);
+        if (!victim->tasks.empty()) {
+            *task = victim->tasks.front();
+            victim->tasks.pop_front();
+            e->queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void galois_worker_main(galois_worker *self) {
+    galois_jobs *e = self->engine;
+    galois_task task;
+    unsigned i;
+
+    galois_current_worker = self;
+    for (;;) {
+        if (galois_take_task(self, &task)) {
+            for (i = 0; i < task.n; i++)
+                galois_run_job(self, &task.jobs[i]);
+            if (e->pending.fetch_sub(task.n) == task.n) {
+                std::lock_guard<std::mutex> guard(e->sleep_lock);
+                e->done_cv.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(e->sleep_lock);
+        e->work_cv.wait(lk, [e] { return e->stop || e->queued.load() != 0; });
+        if (e->stop && e->queued.load() == 0)
+            return;
+    }
+}
+
+static void galois_jobs_stop(galois_jobs *e) {
+    {
+        std::lock_guard<std::mutex> guard(e->sleep_lock);
+        e->stop = true;
+    }
+    e->work_cv.notify_all();
+    for (auto &w : e->workers)
+        if (w->thread.joinable())
+            w->thread.join();
+}
+
+/* Pins worker i to the i-th CPU in the process's affinity mask.  Pinning
+   is only a hint for locality, so failures are ignored. */
+static void galois_jobs_pin(galois_jobs *e) {
+    std::vector<unsigned> cpus;
+    cpu_set_t set;
+    unsigned i;
+
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        return;
+    for (i = 0; i < CPU_SETSIZE; i++)
+        if (CPU_ISSET(i, &set))
+            cpus.push_back(i);
+    if (cpus.empty())
+        return;
+
+    for (i = 0; i < e->workers.size(); i++) {
+        CPU_ZERO(&set);
+        CPU_SET(cpus[i % cpus.size()], &set);
+        pthread_setaffinity_np(e->workers[i]->thread.native_handle(),
+                               sizeof(set), &set);
+    }
+}
+
+galois_jobs *galois_jobs_create(const galois_jobs_options *options) {
+    galois_jobs_options opts = {};
+    galois_jobs *e;
+    unsigned i;
+
+    if (options != NULL)
+        opts = *options;
+    if (opts.nthreads == 0)
+        opts.nthreads = std::max(1u, std::thread::hardware_concurrency());
+    if (opts.batch_bytes == 0)
+        opts.batch_bytes = GALOIS_JOBS_BATCH_BYTES;
+
+    e = new galois_jobs;
+    e->batch_bytes = opts.batch_bytes;
+    for (i = 0; i < opts.nthreads; i++) {
+        e->workers.emplace_back(new galois_worker);
+        e->workers[i]->engine = e;
+        e->workers[i]->index = i;
+    }
+
+    try {
+        for (auto &w : e->workers)
+            w->thread = std::thread(galois_worker_main, w.get());
+    } catch (...) {
+        galois_jobs_stop(e);
+        delete e;
+        throw;
+    }
+    if (opts.pin)
+        galois_jobs_pin(e);
+    return e;
+}
+
+void galois_jobs_free(galois_jobs *engine) {
+    if (engine == NULL)
+        return;
+    galois_jobs_wait(engine);
+    galois_jobs_stop(engine);
+    delete engine;
+}
+
+void galois_jobs_submit(galois_jobs *engine, galois_job *jobs, unsigned n) {
+    galois_worker *self = galois_current_worker;
+    std::vector<galois_task> tasks;
+    unsigned i, first, nworkers, start;
+    unsigned long bytes, more;
+    galois_worker *w;
+
+    if (n == 0)
+        return;
+
+    /* Consecutive jobs go in one task until it holds batch_bytes */
+    for (i = 0; i < n;) {
+        first = i;
+        bytes = galois_job_bytes(&jobs[i++]);
+        while (i < n) {
+            more = galois_job_bytes(&jobs[i]);
+            if (bytes + more > engine->batch_bytes)
+                break;
+            bytes += more;
+            i++;
+        }
+        tasks.push_back({jobs + first, i - first});
+    }
+
+    engine->pending.fetch_add(n);
+    if (self != NULL && self->engine == engine) {
+        std::lock_guard<std::mutex> guard(self->lock);
+        self->tasks.insert(self->tasks.end(), tasks.begin(), tasks.end());
+    } else {
+        nworkers = engine->workers.size();
+        start = engine->next.fetch_add(tasks.size());
+        for (i = 0; i < tasks.size(); i++) {
+            w = engine->workers[(start + i) % nworkers].get();
+            std::lock_guard<std::mutex> guard(w->lock);
+            w->tasks.push_back(tasks[i]);
+        }
+    }
+    engine->queued.fetch_add(tasks.size());
+
+    {
+        std::lock_guard<std::mutex> guard(engine->sleep_lock);
+    }
+    if (tasks.size() == 1)
+        engine->work_cv.notify_one();
+    else
+        engine->work_cv.notify_all();
+}
+
+void galois_jobs_wait(galois_jobs *engine) {
+    std::unique_lock<std::mutex> lk(engine->sleep_lock);
+
+    engine->done_cv.wait(lk, [engine] { return engine->pending.load() == 0; });
+}
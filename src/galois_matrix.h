@@ -0,0 +1,32 @@
+/* galois_matrix.h
+ *
+ * Internal interface to the matrix region multiplies with the coefficient
+ * tables built ahead of time (galois.cpp).  galois_wXX_matrix_region_
+ * multiply() builds the tables on every call; a caller that multiplies by
+ * the same matrix over and over, like the Reed-Solomon codes
+ * (galois_rs.cpp), builds them once and calls
+ * galois_matrix_region_multiply(), which never allocates.
+ *
+ * This header is not installed.
+ */
+
+#ifndef GALOIS_MATRIX_H
+#define GALOIS_MATRIX_H
+
+/* Bytes of tables per coefficient:  32 for w = 8, 128 for w = 16, and 0
+   for w = 32, whose kernels take the coefficients themselves. */
+unsigned galois_matrix_table_bytes(unsigned w);
+
+/* Fills tables, galois_matrix_table_bytes(w) * k * m bytes, for the m x k
+   matrix, row-major like the matrix. */
+void galois_matrix_tables(unsigned w, const unsigned *matrix, unsigned k,
+                          unsigned m, unsigned char *tables);
+
+/* galois_wXX_matrix_region_multiply() for w = 8, 16 or 32, with tables
+   from galois_matrix_tables() for matrix (NULL for w = 32). */
+void galois_matrix_region_multiply(unsigned w, const unsigned *matrix,
+                                   const unsigned char *tables, unsigned k,
+                                   unsigned m, char **src, char **dst,
+                                   unsigned nbytes);
+
+#endif
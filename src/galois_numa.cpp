@@ -0,0 +1,64 @@
+/* galois_numa.cpp
+ *
+ * NUMA support for galois_set_numa_replicas().  Nodes come from libnuma:
+ * a thread's node is that of the CPU it last ran on, and replica memory is
+ * allocated on a node with numa_alloc_onnode(), so it is local however the
+ * pages are first touched.  Without libnuma (GALOIS_NUMA off) the library
+ * has no replicas and galois_set_numa_replicas() fails.
+ */
+
+#include <cstdlib>
+
+#ifdef GALOIS_NUMA
+#include <numa.h>
+#include <sched.h>
+#endif
+
+#include "galois.h"
+#include "galois_numa.h"
+
+std::atomic<bool> galois_numa_enabled{false};
+
+#ifdef GALOIS_NUMA
+
+/* How many galois_numa_node() calls a thread's node is cached for */
+constexpr unsigned GALOIS_NUMA_RECHECK = 4096;
+
+unsigned galois_set_numa_replicas(unsigned on) {
+    if (on && numa_available() < 0)
+        return -1;
+    galois_numa_enabled.store(on != 0, std::memory_order_relaxed);
+    return 0;
+}
+
+unsigned galois_numa_node() {
+    static thread_local unsigned calls = 0;
+    static thread_local unsigned node = GALOIS_NUMA_NODES;
+    int cpu, n;
+
+    if (calls++ % GALOIS_NUMA_RECHECK == 0) {
+        cpu = sched_getcpu();
+        n = (cpu < 0) ? -1 : numa_node_of_cpu(cpu);
+        node = (n < 0 || (unsigned)n >= GALOIS_NUMA_NODES) ? GALOIS_NUMA_NODES
+                                                           : n;
+    }
+    return node;
+}
+
+void *galois_numa_alloc(unsigned long bytes, unsigned node) {
+    return numa_alloc_onnode(bytes, node);
+}
+
+void galois_numa_free(void *p, unsigned long bytes) { numa_free(p, bytes); }
+
+#else
+
+unsigned galois_set_numa_replicas(unsigned on) { return on ? -1 : 0; }
+
+unsigned galois_numa_node() { return GALOIS_NUMA_NODES; }
+
+void *galois_numa_alloc(unsigned long, unsigned) { return NULL; }
+
+void galois_numa_free(void *, unsigned long) {}
+
+#endif
@@ -0,0 +1,32 @@
+/* galois_numa.h
+ *
+ * Internal interface to the NUMA support behind galois_set_numa_replicas()
+ * (galois_numa.cpp).  galois.cpp keeps the per-node copies of each
+ * context's tables; this file only knows about nodes and memory.
+ *
+ * This header is not installed.
+ */
+
+#ifndef GALOIS_NUMA_H
+#define GALOIS_NUMA_H
+
+#include <atomic>
+
+/* Nodes numbered this high or higher use the original tables. */
+constexpr unsigned GALOIS_NUMA_NODES = 16;
+
+/* Set while replicas are on.  Lookups test it before anything else, so
+   with replicas off they cost one relaxed load. */
+extern std::atomic<bool> galois_numa_enabled;
+
+/* The node the calling thread is running on, or GALOIS_NUMA_NODES if it
+   is unknown.  The answer is cached per thread and refreshed every so
+   many calls, so a thread that migrates is followed, if not at once. */
+unsigned galois_numa_node();
+
+/* bytes of zeroed memory on node, or NULL.  Freed with galois_numa_free()
+   and the same size. */
+void *galois_numa_alloc(unsigned long bytes, unsigned node);
+void galois_numa_free(void *p, unsigned long bytes);
+
+#endif
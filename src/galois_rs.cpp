@@ -0,0 +1,422 @@
+/* galois_rs.cpp
+ *
+ * Reed-Solomon erasure coding.  Encoding is one matrix region multiply.
+ * Decoding picks k surviving blocks, inverts the k x k matrix that maps the
+ * data to them, and folds the rows of every erased block, data or parity,
+ * into one decoding matrix over the survivors, so the rebuild is again a
+ * single matrix region multiply.  Decoding matrices are cached by erasure
+ * pattern.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "fmt/core.h"
+#include "fmt/format.h"
+#include "galois.h"
+#include "galois_matrix.h"
+#include "galois_rs.h"
+#include "galois_rs_scratch.h"
+
+struct galois_rs_code {
+    unsigned long long id; /* Unique, for the decoding matrix cache */
+    unsigned k, m, w, kind;
+    std::vector<unsigned> matrix; /* m x k coding matrix */
+    std::vector<unsigned char> tables; /* galois_matrix_tables() of matrix */
+
+    /* galois_rs_decode()'s scratch, sized at creation time */
+    galois_rs_scratch scratch;
+};
+
+void galois_rs_scratch::reserve(unsigned k, unsigned m, unsigned w) {
+    unsigned long nbytes = (unsigned long)galois_matrix_table_bytes(w) * m * k;
+
+    if (tables.size() < nbytes)
+        tables.resize(nbytes);
+    if (survivors.size() >= k && dst.size() >= m)
+        return;
+    k = std::max(k, (unsigned)survivors.size());
+    m = std::max(m, (unsigned)dst.size());
+    survivor_rows.resize(k * k);
+    inverse.resize(k * k);
+    decoding.resize(m * k);
+    survivors.resize(k);
+    is_erased.resize(k + m);
+    erased_bits.resize((k + m + 63) / 64);
+    slot.resize(k + m);
+    src.resize(k);
+    dst.resize(m);
+}
+
+static std::atomic<unsigned long long> galois_rs_next_id{1};
+
+/* The decoding matrix cache.  Rebuilds tend to see the same few erasure
+   patterns over and over, and each costs a k x k inversion, so the decoding
+   matrices are kept in a bounded LRU cache shared by all codes, keyed by
+   the code's id and a hash of the erasure bitmap.  The full bitmap is
+   stored in the entry and compared on lookup, so a hash collision is just a
+   miss.  Entries are only allocated on a miss. */
+
+struct galois_rs_decoder {
+    unsigned long long code_id;
+    std::vector<unsigned long long> erased; /* Bitmap over the k + m ids */
+    std::vector<unsigned> matrix;           /* nerased x k, rows by id */
+    std::vector<unsigned char> tables;      /* galois_matrix_tables() */
+};
+
+typedef std::shared_ptr<const galois_rs_decoder> galois_rs_decoder_ptr;
+
+struct galois_rs_cache_key {
+    unsigned long long code_id, hash;
+
+    bool operator==(const galois_rs_cache_key &o) const {
+        return code_id == o.code_id && hash == o.hash;
+    }
+};
+
+struct galois_rs_cache_hasher {
+    size_t operator()(const galois_rs_cache_key &key) const {
+        return key.hash ^ (key.code_id * 0x9e3779b97f4a7c15ULL);
+    }
+};
+
+static struct {
+    std::mutex lock;
+    unsigned capacity = 64;
+    std::list<galois_rs_decoder_ptr> lru; /* Most recently used first */
+    std::unordered_map<galois_rs_cache_key,
+                       std::list<galois_rs_decoder_ptr>::iterator,
+                       galois_rs_cache_hasher>
+        index;
+} galois_rs_cache;
+
+static unsigned long long galois_rs_hash(const unsigned long long *bits,
+                                         size_t nwords) {
+    unsigned long long h = 0xcbf29ce484222325ULL;
+    size_t i;
+
+    for (i = 0; i < nwords; i++) {
+        h ^= bits[i];
+        h *= 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+/* The caller must hold galois_rs_cache.lock. */
+static void galois_rs_cache_trim() {
+    while (galois_rs_cache.lru.size() > galois_rs_cache.capacity) {
+        const galois_rs_decoder_ptr &d = galois_rs_cache.lru.back();
+        galois_rs_cache.index.erase(
+            {d->code_id, galois_rs_hash(d->erased.data(), d->erased.size())});
+        galois_rs_cache.lru.pop_back();
+    }
+}
+
+/* The coding matrix of a systematic Vandermonde code.  Row i of the
+   (k+m) x k matrix V is (1, i, i^2, ..., i^(k-1)).  Any k rows of V are
+   independent, and that stays true when V is multiplied on the right by the
+   inverse of its top k rows, which turns those rows into the identity.  The
+   bottom m rows are then the coding matrix. */
+
+static void galois_rs_vandermonde(galois_rs_code *code) {
+    unsigned k = code->k, m = code->m, w = code->w;
+    std::vector<unsigned> v((k + m) * k), top(k * k), inv(k * k);
+    unsigned i, j, l, p, sum;
+
+    for (i = 0; i < k + m; i++) {
+        p = 1;
+        for (j = 0; j < k; j++) {
+            v[i * k + j] = p;
+            p = galois_single_multiply(p, i, w);
+        }
+    }
+
+    top.assign(v.begin(), v.begin() + k * k);
+    if (galois_invert_matrix(top.data(), inv.data(), k, w) != 0)
+        throw std::logic_error("galois_rs_create - Vandermonde matrix is "
+                               "singular");
+
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < k; j++) {
+            sum = 0;
+            for (l = 0; l < k; l++)
+                sum ^= galois_single_multiply(v[(k + i) * k + l],
+                                              inv[l * k + j], w);
+            code->matrix[i * k + j] = sum;
+        }
+    }
+}
+
+static void galois_rs_cauchy(galois_rs_code *code) {
+    unsigned k = code->k, m = code->m, w = code->w;
+    unsigned i, j;
+
+    for (i = 0; i < m; i++)
+        for (j = 0; j < k; j++)
+            code->matrix[i * k + j] = galois_inverse(i ^ (m + j), w);
+}
+
+galois_rs_code *galois_rs_create(unsigned k, unsigned m, unsigned w,
+                                 unsigned kind) {
+    galois_rs_code *code;
+
+    if (w != 8 && w != 16 && w != 32) {
+        throw std::invalid_argument(
+            fmt::format("galois_rs_create - w={} must be 8, 16 or 32", w));
+    }
+    if (k == 0 || m == 0 || (unsigned long long)k + m > (1ULL << w)) {
+        throw std::invalid_argument(fmt::format(
+            "galois_rs_create - bad k={}, m={} for w={}", k, m, w));
+    }
+    if (kind != GALOIS_RS_VANDERMONDE && kind != GALOIS_RS_CAUCHY) {
+        throw std::invalid_argument(
+            fmt::format("galois_rs_create - unknown matrix kind {}", kind));
+    }
+
+    code = new galois_rs_code;
+    code->id = galois_rs_next_id.fetch_add(1);
+    code->k = k;
+    code->m = m;
+    code->w = w;
+    code->kind = kind;
+    code->matrix.resize(m * k);
+    code->tables.resize((unsigned long)galois_matrix_table_bytes(w) * m * k);
+    code->scratch.reserve(k, m, w);
+
+    try {
+        if (kind == GALOIS_RS_VANDERMONDE)
+            galois_rs_vandermonde(code);
+        else
+            galois_rs_cauchy(code);
+        galois_matrix_tables(w, code->matrix.data(), k, m,
+                             code->tables.data());
+    } catch (...) {
+        delete code;
+        throw;
+    }
+    return code;
+}
+
+void galois_rs_free(galois_rs_code *code) {
+    std::unique_lock<std::mutex> guard(galois_rs_cache.lock);
+    auto it = galois_rs_cache.lru.begin();
+
+    while (it != galois_rs_cache.lru.end()) {
+        if ((*it)->code_id == code->id) {
+            galois_rs_cache.index.erase(
+                {code->id,
+                 galois_rs_hash((*it)->erased.data(), (*it)->erased.size())});
+            it = galois_rs_cache.lru.erase(it);
+        } else {
+            it++;
+        }
+    }
+    guard.unlock();
+    delete code;
+}
+
+const unsigned *galois_rs_get_matrix(const galois_rs_code *code) {
+    return code->matrix.data();
+}
+
+void galois_rs_get_params(const galois_rs_code *code, unsigned *k,
+                          unsigned *m, unsigned *w) {
+    *k = code->k;
+    *m = code->m;
+    *w = code->w;
+}
+
+void galois_rs_encode(const galois_rs_code *code, char **data, char **parity,
+                      unsigned nbytes) {
+    galois_matrix_region_multiply(code->w, code->matrix.data(),
+                                  code->tables.data(), code->k, code->m, data,
+                                  parity, nbytes);
+}
+
+/* Looks up the decoding matrix for the erasures in s->erased_bits,
+   returning NULL on a miss.  The shared_ptr keeps the entry alive while the
+   caller uses it, even if another thread evicts it. */
+
+static galois_rs_decoder_ptr galois_rs_cache_find(const galois_rs_code *code,
+                                                  const galois_rs_scratch *s,
+                                                  unsigned long long hash) {
+    std::lock_guard<std::mutex> guard(galois_rs_cache.lock);
+    auto it = galois_rs_cache.index.find({code->id, hash});
+
+    if (it == galois_rs_cache.index.end() ||
+        !std::equal(s->erased_bits.begin(),
+                     s->erased_bits.begin() + (*it->second)->erased.size(),
+                     (*it->second)->erased.begin()))
+        return NULL;
+    galois_rs_cache.lru.splice(galois_rs_cache.lru.begin(),
+                               galois_rs_cache.lru, it->second);
+    return *it->second;
+}
+
+static void galois_rs_cache_insert(const galois_rs_code *code,
+                                   const galois_rs_scratch *s,
+                                   unsigned long long hash, unsigned nerased) {
+    std::lock_guard<std::mutex> guard(galois_rs_cache.lock);
+    galois_rs_cache_key key = {code->id, hash};
+    unsigned w = code->w;
+    auto it = galois_rs_cache.index.find(key);
+
+    if (galois_rs_cache.capacity == 0)
+        return;
+    if (it != galois_rs_cache.index.end()) {
+        galois_rs_cache.lru.erase(it->second);
+        galois_rs_cache.index.erase(it);
+    }
+
+    auto d = std::make_shared<galois_rs_decoder>();
+    d->code_id = code->id;
+    d->erased.assign(s->erased_bits.begin(),
+                     s->erased_bits.begin() + (code->k + code->m + 63) / 64);
+    d->matrix.assign(s->decoding.begin(),
+                     s->decoding.begin() + nerased * code->k);
+    d->tables.assign(s->tables.begin(),
+                     s->tables.begin() + (unsigned long)nerased * code->k *
+                                             galois_matrix_table_bytes(w));
+    galois_rs_cache.lru.push_front(d);
+    galois_rs_cache.index[key] = galois_rs_cache.lru.begin();
+    galois_rs_cache_trim();
+}
+
+void galois_rs_set_cache_size(unsigned entries) {
+    std::lock_guard<std::mutex> guard(galois_rs_cache.lock);
+
+    galois_rs_cache.capacity = entries;
+    galois_rs_cache_trim();
+}
+
+unsigned galois_rs_decode_scratch(const galois_rs_code *code,
+                                  galois_rs_scratch *s, char **blocks,
+                                  const unsigned *erased, unsigned nerased,
+                                  char **out, unsigned nbytes) {
+    unsigned k = code->k, m = code->m, w = code->w;
+    unsigned nwords = (k + m + 63) / 64;
+    unsigned long row_bytes = (unsigned long)galois_matrix_table_bytes(w) * k;
+    unsigned *rows, *inv, *dec;
+    unsigned i, j, l, id, sum;
+    unsigned long long hash;
+    galois_rs_decoder_ptr cached;
+    bool data_lost;
+
+    if (nerased > m)
+        return -1;
+    if (nerased == 0)
+        return 0;
+
+    s->reserve(k, m, w);
+    rows = s->survivor_rows.data();
+    inv = s->inverse.data();
+    dec = s->decoding.data();
+
+    std::fill(s->is_erased.begin(), s->is_erased.begin() + k + m, 0);
+    std::fill(s->erased_bits.begin(), s->erased_bits.begin() + nwords, 0ULL);
+    data_lost = false;
+    for (i = 0; i < nerased; i++) {
+        id = erased[i];
+        if (id >= k + m || s->is_erased[id])
+            return -1;
+        s->is_erased[id] = 1;
+        s->erased_bits[id / 64] |= 1ULL << (id % 64);
+        s->slot[id] = i;
+        if (id < k)
+            data_lost = true;
+    }
+
+    /* The first k surviving ids are the sources, and the outputs are
+       ordered by id, so that the decoding matrix only depends on which
+       blocks are lost.  With no data lost the sources are the data blocks
+       themselves. */
+
+    for (i = 0, id = 0; i < k; id++) {
+        if (!s->is_erased[id]) {
+            s->survivors[i] = id;
+            s->src[i] = blocks[id];
+            i++;
+        }
+    }
+    for (i = 0, id = 0; i < nerased; id++)
+        if (s->is_erased[id])
+            s->dst[i++] = out[s->slot[id]];
+
+    if (!data_lost) {
+        for (i = 0, id = k; i < nerased; id++) {
+            if (s->is_erased[id]) {
+                std::copy(code->matrix.begin() + (id - k) * k,
+                          code->matrix.begin() + (id - k + 1) * k,
+                          dec + i * k);
+                std::copy(code->tables.begin() + (id - k) * row_bytes,
+                          code->tables.begin() + (id - k + 1) * row_bytes,
+                          s->tables.begin() + i * row_bytes);
+                i++;
+            }
+        }
+        galois_matrix_region_multiply(w, dec, s->tables.data(), k, nerased,
+                                      s->src.data(), s->dst.data(), nbytes);
+        return 0;
+    }
+
+    hash = galois_rs_hash(s->erased_bits.data(), nwords);
+    cached = galois_rs_cache_find(code, s, hash);
+    if (cached != NULL) {
+        galois_matrix_region_multiply(w, cached->matrix.data(),
+                                      cached->tables.data(), k, nerased,
+                                      s->src.data(), s->dst.data(), nbytes);
+        return 0;
+    }
+
+    /* inv maps the survivors back to the data. */
+
+    for (i = 0; i < k; i++) {
+        id = s->survivors[i];
+        for (j = 0; j < k; j++)
+            rows[i * k + j] =
+                (id < k) ? (id == j) : code->matrix[(id - k) * k + j];
+    }
+    if (galois_invert_matrix(rows, inv, k, w) != 0)
+        return -1;
+
+    /* Each row of dec rebuilds one lost block from the survivors:  a row of
+       inv for a data block, and the block's coding row times inv for a
+       parity block. */
+
+    for (i = 0, id = 0; i < nerased; id++) {
+        if (!s->is_erased[id])
+            continue;
+        if (id < k) {
+            std::copy(inv + id * k, inv + (id + 1) * k, dec + i * k);
+        } else {
+            for (j = 0; j < k; j++) {
+                sum = 0;
+                for (l = 0; l < k; l++)
+                    sum ^= galois_single_multiply(
+                        code->matrix[(id - k) * k + l], inv[l * k + j], w);
+                dec[i * k + j] = sum;
+            }
+        }
+        i++;
+    }
+
+    galois_matrix_tables(w, dec, k, nerased, s->tables.data());
+    galois_rs_cache_insert(code, s, hash, nerased);
+    galois_matrix_region_multiply(w, dec, s->tables.data(), k, nerased,
+                                  s->src.data(), s->dst.data(), nbytes);
+    return 0;
+}
+
+unsigned galois_rs_decode(galois_rs_code *code, char **blocks,
+                          const unsigned *erased, unsigned nerased,
+                          char **out, unsigned nbytes) {
+    return galois_rs_decode_scratch(code, &code->scratch, blocks, erased,
+                                    nerased, out, nbytes);
+}
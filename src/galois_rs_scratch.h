@@ -0,0 +1,45 @@
+/* galois_rs_scratch.h
+ *
+ * Internal interface to Reed-Solomon decoding with caller-owned scratch
+ * (galois_rs.cpp).  galois_rs_decode() uses the scratch inside the code,
+ * which is why a code can only be decoded by one thread at a time; the job
+ * engine (galois_jobs.cpp) gives each worker its own scratch instead, so
+ * its workers can decode with the same code at once.
+ *
+ * This header is not installed.
+ */
+
+#ifndef GALOIS_RS_SCRATCH_H
+#define GALOIS_RS_SCRATCH_H
+
+#include <vector>
+
+#include "galois_rs.h"
+
+/* Everything a decode writes.  It only grows, so once it has been used
+   with the largest code it sees, decoding allocates only on cache misses,
+   as galois_rs_decode() does. */
+struct galois_rs_scratch {
+    std::vector<unsigned> survivor_rows;  /* k x k */
+    std::vector<unsigned> inverse;        /* k x k */
+    std::vector<unsigned> decoding;       /* m x k */
+    std::vector<unsigned> survivors;      /* k ids */
+    std::vector<unsigned char> is_erased; /* k + m flags */
+    std::vector<unsigned long long> erased_bits; /* The same, as a bitmap */
+    std::vector<unsigned> slot;           /* Index in erased[] by id */
+    std::vector<char *> src;              /* k regions */
+    std::vector<char *> dst;              /* m regions */
+    std::vector<unsigned char> tables;    /* galois_matrix_tables() of
+                                             decoding */
+
+    /* Makes room for a code with k data and m parity blocks in GF(2^w). */
+    void reserve(unsigned k, unsigned m, unsigned w);
+};
+
+/* galois_rs_decode(), with s in place of the code's own scratch. */
+unsigned galois_rs_decode_scratch(const galois_rs_code *code,
+                                  galois_rs_scratch *s, char **blocks,
+                                  const unsigned *erased, unsigned nerased,
+                                  char **out, unsigned nbytes);
+
+#endif
@@ -0,0 +1,2404 @@
+/* galois_simd.cpp
+ *
+ * Vectorized region kernels and the CPU dispatch that picks between them.
+ *
+ * The w = 8 kernels use the "split nibble" technique: a product multby * x is
+ * the XOR of multby * (x & 0xf) and multby * (x & 0xf0), and each of those
+ * has only 16 possible values.  Two 16-entry tables fit in a vector register,
+ * so a byte shuffle (pshufb) performs 16, 32 or 64 table lookups at once.
+ *
+ * w = 16 works the same way with four nibbles per word.  Each 16-entry table
+ * of 16-bit products is stored as a table of low bytes and a table of high
+ * bytes, and the source words are split into a vector of low bytes and a
+ * vector of high bytes with pack instructions, so eight shuffles produce
+ * the products of 16 (32, 64) words.  Unpacking the two result vectors puts
+ * the words back in their original order.
+ *
+ * w = 32 regions split each source word into eight nibbles the same way,
+ * with 512 bytes of tables per multiplier.  The words are transposed in
+ * registers into four planes of bytes of equal significance, so that each
+ * shuffle looks up one nibble of 16 words and yields one byte of their
+ * products; 32 shuffles multiply 16 (32, 64) words.  Regions kept in the
+ * altmap layout are stored as planes and skip the transposes.
+ *
+ * Single w = 32 products, the batch and the dot-product kernels use
+ * carry-less multiplication (pclmulqdq) when the CPU has it.  The 64-bit
+ * product c = H x^32 + L is reduced with Barrett's method:
+ * Q = floor(H mu / x^32) is the exact quotient of c by the field polynomial
+ * P = x^32 + poly, so c mod P = L ^ low32(Q poly).  That is three carry-less
+ * multiplies per word and no tables at all.
+ *
+ * GF(2^64) and GF(2^128) also multiply carry-less, and fold the high half
+ * of each product down with multiplies by their small polynomials.  With
+ * VPCLMULQDQ the region kernels do four 128-bit lanes per instruction.
+ *
+ * The batch kernels multiply element by element, so there is no fixed
+ * multiplier to build nibble tables for.  w = 8 and 16 look up logs and
+ * antilogs with AVX2/AVX-512 gathers, 8 or 16 elements at a time, and w = 32
+ * uses the same carry-less multiply as the region kernels, two products
+ * per pclmulqdq pair.
+ *
+ * The multi-source XOR kernels keep four vectors of the destination in
+ * registers and XOR every source into them before storing, so the
+ * destination is written once however many sources there are.  Their
+ * streaming mode aligns the destination and then uses non-temporal stores,
+ * which go around the cache.
+ *
+ * Every kernel is compiled with a function-level target attribute, so the
+ * library itself does not have to be built with -mavx2 and friends.  The
+ * dispatch table is filled in once at load time from cpuid.
+ */
+
+#include <cstring>
+
+#include "galois.h"
+#include "galois_simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GALOIS_X86 1
+#include <immintrin.h>
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Portable kernels                                                        */
+/* ---------------------------------------------------------------------- */
+
+/* Expand the two nibble tables into a full 256-entry product row.  This costs
+   256 XORs, and then each byte is a single lookup into a 256 byte row, which
+   stays in L1 no matter what the other tables are doing. */
+
+static void w08_scalar(const unsigned char *src, unsigned char *dst,
+                       unsigned long nbytes, const unsigned char *tables,
+                       unsigned add) {
+    unsigned char row[256];
+    unsigned long i, j, l;
+    unsigned char *lp;
+
+    for (i = 0; i < 256; i++)
+        row[i] = tables[i & 0xf] ^ tables[16 + (i >> 4)];
+
+    /* Assemble a long word at a time so that the add case does one
+       load/xor/store per word rather than per byte. */
+    lp = (unsigned char *)&l;
+    for (i = 0; i + sizeof(long) <= nbytes; i += sizeof(long)) {
+        for (j = 0; j < sizeof(long); j++)
+            lp[j] = row[src[i + j]];
+        if (add) {
+            unsigned long d;
+            memcpy(&d, dst + i, sizeof(long));
+            l ^= d;
+        }
+        memcpy(dst + i, &l, sizeof(long));
+    }
+    for (; i < nbytes; i++)
+        dst[i] = add ? (dst[i] ^ row[src[i]]) : row[src[i]];
+}
+
+/* Used for the words left over after the vector loop. */
+
+static void w16_split_scalar(const unsigned short *src, unsigned short *dst,
+                             unsigned long nwords, const unsigned char *tables,
+                             unsigned add) {
+    unsigned long i;
+    unsigned x, k, n, prod;
+
+    for (i = 0; i < nwords; i++) {
+        x = src[i];
+        prod = 0;
+        for (k = 0; k < 4; k++) {
+            n = (x >> (4 * k)) & 0xf;
+            prod ^= tables[32 * k + n] | (tables[32 * k + 16 + n] << 8);
+        }
+        dst[i] = add ? (dst[i] ^ prod) : prod;
+    }
+}
+
+/* w = 32 split-4 (see galois_simd.h).  Expanded to whole words, the tables
+   are eight 16-entry tables, one per nibble of the source word, and a
+   product is eight lookups and seven XORs. */
+
+static void w32_split_expand(const unsigned char *tables, unsigned t[8][16]) {
+    unsigned k, n;
+
+    for (k = 0; k < 8; k++) {
+        for (n = 0; n < 16; n++) {
+            t[k][n] = tables[64 * k + n] | (tables[64 * k + 16 + n] << 8) |
+                      (tables[64 * k + 32 + n] << 16) |
+                      ((unsigned)tables[64 * k + 48 + n] << 24);
+        }
+    }
+}
+
+static inline unsigned w32_split_word(const unsigned (*t)[16], unsigned x) {
+    unsigned prod, k;
+
+    prod = 0;
+    for (k = 0; k < 8; k++)
+        prod ^= t[k][(x >> (4 * k)) & 0xf];
+    return prod;
+}
+
+static void w32_split_scalar(const unsigned *src, unsigned *dst,
+                             unsigned long nwords, const unsigned char *tables,
+                             unsigned add) {
+    unsigned t[8][16];
+    unsigned long i;
+    unsigned prod;
+
+    w32_split_expand(tables, t);
+    for (i = 0; i < nwords; i++) {
+        prod = w32_split_word(t, src[i]);
+        dst[i] = add ? (dst[i] ^ prod) : prod;
+    }
+}
+
+/* Each word is gathered from its block's four planes, multiplied and
+   scattered back, so src and dst may still be equal. */
+
+static void w32_altmap_scalar(const unsigned *src, unsigned *dst,
+                              unsigned long nwords,
+                              const unsigned char *tables, unsigned add) {
+    unsigned t[8][16];
+    const unsigned char *s;
+    unsigned char *d;
+    unsigned long i;
+    unsigned j, b, x, prod;
+
+    w32_split_expand(tables, t);
+    for (i = 0; i + 16 <= nwords; i += 16) {
+        s = (const unsigned char *)(src + i);
+        d = (unsigned char *)(dst + i);
+        for (j = 0; j < 16; j++) {
+            x = s[j] | (s[16 + j] << 8) | (s[32 + j] << 16) |
+                ((unsigned)s[48 + j] << 24);
+            prod = w32_split_word(t, x);
+            for (b = 0; b < 4; b++) {
+                d[16 * b + j] = add ? (d[16 * b + j] ^ (prod >> (8 * b)))
+                                    : (prod >> (8 * b));
+            }
+        }
+    }
+    if (i < nwords)
+        w32_split_scalar(src + i, dst + i, nwords - i, tables, add);
+}
+
+/* Tails of the dot-product kernels: elements start .. end-1. */
+
+static void w08_dot_scalar(const unsigned char *const *src, unsigned nsrc,
+                           unsigned char *const *dst, unsigned ndst,
+                           const unsigned char *tables, unsigned long start,
+                           unsigned long end) {
+    const unsigned char *t;
+    unsigned long i;
+    unsigned j, n, x, acc;
+
+    for (i = start; i < end; i++) {
+        for (n = 0; n < ndst; n++) {
+            acc = 0;
+            for (j = 0; j < nsrc; j++) {
+                t = tables + 32 * (n * nsrc + j);
+                x = src[j][i];
+                acc ^= t[x & 0xf] ^ t[16 + (x >> 4)];
+            }
+            dst[n][i] = acc;
+        }
+    }
+}
+
+static void w16_dot_scalar(const unsigned short *const *src, unsigned nsrc,
+                           unsigned short *const *dst, unsigned ndst,
+                           const unsigned char *tables, unsigned long start,
+                           unsigned long end) {
+    const unsigned char *t;
+    unsigned long i;
+    unsigned j, n, k, x, nib, acc;
+
+    for (i = start; i < end; i++) {
+        for (n = 0; n < ndst; n++) {
+            acc = 0;
+            for (j = 0; j < nsrc; j++) {
+                t = tables + 128 * (n * nsrc + j);
+                x = src[j][i];
+                for (k = 0; k < 4; k++) {
+                    nib = (x >> (4 * k)) & 0xf;
+                    acc ^= t[32 * k + nib] | (t[32 * k + 16 + nib] << 8);
+                }
+            }
+            dst[n][i] = acc;
+        }
+    }
+}
+
+/* r3 = r1 ^ r2, a long word at a time.  r3 may be r1 or r2. */
+
+static void xor_scalar(const unsigned char *r1, const unsigned char *r2,
+                       unsigned char *r3, unsigned long nbytes) {
+    unsigned long i, a, b;
+
+    for (i = 0; i + sizeof(long) <= nbytes; i += sizeof(long)) {
+        memcpy(&a, r1 + i, sizeof(long));
+        memcpy(&b, r2 + i, sizeof(long));
+        a ^= b;
+        memcpy(r3 + i, &a, sizeof(long));
+    }
+    for (; i < nbytes; i++)
+        r3[i] = r1[i] ^ r2[i];
+}
+
+/* dst[i] = src[0][i] ^ ... ^ src[nsrc - 1][i] for from <= i < to:  the
+   heads and tails of the multi-source XOR kernels. */
+
+static void xor_n_bytes(const unsigned char *const *src, unsigned nsrc,
+                        unsigned char *dst, unsigned long from,
+                        unsigned long to) {
+    unsigned long i;
+    unsigned char c;
+    unsigned s;
+
+    for (i = from; i < to; i++) {
+        c = src[0][i];
+        for (s = 1; s < nsrc; s++)
+            c ^= src[s][i];
+        dst[i] = c;
+    }
+}
+
+static void xor_n_scalar(const unsigned char *const *src, unsigned nsrc,
+                         unsigned char *dst, unsigned long nbytes,
+                         unsigned stream) {
+    unsigned long i, a[4], b[4];
+    unsigned s, j;
+
+    (void)stream;
+    for (i = 0; i + sizeof(a) <= nbytes; i += sizeof(a)) {
+        memcpy(a, src[0] + i, sizeof(a));
+        for (s = 1; s < nsrc; s++) {
+            memcpy(b, src[s] + i, sizeof(b));
+            for (j = 0; j < 4; j++)
+                a[j] ^= b[j];
+        }
+        memcpy(dst + i, a, sizeof(a));
+    }
+    xor_n_bytes(src, nsrc, dst, i, nbytes);
+}
+
+/* Element-wise log/antilog arithmetic for w = 8 and 16; also the tails of
+   the gather kernels. */
+
+template <class T>
+static void log_batch_scalar(const T *x, const T *y, T *out, unsigned long n,
+                             const T *log, const T *ilog, unsigned divide) {
+    const unsigned nwm1 = (T)-1;
+    unsigned long i;
+    unsigned a, b;
+
+    for (i = 0; i < n; i++) {
+        a = (x == NULL) ? 1 : x[i];
+        b = y[i];
+        if (divide) {
+            if (b == 0)
+                out[i] = (T)-1;
+            else
+                out[i] = (a == 0) ? 0 : ilog[log[a] + nwm1 - log[b]];
+        } else {
+            out[i] = (a == 0 || b == 0) ? 0 : ilog[log[a] + log[b]];
+        }
+    }
+}
+
+static void w08_batch_scalar(const unsigned char *x, const unsigned char *y,
+                             unsigned char *out, unsigned long n,
+                             const unsigned char *log,
+                             const unsigned char *ilog, unsigned divide) {
+    log_batch_scalar(x, y, out, n, log, ilog, divide);
+}
+
+static void w16_batch_scalar(const unsigned short *x, const unsigned short *y,
+                             unsigned short *out, unsigned long n,
+                             const unsigned short *log,
+                             const unsigned short *ilog, unsigned divide) {
+    log_batch_scalar(x, y, out, n, log, ilog, divide);
+}
+
+/* GF(2^64) and GF(2^128) without carry-less multiply.  A single product
+   shifts through the bits of x.  The region and mac kernels have a fixed
+   multiplier, so they build its 4-bit split tables,
+   t[16k + n] = multby * (n << 4k), and look up each nibble of each
+   element, as the w = 16 kernels do. */
+
+static inline galois_w128 operator^(galois_w128 a, galois_w128 b) {
+    return galois_w128{a.lo ^ b.lo, a.hi ^ b.hi};
+}
+
+static inline unsigned long long w64_times_x(unsigned long long a) {
+    return (a << 1) ^ ((0 - (a >> 63)) & GALOIS_W64_POLY);
+}
+
+static inline galois_w128 w128_times_x(galois_w128 a) {
+    galois_w128 r;
+
+    r.hi = (a.hi << 1) | (a.lo >> 63);
+    r.lo = (a.lo << 1) ^ ((0 - (a.hi >> 63)) & GALOIS_W128_POLY);
+    return r;
+}
+
+static unsigned long long w64_multiply_scalar(unsigned long long x,
+                                              unsigned long long y) {
+    unsigned long long r;
+    int i;
+
+    r = 0;
+    for (i = 63; i >= 0; i--)
+        r = w64_times_x(r) ^ ((0 - ((x >> i) & 1)) & y);
+    return r;
+}
+
+static galois_w128 w128_multiply_scalar(galois_w128 x, galois_w128 y) {
+    unsigned long long bit;
+    galois_w128 r;
+    int i;
+
+    r.lo = r.hi = 0;
+    for (i = 127; i >= 0; i--) {
+        r = w128_times_x(r);
+        bit = 0 - ((((i >= 64) ? x.hi : x.lo) >> (i & 63)) & 1);
+        r.lo ^= bit & y.lo;
+        r.hi ^= bit & y.hi;
+    }
+    return r;
+}
+
+template <class T, class F>
+static void wide_split_tables(T multby, T *t, unsigned nnibbles, F times_x) {
+    unsigned k, b, n;
+
+    for (k = 0; k < nnibbles; k++, t += 16) {
+        t[0] = T();
+        for (b = 1; b < 16; b <<= 1) {
+            for (n = 0; n < b; n++)
+                t[b + n] = t[n] ^ multby;
+            multby = times_x(multby);
+        }
+    }
+}
+
+static inline unsigned long long w64_split_multiply(
+    const unsigned long long *t, unsigned long long x) {
+    unsigned long long r;
+    unsigned k;
+
+    r = 0;
+    for (k = 0; k < 16; k++, x >>= 4)
+        r ^= t[16 * k + (x & 0xf)];
+    return r;
+}
+
+static inline galois_w128 w128_split_multiply(const galois_w128 *t,
+                                              galois_w128 x) {
+    galois_w128 r;
+    unsigned k;
+
+    r.lo = r.hi = 0;
+    for (k = 0; k < 16; k++, x.lo >>= 4, x.hi >>= 4) {
+        r = r ^ t[16 * k + (x.lo & 0xf)];
+        r = r ^ t[16 * (k + 16) + (x.hi & 0xf)];
+    }
+    return r;
+}
+
+static void w64_scalar(const unsigned long long *src, unsigned long long *dst,
+                       unsigned long n, unsigned long long multby,
+                       unsigned add) {
+    unsigned long long t[16 * 16], prod;
+    unsigned long i;
+
+    wide_split_tables(multby, t, 16, w64_times_x);
+    for (i = 0; i < n; i++) {
+        prod = w64_split_multiply(t, src[i]);
+        dst[i] = add ? (dst[i] ^ prod) : prod;
+    }
+}
+
+static unsigned long long w64_mac_scalar(const unsigned long long *src,
+                                         unsigned long n, unsigned long long h,
+                                         unsigned long long acc) {
+    unsigned long long t[16 * 16];
+    unsigned long i;
+
+    wide_split_tables(h, t, 16, w64_times_x);
+    for (i = 0; i < n; i++)
+        acc = w64_split_multiply(t, acc ^ src[i]);
+    return acc;
+}
+
+static void w128_scalar(const galois_w128 *src, galois_w128 *dst,
+                        unsigned long n, galois_w128 multby, unsigned add) {
+    galois_w128 t[32 * 16], prod;
+    unsigned long i;
+
+    wide_split_tables(multby, t, 32, w128_times_x);
+    for (i = 0; i < n; i++) {
+        prod = w128_split_multiply(t, src[i]);
+        dst[i] = add ? (dst[i] ^ prod) : prod;
+    }
+}
+
+static galois_w128 w128_mac_scalar(const galois_w128 *src, unsigned long n,
+                                   galois_w128 h, galois_w128 acc) {
+    galois_w128 t[32 * 16];
+    unsigned long i;
+
+    wide_split_tables(h, t, 32, w128_times_x);
+    for (i = 0; i < n; i++)
+        acc = w128_split_multiply(t, acc ^ src[i]);
+    return acc;
+}
+
+#ifdef GALOIS_X86
+
+/* ---------------------------------------------------------------------- */
+/* SSSE3                                                                   */
+/* ---------------------------------------------------------------------- */
+
+__attribute__((target("ssse3"))) static void
+w08_ssse3(const unsigned char *src, unsigned char *dst, unsigned long nbytes,
+          const unsigned char *tables, unsigned add) {
+    __m128i tlo, thi, mask, v, lo, hi, p;
+    unsigned long i;
+
+    tlo = _mm_loadu_si128((const __m128i *)tables);
+    thi = _mm_loadu_si128((const __m128i *)(tables + 16));
+    mask = _mm_set1_epi8(0x0f);
+
+    for (i = 0; i + 16 <= nbytes; i += 16) {
+        v = _mm_loadu_si128((const __m128i *)(src + i));
+        lo = _mm_and_si128(v, mask);
+        hi = _mm_and_si128(_mm_srli_epi64(v, 4), mask);
+        p = _mm_xor_si128(_mm_shuffle_epi8(tlo, lo), _mm_shuffle_epi8(thi, hi));
+        if (add)
+            p = _mm_xor_si128(p, _mm_loadu_si128((const __m128i *)(dst + i)));
+        _mm_storeu_si128((__m128i *)(dst + i), p);
+    }
+    if (i < nbytes)
+        w08_scalar(src + i, dst + i, nbytes - i, tables, add);
+}
+
+__attribute__((target("ssse3"))) static void
+w16_ssse3(const unsigned short *src, unsigned short *dst, unsigned long nwords,
+          const unsigned char *tables, unsigned add) {
+    __m128i tl[4], th[4], mask, bmask, a, b, lo, hi, n, rlo, rhi;
+    unsigned long i;
+    int k;
+
+    for (k = 0; k < 4; k++) {
+        tl[k] = _mm_loadu_si128((const __m128i *)(tables + 32 * k));
+        th[k] = _mm_loadu_si128((const __m128i *)(tables + 32 * k + 16));
+    }
+    mask = _mm_set1_epi8(0x0f);
+    bmask = _mm_set1_epi16(0x00ff);
+
+    for (i = 0; i + 16 <= nwords; i += 16) {
+        a = _mm_loadu_si128((const __m128i *)(src + i));
+        b = _mm_loadu_si128((const __m128i *)(src + i + 8));
+        lo = _mm_packus_epi16(_mm_and_si128(a, bmask), _mm_and_si128(b, bmask));
+        hi = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+
+        n = _mm_and_si128(lo, mask);
+        rlo = _mm_shuffle_epi8(tl[0], n);
+        rhi = _mm_shuffle_epi8(th[0], n);
+        n = _mm_and_si128(_mm_srli_epi64(lo, 4), mask);
+        rlo = _mm_xor_si128(rlo, _mm_shuffle_epi8(tl[1], n));
+        rhi = _mm_xor_si128(rhi, _mm_shuffle_epi8(th[1], n));
+        n = _mm_and_si128(hi, mask);
+        rlo = _mm_xor_si128(rlo, _mm_shuffle_epi8(tl[2], n));
+        rhi = _mm_xor_si128(rhi, _mm_shuffle_epi8(th[2], n));
+        n = _mm_and_si128(_mm_srli_epi64(hi, 4), mask);
+        rlo = _mm_xor_si128(rlo, _mm_shuffle_epi8(tl[3], n));
+        rhi = _mm_xor_si128(rhi, _mm_shuffle_epi8(th[3], n));
+
+        a = _mm_unpacklo_epi8(rlo, rhi);
+        b = _mm_unpackhi_epi8(rlo, rhi);
+        if (add) {
+            a = _mm_xor_si128(a, _mm_loadu_si128((const __m128i *)(dst + i)));
+            b = _mm_xor_si128(b,
+                              _mm_loadu_si128((const __m128i *)(dst + i + 8)));
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), a);
+        _mm_storeu_si128((__m128i *)(dst + i + 8), b);
+    }
+    if (i < nwords)
+        w16_split_scalar(src + i, dst + i, nwords - i, tables, add);
+}
+
+/* w = 32 split-4 works on byte planes:  plane b holds byte b of 16 words,
+   so nibble 2b and 2b + 1 of every word are in plane b, and the lookups for
+   one nibble give byte 0 .. 3 of its products in planes 0 .. 3.  Standard
+   regions are turned into planes in registers:  a byte shuffle gathers
+   each byte of the four words in a vector together, and a 4 x 4 transpose
+   of 32-bit elements across four vectors finishes the job.  Both steps are
+   their own inverses, so the way back is the transpose and then the
+   shuffle.  Altmap regions are stored as planes. */
+
+__attribute__((target("ssse3"))) static inline void
+w32_transpose_ssse3(__m128i *v) {
+    __m128i t0, t1, t2, t3;
+
+    t0 = _mm_unpacklo_epi32(v[0], v[1]);
+    t1 = _mm_unpacklo_epi32(v[2], v[3]);
+    t2 = _mm_unpackhi_epi32(v[0], v[1]);
+    t3 = _mm_unpackhi_epi32(v[2], v[3]);
+    v[0] = _mm_unpacklo_epi64(t0, t1);
+    v[1] = _mm_unpackhi_epi64(t0, t1);
+    v[2] = _mm_unpacklo_epi64(t2, t3);
+    v[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+/* p = the products of the planes p.  t[4k + b] holds byte b of the
+   products for nibble k. */
+__attribute__((target("ssse3"))) static inline void
+w32_split_planes_ssse3(const __m128i *t, __m128i *p, __m128i mask) {
+    __m128i r[4], lo, hi;
+    int j, b;
+
+    for (b = 0; b < 4; b++)
+        r[b] = _mm_setzero_si128();
+    for (j = 0; j < 4; j++) {
+        lo = _mm_and_si128(p[j], mask);
+        hi = _mm_and_si128(_mm_srli_epi64(p[j], 4), mask);
+        for (b = 0; b < 4; b++) {
+            r[b] = _mm_xor_si128(r[b], _mm_shuffle_epi8(t[8 * j + b], lo));
+            r[b] = _mm_xor_si128(r[b],
+                                 _mm_shuffle_epi8(t[8 * j + 4 + b], hi));
+        }
+    }
+    for (b = 0; b < 4; b++)
+        p[b] = r[b];
+}
+
+__attribute__((target("ssse3"))) static void
+w32_split_ssse3(const unsigned *src, unsigned *dst, unsigned long nwords,
+                const unsigned char *tables, unsigned add) {
+    __m128i t[32], v[4], mask, shuf;
+    unsigned long i;
+    int r;
+
+    for (r = 0; r < 32; r++)
+        t[r] = _mm_loadu_si128((const __m128i *)(tables + 16 * r));
+    mask = _mm_set1_epi8(0x0f);
+    shuf = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+
+    for (i = 0; i + 16 <= nwords; i += 16) {
+        for (r = 0; r < 4; r++) {
+            v[r] = _mm_shuffle_epi8(
+                _mm_loadu_si128((const __m128i *)(src + i + 4 * r)), shuf);
+        }
+        w32_transpose_ssse3(v);
+        w32_split_planes_ssse3(t, v, mask);
+        w32_transpose_ssse3(v);
+        for (r = 0; r < 4; r++) {
+            v[r] = _mm_shuffle_epi8(v[r], shuf);
+            if (add) {
+                v[r] = _mm_xor_si128(
+                    v[r], _mm_loadu_si128((const __m128i *)(dst + i + 4 * r)));
+            }
+            _mm_storeu_si128((__m128i *)(dst + i + 4 * r), v[r]);
+        }
+    }
+    if (i < nwords)
+        w32_split_scalar(src + i, dst + i, nwords - i, tables, add);
+}
+
+__attribute__((target("ssse3"))) static void
+w32_altmap_ssse3(const unsigned *src, unsigned *dst, unsigned long nwords,
+                 const unsigned char *tables, unsigned add) {
+    __m128i t[32], v[4], mask;
+    unsigned long i;
+    int r;
+
+    for (r = 0; r < 32; r++)
+        t[r] = _mm_loadu_si128((const __m128i *)(tables + 16 * r));
+    mask = _mm_set1_epi8(0x0f);
+
+    for (i = 0; i + 16 <= nwords; i += 16) {
+        for (r = 0; r < 4; r++)
+            v[r] = _mm_loadu_si128((const __m128i *)(src + i + 4 * r));
+        w32_split_planes_ssse3(t, v, mask);
+        for (r = 0; r < 4; r++) {
+            if (add) {
+                v[r] = _mm_xor_si128(
+                    v[r], _mm_loadu_si128((const __m128i *)(dst + i + 4 * r)));
+            }
+            _mm_storeu_si128((__m128i *)(dst + i + 4 * r), v[r]);
+        }
+    }
+    if (i < nwords)
+        w32_split_scalar(src + i, dst + i, nwords - i, tables, add);
+}
+
+
+/* Plain XOR only needs SSE2, which every x86-64 CPU has, but it goes with
+   the SSSE3 table since that is the lowest vector level. */
+
+__attribute__((target("sse2"))) static void
+xor_sse2(const unsigned char *r1, const unsigned char *r2, unsigned char *r3,
+         unsigned long nbytes) {
+    __m128i a0, a1, b0, b1;
+    unsigned long i;
+
+    for (i = 0; i + 32 <= nbytes; i += 32) {
+        a0 = _mm_loadu_si128((const __m128i *)(r1 + i));
+        a1 = _mm_loadu_si128((const __m128i *)(r1 + i + 16));
+        b0 = _mm_loadu_si128((const __m128i *)(r2 + i));
+        b1 = _mm_loadu_si128((const __m128i *)(r2 + i + 16));
+        _mm_storeu_si128((__m128i *)(r3 + i), _mm_xor_si128(a0, b0));
+        _mm_storeu_si128((__m128i *)(r3 + i + 16), _mm_xor_si128(a1, b1));
+    }
+    if (i < nbytes)
+        xor_scalar(r1 + i, r2 + i, r3 + i, nbytes - i);
+}
+
+/* The number of bytes before p reaches an align-byte boundary, at most
+   nbytes. */
+static inline unsigned long xor_n_head(const unsigned char *p,
+                                       unsigned long align,
+                                       unsigned long nbytes) {
+    unsigned long head = (0 - (unsigned long)p) & (align - 1);
+    return (head < nbytes) ? head : nbytes;
+}
+
+__attribute__((target("sse2"))) static void
+xor_n_sse2(const unsigned char *const *src, unsigned nsrc, unsigned char *dst,
+           unsigned long nbytes, unsigned stream) {
+    __m128i a0, a1, a2, a3;
+    const unsigned char *p;
+    unsigned long i;
+    unsigned s;
+
+    i = stream ? xor_n_head(dst, 16, nbytes) : 0;
+    xor_n_bytes(src, nsrc, dst, 0, i);
+
+    for (; i + 64 <= nbytes; i += 64) {
+        p = src[0] + i;
+        a0 = _mm_loadu_si128((const __m128i *)p);
+        a1 = _mm_loadu_si128((const __m128i *)(p + 16));
+        a2 = _mm_loadu_si128((const __m128i *)(p + 32));
+        a3 = _mm_loadu_si128((const __m128i *)(p + 48));
+        for (s = 1; s < nsrc; s++) {
+            p = src[s] + i;
+            a0 = _mm_xor_si128(a0, _mm_loadu_si128((const __m128i *)p));
+            a1 = _mm_xor_si128(a1, _mm_loadu_si128((const __m128i *)(p + 16)));
+            a2 = _mm_xor_si128(a2, _mm_loadu_si128((const __m128i *)(p + 32)));
+            a3 = _mm_xor_si128(a3, _mm_loadu_si128((const __m128i *)(p + 48)));
+        }
+        if (stream) {
+            _mm_stream_si128((__m128i *)(dst + i), a0);
+            _mm_stream_si128((__m128i *)(dst + i + 16), a1);
+            _mm_stream_si128((__m128i *)(dst + i + 32), a2);
+            _mm_stream_si128((__m128i *)(dst + i + 48), a3);
+        } else {
+            _mm_storeu_si128((__m128i *)(dst + i), a0);
+            _mm_storeu_si128((__m128i *)(dst + i + 16), a1);
+            _mm_storeu_si128((__m128i *)(dst + i + 32), a2);
+            _mm_storeu_si128((__m128i *)(dst + i + 48), a3);
+        }
+    }
+    for (; i + 16 <= nbytes; i += 16) {
+        a0 = _mm_loadu_si128((const __m128i *)(src[0] + i));
+        for (s = 1; s < nsrc; s++) {
+            a0 = _mm_xor_si128(a0,
+                               _mm_loadu_si128((const __m128i *)(src[s] + i)));
+        }
+        if (stream)
+            _mm_stream_si128((__m128i *)(dst + i), a0);
+        else
+            _mm_storeu_si128((__m128i *)(dst + i), a0);
+    }
+    xor_n_bytes(src, nsrc, dst, i, nbytes);
+    if (stream)
+        _mm_sfence();
+}
+
+/* ---------------------------------------------------------------------- */
+/* AVX2                                                                    */
+/* ---------------------------------------------------------------------- */
+
+__attribute__((target("avx2"))) static void
+w08_avx2(const unsigned char *src, unsigned char *dst, unsigned long nbytes,
+         const unsigned char *tables, unsigned add) {
+    __m256i tlo, thi, mask, v0, v1, p0, p1;
+    unsigned long i;
+
+    /* vpshufb works within 128-bit lanes, so each table goes in both. */
+    tlo = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)tables));
+    thi = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)(tables + 16)));
+    mask = _mm256_set1_epi8(0x0f);
+
+    for (i = 0; i + 64 <= nbytes; i += 64) {
+        v0 = _mm256_loadu_si256((const __m256i *)(src + i));
+        v1 = _mm256_loadu_si256((const __m256i *)(src + i + 32));
+        p0 = _mm256_xor_si256(
+            _mm256_shuffle_epi8(tlo, _mm256_and_si256(v0, mask)),
+            _mm256_shuffle_epi8(
+                thi, _mm256_and_si256(_mm256_srli_epi64(v0, 4), mask)));
+        p1 = _mm256_xor_si256(
+            _mm256_shuffle_epi8(tlo, _mm256_and_si256(v1, mask)),
+            _mm256_shuffle_epi8(
+                thi, _mm256_and_si256(_mm256_srli_epi64(v1, 4), mask)));
+        if (add) {
+            p0 = _mm256_xor_si256(
+                p0, _mm256_loadu_si256((const __m256i *)(dst + i)));
+            p1 = _mm256_xor_si256(
+                p1, _mm256_loadu_si256((const __m256i *)(dst + i + 32)));
+        }
+        _mm256_storeu_si256((__m256i *)(dst + i), p0);
+        _mm256_storeu_si256((__m256i *)(dst + i + 32), p1);
+    }
+    if (i < nbytes)
+        w08_ssse3(src + i, dst + i, nbytes - i, tables, add);
+}
+
+/* packus and unpack both work within 128-bit lanes, so packing and then
+   unpacking leaves every word in the lane it came from. */
+
+__attribute__((target("avx2"))) static void
+w16_avx2(const unsigned short *src, unsigned short *dst, unsigned long nwords,
+         const unsigned char *tables, unsigned add) {
+    __m256i tl[4], th[4], mask, bmask, a, b, lo, hi, n, rlo, rhi;
+    unsigned long i;
+    int k;
+
+    for (k = 0; k < 4; k++) {
+        tl[k] = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)(tables + 32 * k)));
+        th[k] = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)(tables + 32 * k + 16)));
+    }
+    mask = _mm256_set1_epi8(0x0f);
+    bmask = _mm256_set1_epi16(0x00ff);
+
+    for (i = 0; i + 32 <= nwords; i += 32) {
+        a = _mm256_loadu_si256((const __m256i *)(src + i));
+        b = _mm256_loadu_si256((const __m256i *)(src + i + 16));
+        lo = _mm256_packus_epi16(_mm256_and_si256(a, bmask),
+                                 _mm256_and_si256(b, bmask));
+        hi = _mm256_packus_epi16(_mm256_srli_epi16(a, 8),
+                                 _mm256_srli_epi16(b, 8));
+
+        n = _mm256_and_si256(lo, mask);
+        rlo = _mm256_shuffle_epi8(tl[0], n);
+        rhi = _mm256_shuffle_epi8(th[0], n);
+        n = _mm256_and_si256(_mm256_srli_epi64(lo, 4), mask);
+        rlo = _mm256_xor_si256(rlo, _mm256_shuffle_epi8(tl[1], n));
+        rhi = _mm256_xor_si256(rhi, _mm256_shuffle_epi8(th[1], n));
+        n = _mm256_and_si256(hi, mask);
+        rlo = _mm256_xor_si256(rlo, _mm256_shuffle_epi8(tl[2], n));
+        rhi = _mm256_xor_si256(rhi, _mm256_shuffle_epi8(th[2], n));
+        n = _mm256_and_si256(_mm256_srli_epi64(hi, 4), mask);
+        rlo = _mm256_xor_si256(rlo, _mm256_shuffle_epi8(tl[3], n));
+        rhi = _mm256_xor_si256(rhi, _mm256_shuffle_epi8(th[3], n));
+
+        a = _mm256_unpacklo_epi8(rlo, rhi);
+        b = _mm256_unpackhi_epi8(rlo, rhi);
+        if (add) {
+            a = _mm256_xor_si256(
+                a, _mm256_loadu_si256((const __m256i *)(dst + i)));
+            b = _mm256_xor_si256(
+                b, _mm256_loadu_si256((const __m256i *)(dst + i + 16)));
+        }
+        _mm256_storeu_si256((__m256i *)(dst + i), a);
+        _mm256_storeu_si256((__m256i *)(dst + i + 16), b);
+    }
+    if (i < nwords)
+        w16_ssse3(src + i, dst + i, nwords - i, tables, add);
+}
+
+/* As the SSSE3 kernels, two 64-byte blocks at a time.  The standard layout
+   transposes within each 128-bit lane.  In the altmap layout a 256-bit
+   load holds two planes of one block, so the kernel loads planes 0-1 of
+   both blocks into v[0] and v[1] and planes 2-3 into v[2] and v[3], and
+   swaps 128-bit halves within each pair, which is its own inverse. */
+
+__attribute__((target("avx2"))) static inline void
+w32_transpose_avx2(__m256i *v) {
+    __m256i t0, t1, t2, t3;
+
+    t0 = _mm256_unpacklo_epi32(v[0], v[1]);
+    t1 = _mm256_unpacklo_epi32(v[2], v[3]);
+    t2 = _mm256_unpackhi_epi32(v[0], v[1]);
+    t3 = _mm256_unpackhi_epi32(v[2], v[3]);
+    v[0] = _mm256_unpacklo_epi64(t0, t1);
+    v[1] = _mm256_unpackhi_epi64(t0, t1);
+    v[2] = _mm256_unpacklo_epi64(t2, t3);
+    v[3] = _mm256_unpackhi_epi64(t2, t3);
+}
+
+__attribute__((target("avx2"))) static inline void
+w32_altmap_swap_avx2(__m256i *v) {
+    __m256i t0, t1, t2, t3;
+
+    t0 = _mm256_permute2x128_si256(v[0], v[1], 0x20);
+    t1 = _mm256_permute2x128_si256(v[0], v[1], 0x31);
+    t2 = _mm256_permute2x128_si256(v[2], v[3], 0x20);
+    t3 = _mm256_permute2x128_si256(v[2], v[3], 0x31);
+    v[0] = t0;
+    v[1] = t1;
+    v[2] = t2;
+    v[3] = t3;
+}
+
+__attribute__((target("avx2"))) static inline void
+w32_split_planes_avx2(const __m256i *t, __m256i *p, __m256i mask) {
+    __m256i r[4], lo, hi;
+    int j, b;
+
+    for (b = 0; b < 4; b++)
+        r[b] = _mm256_setzero_si256();
+    for (j = 0; j < 4; j++) {
+        lo = _mm256_and_si256(p[j], mask);
+        hi = _mm256_and_si256(_mm256_srli_epi64(p[j], 4), mask);
+        for (b = 0; b < 4; b++) {
+            r[b] = _mm256_xor_si256(r[b],
+                                    _mm256_shuffle_epi8(t[8 * j + b], lo));
+            r[b] = _mm256_xor_si256(
+                r[b], _mm256_shuffle_epi8(t[8 * j + 4 + b], hi));
+        }
+    }
+    for (b = 0; b < 4; b++)
+        p[b] = r[b];
+}
+
+__attribute__((target("avx2"))) static void
+w32_split_avx2(const unsigned *src, unsigned *dst, unsigned long nwords,
+               const unsigned char *tables, unsigned add) {
+    __m256i t[32], v[4], mask, shuf;
+    unsigned long i;
+    int r;
+
+    for (r = 0; r < 32; r++) {
+        t[r] = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)(tables + 16 * r)));
+    }
+    mask = _mm256_set1_epi8(0x0f);
+    shuf = _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11,
+                            15, 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7,
+                            11, 15);
+
+    for (i = 0; i + 32 <= nwords; i += 32) {
+        for (r = 0; r < 4; r++) {
+            v[r] = _mm256_shuffle_epi8(
+                _mm256_loadu_si256((const __m256i *)(src + i + 8 * r)), shuf);
+        }
+        w32_transpose_avx2(v);
+        w32_split_planes_avx2(t, v, mask);
+        w32_transpose_avx2(v);
+        for (r = 0; r < 4; r++) {
+            v[r] = _mm256_shuffle_epi8(v[r], shuf);
+            if (add) {
+                v[r] = _mm256_xor_si256(
+                    v[r],
+                    _mm256_loadu_si256((const __m256i *)(dst + i + 8 * r)));
+            }
+            _mm256_storeu_si256((__m256i *)(dst + i + 8 * r), v[r]);
+        }
+    }
+    if (i < nwords)
+        w32_split_ssse3(src + i, dst + i, nwords - i, tables, add);
+}
+
+__attribute__((target("avx2"))) static void
+w32_altmap_avx2(const unsigned *src, unsigned *dst, unsigned long nwords,
+                const unsigned char *tables, unsigned add) {
+    static const int off[4] = {0, 16, 8, 24};
+    __m256i t[32], v[4], mask;
+    unsigned long i;
+    int r;
+
+    for (r = 0; r < 32; r++) {
+        t[r] = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)(tables + 16 * r)));
+    }
+    mask = _mm256_set1_epi8(0x0f);
+
+    for (i = 0; i + 32 <= nwords; i += 32) {
+        for (r = 0; r < 4; r++)
+            v[r] = _mm256_loadu_si256((const __m256i *)(src + i + off[r]));
+        w32_altmap_swap_avx2(v);
+        w32_split_planes_avx2(t, v, mask);
+        w32_altmap_swap_avx2(v);
+        for (r = 0; r < 4; r++) {
+            if (add) {
+                v[r] = _mm256_xor_si256(
+                    v[r],
+                    _mm256_loadu_si256((const __m256i *)(dst + i + off[r])));
+            }
+            _mm256_storeu_si256((__m256i *)(dst + i + off[r]), v[r]);
+        }
+    }
+    if (i < nwords)
+        w32_altmap_ssse3(src + i, dst + i, nwords - i, tables, add);
+}
+
+
+__attribute__((target("avx2"))) static void
+xor_avx2(const unsigned char *r1, const unsigned char *r2, unsigned char *r3,
+         unsigned long nbytes) {
+    __m256i a0, a1, b0, b1;
+    unsigned long i;
+
+    for (i = 0; i + 64 <= nbytes; i += 64) {
+        a0 = _mm256_loadu_si256((const __m256i *)(r1 + i));
+        a1 = _mm256_loadu_si256((const __m256i *)(r1 + i + 32));
+        b0 = _mm256_loadu_si256((const __m256i *)(r2 + i));
+        b1 = _mm256_loadu_si256((const __m256i *)(r2 + i + 32));
+        _mm256_storeu_si256((__m256i *)(r3 + i), _mm256_xor_si256(a0, b0));
+        _mm256_storeu_si256((__m256i *)(r3 + i + 32),
+                            _mm256_xor_si256(a1, b1));
+    }
+    if (i < nbytes)
+        xor_sse2(r1 + i, r2 + i, r3 + i, nbytes - i);
+}
+
+__attribute__((target("avx2"))) static void
+xor_n_avx2(const unsigned char *const *src, unsigned nsrc, unsigned char *dst,
+           unsigned long nbytes, unsigned stream) {
+    __m256i a0, a1, a2, a3;
+    const unsigned char *p;
+    unsigned long i;
+    unsigned s;
+
+    i = stream ? xor_n_head(dst, 32, nbytes) : 0;
+    xor_n_bytes(src, nsrc, dst, 0, i);
+
+    for (; i + 128 <= nbytes; i += 128) {
+        p = src[0] + i;
+        a0 = _mm256_loadu_si256((const __m256i *)p);
+        a1 = _mm256_loadu_si256((const __m256i *)(p + 32));
+        a2 = _mm256_loadu_si256((const __m256i *)(p + 64));
+        a3 = _mm256_loadu_si256((const __m256i *)(p + 96));
+        for (s = 1; s < nsrc; s++) {
+            p = src[s] + i;
+            a0 = _mm256_xor_si256(a0, _mm256_loadu_si256((const __m256i *)p));
+            a1 = _mm256_xor_si256(
+                a1, _mm256_loadu_si256((const __m256i *)(p + 32)));
+            a2 = _mm256_xor_si256(
+                a2, _mm256_loadu_si256((const __m256i *)(p + 64)));
+            a3 = _mm256_xor_si256(
+                a3, _mm256_loadu_si256((const __m256i *)(p + 96)));
+        }
+        if (stream) {
+            _mm256_stream_si256((__m256i *)(dst + i), a0);
+            _mm256_stream_si256((__m256i *)(dst + i + 32), a1);
+            _mm256_stream_si256((__m256i *)(dst + i + 64), a2);
+            _mm256_stream_si256((__m256i *)(dst + i + 96), a3);
+        } else {
+            _mm256_storeu_si256((__m256i *)(dst + i), a0);
+            _mm256_storeu_si256((__m256i *)(dst + i + 32), a1);
+            _mm256_storeu_si256((__m256i *)(dst + i + 64), a2);
+            _mm256_storeu_si256((__m256i *)(dst + i + 96), a3);
+        }
+    }
+    for (; i + 32 <= nbytes; i += 32) {
+        a0 = _mm256_loadu_si256((const __m256i *)(src[0] + i));
+        for (s = 1; s < nsrc; s++) {
+            a0 = _mm256_xor_si256(
+                a0, _mm256_loadu_si256((const __m256i *)(src[s] + i)));
+        }
+        if (stream)
+            _mm256_stream_si256((__m256i *)(dst + i), a0);
+        else
+            _mm256_storeu_si256((__m256i *)(dst + i), a0);
+    }
+    xor_n_bytes(src, nsrc, dst, i, nbytes);
+    if (stream)
+        _mm_sfence();
+}
+
+/* Eight elements per iteration:  widen to 32 bits, gather the two logs,
+   add them (or add 2^w - 1 minus the second), gather the antilog, then mask
+   out the zero cases.  Each gather loads 32 bits at an entry and keeps the
+   low 8 or 16.  log[0] is 2^w - 1, so the indices stay inside the tables
+   even for zeros. */
+
+template <class T>
+__attribute__((target("avx2"))) static void
+log_batch_avx2(const T *x, const T *y, T *out, unsigned long n, const T *log,
+               const T *ilog, unsigned divide) {
+    const int *lt = (const int *)log, *it = (const int *)ilog;
+    __m256i zero, nwm1, xv, yv, zx, zy, s, r, pick;
+    unsigned long i;
+
+    zero = _mm256_setzero_si256();
+    nwm1 = _mm256_set1_epi32((T)-1);
+    /* Moves the low byte (word) of each dword to the bottom of its lane. */
+    if (sizeof(T) == 1)
+        pick = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1,
+                                -1, -1, -1, -1, 0, 4, 8, 12, -1, -1, -1, -1,
+                                -1, -1, -1, -1, -1, -1, -1, -1);
+    else
+        pick = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1,
+                                -1, -1, -1, 0, 1, 4, 5, 8, 9, 12, 13, -1, -1,
+                                -1, -1, -1, -1, -1, -1);
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        if (sizeof(T) == 1) {
+            yv = _mm256_cvtepu8_epi32(
+                _mm_loadl_epi64((const __m128i *)(y + i)));
+            xv = (x == NULL) ? _mm256_set1_epi32(1)
+                             : _mm256_cvtepu8_epi32(_mm_loadl_epi64(
+                                   (const __m128i *)(x + i)));
+        } else {
+            yv = _mm256_cvtepu16_epi32(
+                _mm_loadu_si128((const __m128i *)(y + i)));
+            xv = (x == NULL) ? _mm256_set1_epi32(1)
+                             : _mm256_cvtepu16_epi32(_mm_loadu_si128(
+                                   (const __m128i *)(x + i)));
+        }
+        zx = _mm256_cmpeq_epi32(xv, zero);
+        zy = _mm256_cmpeq_epi32(yv, zero);
+        xv = _mm256_and_si256(_mm256_i32gather_epi32(lt, xv, sizeof(T)), nwm1);
+        yv = _mm256_and_si256(_mm256_i32gather_epi32(lt, yv, sizeof(T)), nwm1);
+        if (divide)
+            yv = _mm256_sub_epi32(nwm1, yv);
+        s = _mm256_add_epi32(xv, yv);
+        r = _mm256_i32gather_epi32(it, s, sizeof(T));
+        if (divide)
+            r = _mm256_or_si256(_mm256_andnot_si256(zx, r), zy);
+        else
+            r = _mm256_andnot_si256(_mm256_or_si256(zx, zy), r);
+
+        r = _mm256_shuffle_epi8(r, pick);
+        if (sizeof(T) == 1) {
+            r = _mm256_permutevar8x32_epi32(r, _mm256_setr_epi32(0, 4, 0, 0, 0,
+                                                                 0, 0, 0));
+            _mm_storel_epi64((__m128i *)(out + i), _mm256_castsi256_si128(r));
+        } else {
+            r = _mm256_permute4x64_epi64(r, 0x08);
+            _mm_storeu_si128((__m128i *)(out + i), _mm256_castsi256_si128(r));
+        }
+    }
+    if (i < n)
+        log_batch_scalar(x ? x + i : NULL, y + i, out + i, n - i, log, ilog,
+                         divide);
+}
+
+static void w08_batch_avx2(const unsigned char *x, const unsigned char *y,
+                           unsigned char *out, unsigned long n,
+                           const unsigned char *log, const unsigned char *ilog,
+                           unsigned divide) {
+    log_batch_avx2(x, y, out, n, log, ilog, divide);
+}
+
+static void w16_batch_avx2(const unsigned short *x, const unsigned short *y,
+                           unsigned short *out, unsigned long n,
+                           const unsigned short *log,
+                           const unsigned short *ilog, unsigned divide) {
+    log_batch_avx2(x, y, out, n, log, ilog, divide);
+}
+
+/* ---------------------------------------------------------------------- */
+/* AVX-512BW                                                               */
+/* ---------------------------------------------------------------------- */
+
+__attribute__((target("avx512f,avx512bw"))) static void
+w08_avx512(const unsigned char *src, unsigned char *dst, unsigned long nbytes,
+           const unsigned char *tables, unsigned add) {
+    __m512i tlo, thi, mask, v, p;
+    __mmask64 k;
+    unsigned long i;
+
+    tlo = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)tables));
+    thi = _mm512_broadcast_i32x4(
+        _mm_loadu_si128((const __m128i *)(tables + 16)));
+    mask = _mm512_set1_epi8(0x0f);
+
+    for (i = 0; i + 64 <= nbytes; i += 64) {
+        v = _mm512_loadu_si512((const void *)(src + i));
+        p = _mm512_xor_si512(
+            _mm512_shuffle_epi8(tlo, _mm512_and_si512(v, mask)),
+            _mm512_shuffle_epi8(
+                thi, _mm512_and_si512(_mm512_srli_epi64(v, 4), mask)));
+        if (add)
+            p = _mm512_xor_si512(p, _mm512_loadu_si512((const void *)(dst + i)));
+        _mm512_storeu_si512((void *)(dst + i), p);
+    }
+
+    /* The tail is done with masked loads and stores. */
+    if (i < nbytes) {
+        k = _cvtu64_mask64(~0ULL >> (64 - (nbytes - i)));
+        v = _mm512_maskz_loadu_epi8(k, src + i);
+        p = _mm512_xor_si512(
+            _mm512_shuffle_epi8(tlo, _mm512_and_si512(v, mask)),
+            _mm512_shuffle_epi8(
+                thi, _mm512_and_si512(_mm512_srli_epi64(v, 4), mask)));
+        if (add)
+            p = _mm512_xor_si512(p, _mm512_maskz_loadu_epi8(k, dst + i));
+        _mm512_mask_storeu_epi8(dst + i, k, p);
+    }
+}
+
+__attribute__((target("avx512f,avx512bw"))) static void
+w16_avx512(const unsigned short *src, unsigned short *dst,
+           unsigned long nwords, const unsigned char *tables, unsigned add) {
+    __m512i tl[4], th[4], mask, bmask, a, b, lo, hi, n, rlo, rhi;
+    unsigned long i;
+    int k;
+
+    for (k = 0; k < 4; k++) {
+        tl[k] = _mm512_broadcast_i32x4(
+            _mm_loadu_si128((const __m128i *)(tables + 32 * k)));
+        th[k] = _mm512_broadcast_i32x4(
+            _mm_loadu_si128((const __m128i *)(tables + 32 * k + 16)));
+    }
+    mask = _mm512_set1_epi8(0x0f);
+    bmask = _mm512_set1_epi16(0x00ff);
+
+    for (i = 0; i + 64 <= nwords; i += 64) {
+        a = _mm512_loadu_si512((const void *)(src + i));
+        b = _mm512_loadu_si512((const void *)(src + i + 32));
+        lo = _mm512_packus_epi16(_mm512_and_si512(a, bmask),
+                                 _mm512_and_si512(b, bmask));
+        hi = _mm512_packus_epi16(_mm512_srli_epi16(a, 8),
+                                 _mm512_srli_epi16(b, 8));
+
+        n = _mm512_and_si512(lo, mask);
+        rlo = _mm512_shuffle_epi8(tl[0], n);
+        rhi = _mm512_shuffle_epi8(th[0], n);
+        n = _mm512_and_si512(_mm512_srli_epi64(lo, 4), mask);
+        rlo = _mm512_xor_si512(rlo, _mm512_shuffle_epi8(tl[1], n));
+        rhi = _mm512_xor_si512(rhi, _mm512_shuffle_epi8(th[1], n));
+        n = _mm512_and_si512(hi, mask);
+        rlo = _mm512_xor_si512(rlo, _mm512_shuffle_epi8(tl[2], n));
+        rhi = _mm512_xor_si512(rhi, _mm512_shuffle_epi8(th[2], n));
+        n = _mm512_and_si512(_mm512_srli_epi64(hi, 4), mask);
+        rlo = _mm512_xor_si512(rlo, _mm512_shuffle_epi8(tl[3], n));
+        rhi = _mm512_xor_si512(rhi, _mm512_shuffle_epi8(th[3], n));
+
+        a = _mm512_unpacklo_epi8(rlo, rhi);
+        b = _mm512_unpackhi_epi8(rlo, rhi);
+        if (add) {
+            a = _mm512_xor_si512(a,
+                                 _mm512_loadu_si512((const void *)(dst + i)));
+            b = _mm512_xor_si512(
+                b, _mm512_loadu_si512((const void *)(dst + i + 32)));
+        }
+        _mm512_storeu_si512((void *)(dst + i), a);
+        _mm512_storeu_si512((void *)(dst + i + 32), b);
+    }
+    if (i < nwords)
+        w16_avx2(src + i, dst + i, nwords - i, tables, add);
+}
+
+/* Four 64-byte blocks at a time.  In the altmap layout each vector holds
+   one block, and a 4 x 4 transpose of 128-bit lanes turns them into
+   planes and back. */
+
+__attribute__((target("avx512f,avx512bw"))) static inline void
+w32_transpose_avx512(__m512i *v) {
+    __m512i t0, t1, t2, t3;
+
+    t0 = _mm512_unpacklo_epi32(v[0], v[1]);
+    t1 = _mm512_unpacklo_epi32(v[2], v[3]);
+    t2 = _mm512_unpackhi_epi32(v[0], v[1]);
+    t3 = _mm512_unpackhi_epi32(v[2], v[3]);
+    v[0] = _mm512_unpacklo_epi64(t0, t1);
+    v[1] = _mm512_unpackhi_epi64(t0, t1);
+    v[2] = _mm512_unpacklo_epi64(t2, t3);
+    v[3] = _mm512_unpackhi_epi64(t2, t3);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static inline void
+w32_altmap_swap_avx512(__m512i *v) {
+    __m512i t0, t1, t2, t3;
+
+    t0 = _mm512_shuffle_i64x2(v[0], v[1], 0x44);
+    t1 = _mm512_shuffle_i64x2(v[2], v[3], 0x44);
+    t2 = _mm512_shuffle_i64x2(v[0], v[1], 0xee);
+    t3 = _mm512_shuffle_i64x2(v[2], v[3], 0xee);
+    v[0] = _mm512_shuffle_i64x2(t0, t1, 0x88);
+    v[1] = _mm512_shuffle_i64x2(t0, t1, 0xdd);
+    v[2] = _mm512_shuffle_i64x2(t2, t3, 0x88);
+    v[3] = _mm512_shuffle_i64x2(t2, t3, 0xdd);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static inline void
+w32_split_planes_avx512(const __m512i *t, __m512i *p, __m512i mask) {
+    __m512i r[4], lo, hi;
+    int j, b;
+
+    for (b = 0; b < 4; b++)
+        r[b] = _mm512_setzero_si512();
+    for (j = 0; j < 4; j++) {
+        lo = _mm512_and_si512(p[j], mask);
+        hi = _mm512_and_si512(_mm512_srli_epi64(p[j], 4), mask);
+        for (b = 0; b < 4; b++) {
+            r[b] = _mm512_xor_si512(r[b],
+                                    _mm512_shuffle_epi8(t[8 * j + b], lo));
+            r[b] = _mm512_xor_si512(
+                r[b], _mm512_shuffle_epi8(t[8 * j + 4 + b], hi));
+        }
+    }
+    for (b = 0; b < 4; b++)
+        p[b] = r[b];
+}
+
+__attribute__((target("avx512f,avx512bw"))) static void
+w32_split_avx512(const unsigned *src, unsigned *dst, unsigned long nwords,
+                 const unsigned char *tables, unsigned add) {
+    __m512i t[32], v[4], mask, shuf;
+    unsigned long i;
+    int r;
+
+    for (r = 0; r < 32; r++) {
+        t[r] = _mm512_broadcast_i32x4(
+            _mm_loadu_si128((const __m128i *)(tables + 16 * r)));
+    }
+    mask = _mm512_set1_epi8(0x0f);
+    shuf = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2,
+                                                6, 10, 14, 3, 7, 11, 15));
+
+    for (i = 0; i + 64 <= nwords; i += 64) {
+        for (r = 0; r < 4; r++) {
+            v[r] = _mm512_shuffle_epi8(
+                _mm512_loadu_si512((const void *)(src + i + 16 * r)), shuf);
+        }
+        w32_transpose_avx512(v);
+        w32_split_planes_avx512(t, v, mask);
+        w32_transpose_avx512(v);
+        for (r = 0; r < 4; r++) {
+            v[r] = _mm512_shuffle_epi8(v[r], shuf);
+            if (add) {
+                v[r] = _mm512_xor_si512(
+                    v[r], _mm512_loadu_si512((const void *)(dst + i + 16 * r)));
+            }
+            _mm512_storeu_si512((void *)(dst + i + 16 * r), v[r]);
+        }
+    }
+    if (i < nwords)
+        w32_split_avx2(src + i, dst + i, nwords - i, tables, add);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static void
+w32_altmap_avx512(const unsigned *src, unsigned *dst, unsigned long nwords,
+                  const unsigned char *tables, unsigned add) {
+    __m512i t[32], v[4], mask;
+    unsigned long i;
+    int r;
+
+    for (r = 0; r < 32; r++) {
+        t[r] = _mm512_broadcast_i32x4(
+            _mm_loadu_si128((const __m128i *)(tables + 16 * r)));
+    }
+    mask = _mm512_set1_epi8(0x0f);
+
+    for (i = 0; i + 64 <= nwords; i += 64) {
+        for (r = 0; r < 4; r++)
+            v[r] = _mm512_loadu_si512((const void *)(src + i + 16 * r));
+        w32_altmap_swap_avx512(v);
+        w32_split_planes_avx512(t, v, mask);
+        w32_altmap_swap_avx512(v);
+        for (r = 0; r < 4; r++) {
+            if (add) {
+                v[r] = _mm512_xor_si512(
+                    v[r], _mm512_loadu_si512((const void *)(dst + i + 16 * r)));
+            }
+            _mm512_storeu_si512((void *)(dst + i + 16 * r), v[r]);
+        }
+    }
+    if (i < nwords)
+        w32_altmap_avx2(src + i, dst + i, nwords - i, tables, add);
+}
+
+
+__attribute__((target("avx512f,avx512bw"))) static void
+xor_avx512(const unsigned char *r1, const unsigned char *r2, unsigned char *r3,
+           unsigned long nbytes) {
+    __m512i a0, a1, b0, b1;
+    __mmask64 k;
+    unsigned long i;
+
+    for (i = 0; i + 128 <= nbytes; i += 128) {
+        a0 = _mm512_loadu_si512((const void *)(r1 + i));
+        a1 = _mm512_loadu_si512((const void *)(r1 + i + 64));
+        b0 = _mm512_loadu_si512((const void *)(r2 + i));
+        b1 = _mm512_loadu_si512((const void *)(r2 + i + 64));
+        _mm512_storeu_si512((void *)(r3 + i), _mm512_xor_si512(a0, b0));
+        _mm512_storeu_si512((void *)(r3 + i + 64), _mm512_xor_si512(a1, b1));
+    }
+    for (; i < nbytes; i += 64) {
+        k = _cvtu64_mask64((nbytes - i >= 64) ? ~0ULL
+                                              : ~0ULL >> (64 - (nbytes - i)));
+        a0 = _mm512_maskz_loadu_epi8(k, r1 + i);
+        b0 = _mm512_maskz_loadu_epi8(k, r2 + i);
+        _mm512_mask_storeu_epi8(r3 + i, k, _mm512_xor_si512(a0, b0));
+    }
+}
+
+__attribute__((target("avx512f,avx512bw"))) static void
+xor_n_avx512(const unsigned char *const *src, unsigned nsrc,
+             unsigned char *dst, unsigned long nbytes, unsigned stream) {
+    __m512i a0, a1, a2, a3;
+    const unsigned char *p;
+    unsigned long i;
+    __mmask64 k;
+    unsigned s;
+
+    i = stream ? xor_n_head(dst, 64, nbytes) : 0;
+    xor_n_bytes(src, nsrc, dst, 0, i);
+
+    for (; i + 256 <= nbytes; i += 256) {
+        p = src[0] + i;
+        a0 = _mm512_loadu_si512((const void *)p);
+        a1 = _mm512_loadu_si512((const void *)(p + 64));
+        a2 = _mm512_loadu_si512((const void *)(p + 128));
+        a3 = _mm512_loadu_si512((const void *)(p + 192));
+        for (s = 1; s < nsrc; s++) {
+            p = src[s] + i;
+            a0 = _mm512_xor_si512(a0, _mm512_loadu_si512((const void *)p));
+            a1 = _mm512_xor_si512(a1,
+                                  _mm512_loadu_si512((const void *)(p + 64)));
+            a2 = _mm512_xor_si512(a2,
+                                  _mm512_loadu_si512((const void *)(p + 128)));
+            a3 = _mm512_xor_si512(a3,
+                                  _mm512_loadu_si512((const void *)(p + 192)));
+        }
+        if (stream) {
+            _mm512_stream_si512((__m512i *)(dst + i), a0);
+            _mm512_stream_si512((__m512i *)(dst + i + 64), a1);
+            _mm512_stream_si512((__m512i *)(dst + i + 128), a2);
+            _mm512_stream_si512((__m512i *)(dst + i + 192), a3);
+        } else {
+            _mm512_storeu_si512((void *)(dst + i), a0);
+            _mm512_storeu_si512((void *)(dst + i + 64), a1);
+            _mm512_storeu_si512((void *)(dst + i + 128), a2);
+            _mm512_storeu_si512((void *)(dst + i + 192), a3);
+        }
+    }
+    /* The last partial vector is never streamed:  a masked store with a
+       non-temporal hint does not exist. */
+    for (; i < nbytes; i += 64) {
+        k = _cvtu64_mask64((nbytes - i >= 64) ? ~0ULL
+                                              : ~0ULL >> (64 - (nbytes - i)));
+        a0 = _mm512_maskz_loadu_epi8(k, src[0] + i);
+        for (s = 1; s < nsrc; s++)
+            a0 = _mm512_xor_si512(a0, _mm512_maskz_loadu_epi8(k, src[s] + i));
+        if (stream && nbytes - i >= 64)
+            _mm512_stream_si512((__m512i *)(dst + i), a0);
+        else
+            _mm512_mask_storeu_epi8(dst + i, k, a0);
+    }
+    if (stream)
+        _mm_sfence();
+}
+
+/* As log_batch_avx2, 16 elements at a time, with mask registers for the
+   zero cases and vpmovdb/vpmovdw to narrow the results. */
+
+template <class T>
+__attribute__((target("avx512f,avx512bw"))) static void
+log_batch_avx512(const T *x, const T *y, T *out, unsigned long n, const T *log,
+                 const T *ilog, unsigned divide) {
+    __m512i zero, nwm1, xv, yv, s, r;
+    __mmask16 zx, zy;
+    unsigned long i;
+
+    zero = _mm512_setzero_si512();
+    nwm1 = _mm512_set1_epi32((T)-1);
+    for (i = 0; i + 16 <= n; i += 16) {
+        if (sizeof(T) == 1) {
+            yv = _mm512_cvtepu8_epi32(
+                _mm_loadu_si128((const __m128i *)(y + i)));
+            xv = (x == NULL) ? _mm512_set1_epi32(1)
+                             : _mm512_cvtepu8_epi32(_mm_loadu_si128(
+                                   (const __m128i *)(x + i)));
+        } else {
+            yv = _mm512_cvtepu16_epi32(
+                _mm256_loadu_si256((const __m256i *)(y + i)));
+            xv = (x == NULL) ? _mm512_set1_epi32(1)
+                             : _mm512_cvtepu16_epi32(_mm256_loadu_si256(
+                                   (const __m256i *)(x + i)));
+        }
+        zx = _mm512_cmpeq_epi32_mask(xv, zero);
+        zy = _mm512_cmpeq_epi32_mask(yv, zero);
+        xv = _mm512_and_si512(_mm512_i32gather_epi32(xv, log, sizeof(T)), nwm1);
+        yv = _mm512_and_si512(_mm512_i32gather_epi32(yv, log, sizeof(T)), nwm1);
+        if (divide)
+            yv = _mm512_sub_epi32(nwm1, yv);
+        s = _mm512_add_epi32(xv, yv);
+        r = _mm512_i32gather_epi32(s, ilog, sizeof(T));
+        if (divide) {
+            r = _mm512_maskz_mov_epi32(~zx, r);
+            r = _mm512_mask_mov_epi32(r, zy, _mm512_set1_epi32(-1));
+        } else {
+            r = _mm512_maskz_mov_epi32(~(zx | zy), r);
+        }
+
+        if (sizeof(T) == 1)
+            _mm_storeu_si128((__m128i *)(out + i), _mm512_cvtepi32_epi8(r));
+        else
+            _mm256_storeu_si256((__m256i *)(out + i),
+                                _mm512_cvtepi32_epi16(r));
+    }
+    if (i < n)
+        log_batch_scalar(x ? x + i : NULL, y + i, out + i, n - i, log, ilog,
+                         divide);
+}
+
+static void w08_batch_avx512(const unsigned char *x, const unsigned char *y,
+                             unsigned char *out, unsigned long n,
+                             const unsigned char *log,
+                             const unsigned char *ilog, unsigned divide) {
+    log_batch_avx512(x, y, out, n, log, ilog, divide);
+}
+
+static void w16_batch_avx512(const unsigned short *x, const unsigned short *y,
+                             unsigned short *out, unsigned long n,
+                             const unsigned short *log,
+                             const unsigned short *ilog, unsigned divide) {
+    log_batch_avx512(x, y, out, n, log, ilog, divide);
+}
+
+/* ---------------------------------------------------------------------- */
+/* PCLMULQDQ                                                               */
+/* ---------------------------------------------------------------------- */
+
+__attribute__((target("sse2,pclmul"))) static unsigned
+w32_clmul_multiply(unsigned x, unsigned y, unsigned long long poly,
+                   unsigned long long mu) {
+    __m128i c, h, k, q;
+
+    /* k holds mu in the low quadword and poly in the high one. */
+    k = _mm_set_epi64x((long long)poly, (long long)mu);
+    c = _mm_clmulepi64_si128(_mm_cvtsi32_si128(x), _mm_cvtsi32_si128(y), 0x00);
+    h = _mm_srli_epi64(c, 32);
+    q = _mm_xor_si128(_mm_srli_epi64(_mm_clmulepi64_si128(h, k, 0x00), 32), h);
+    c = _mm_xor_si128(c, _mm_clmulepi64_si128(q, k, 0x10));
+    return (unsigned)_mm_cvtsi128_si32(c);
+}
+
+/* Reduces the two 64-bit products in c.  The results are in the low 32 bits
+   of each quadword; the high bits are garbage. */
+
+__attribute__((target("sse2,pclmul"))) static inline __m128i
+w32_clmul_reduce(__m128i c, __m128i k) {
+    __m128i h, q;
+
+    h = _mm_srli_epi64(c, 32);
+    q = _mm_unpacklo_epi64(_mm_clmulepi64_si128(h, k, 0x00),
+                           _mm_clmulepi64_si128(h, k, 0x01));
+    q = _mm_xor_si128(_mm_srli_epi64(q, 32), h);
+    return _mm_xor_si128(c, _mm_unpacklo_epi64(_mm_clmulepi64_si128(q, k, 0x10),
+                                               _mm_clmulepi64_si128(q, k, 0x11)));
+}
+
+/* x[i] * y[i], four words at a time.  The even and odd words go through
+   separate multiplies, one product per quadword. */
+
+__attribute__((target("sse2,pclmul"))) static void
+w32_batch_clmul(const unsigned *x, const unsigned *y, unsigned *out,
+                unsigned long n, unsigned long long poly,
+                unsigned long long mu) {
+    __m128i k, lmask, xv, yv, e, o, a, b;
+    unsigned long i;
+
+    k = _mm_set_epi64x((long long)poly, (long long)mu);
+    lmask = _mm_set1_epi64x(0xffffffffLL);
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        xv = _mm_loadu_si128((const __m128i *)(x + i));
+        yv = _mm_loadu_si128((const __m128i *)(y + i));
+
+        a = _mm_and_si128(xv, lmask);
+        b = _mm_and_si128(yv, lmask);
+        e = _mm_unpacklo_epi64(_mm_clmulepi64_si128(a, b, 0x00),
+                               _mm_clmulepi64_si128(a, b, 0x11));
+        a = _mm_srli_epi64(xv, 32);
+        b = _mm_srli_epi64(yv, 32);
+        o = _mm_unpacklo_epi64(_mm_clmulepi64_si128(a, b, 0x00),
+                               _mm_clmulepi64_si128(a, b, 0x11));
+        e = _mm_and_si128(w32_clmul_reduce(e, k), lmask);
+        o = _mm_slli_epi64(w32_clmul_reduce(o, k), 32);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_or_si128(e, o));
+    }
+    for (; i < n; i++)
+        out[i] = w32_clmul_multiply(x[i], y[i], poly, mu);
+}
+
+/* GF(2^64) and GF(2^128) products are reduced by folding.  In GF(2^64),
+   the high half H of c = H x^64 + L is worth H * poly, which has at most
+   68 bits, and the few bits of that above x^64 are folded down once more.
+   GF(2^128) folds the top quadword of its 256-bit product into the middle,
+   and then what is left above x^128 into the low half.  Each fold is one
+   carry-less multiply by poly, which sits in the low quadword of p.
+
+   The mac kernels evaluate r blocks of the polynomial at once:
+
+     acc' = (acc + x[0]) h^r + x[1] h^(r-1) + ... + x[r-1] h
+
+   The r products are summed before the one reduction they need, so the
+   chain from one acc to the next is a multiply, a few XORs and a
+   reduction, rather than r multiplies and r reductions. */
+
+__attribute__((target("sse2,pclmul"))) static inline __m128i
+w64_clmul_reduce(__m128i c, __m128i p) {
+    __m128i t;
+
+    t = _mm_clmulepi64_si128(c, p, 0x01);
+    t = _mm_xor_si128(t, _mm_clmulepi64_si128(t, p, 0x01));
+    return _mm_move_epi64(_mm_xor_si128(c, t));
+}
+
+/* Reduces the products a and b into the low and high quadwords.  Each is
+   reduced where it is, leaving garbage in its high quadword, so that
+   there is only one shuffle to put them together. */
+
+__attribute__((target("sse2,pclmul"))) static inline __m128i
+w64_clmul_reduce2(__m128i a, __m128i b, __m128i p) {
+    __m128i t;
+
+    t = _mm_clmulepi64_si128(a, p, 0x01);
+    a = _mm_xor_si128(a, _mm_xor_si128(t, _mm_clmulepi64_si128(t, p, 0x01)));
+    t = _mm_clmulepi64_si128(b, p, 0x01);
+    b = _mm_xor_si128(b, _mm_xor_si128(t, _mm_clmulepi64_si128(t, p, 0x01)));
+    return _mm_unpacklo_epi64(a, b);
+}
+
+__attribute__((target("sse2,pclmul"))) static unsigned long long
+w64_clmul_multiply(unsigned long long x, unsigned long long y) {
+    __m128i c;
+
+    c = _mm_clmulepi64_si128(_mm_cvtsi64_si128((long long)x),
+                             _mm_cvtsi64_si128((long long)y), 0x00);
+    return (unsigned long long)_mm_cvtsi128_si64(
+        w64_clmul_reduce(c, _mm_cvtsi64_si128(GALOIS_W64_POLY)));
+}
+
+__attribute__((target("sse2,pclmul"))) static void
+w64_clmul(const unsigned long long *src, unsigned long long *dst,
+          unsigned long n, unsigned long long multby, unsigned add) {
+    __m128i p, m, v;
+    unsigned long i;
+
+    p = _mm_cvtsi64_si128(GALOIS_W64_POLY);
+    m = _mm_cvtsi64_si128((long long)multby);
+    for (i = 0; i + 2 <= n; i += 2) {
+        v = _mm_loadu_si128((const __m128i *)(src + i));
+        v = w64_clmul_reduce2(_mm_clmulepi64_si128(v, m, 0x00),
+                              _mm_clmulepi64_si128(v, m, 0x01), p);
+        if (add)
+            v = _mm_xor_si128(v, _mm_loadu_si128((const __m128i *)(dst + i)));
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+    }
+    if (i < n) {
+        if (add)
+            dst[i] ^= w64_clmul_multiply(src[i], multby);
+        else
+            dst[i] = w64_clmul_multiply(src[i], multby);
+    }
+}
+
+/* pw[j] = h^(r - j), for the r-block evaluation. */
+
+template <class T, class F>
+static void wide_mac_powers(T h, T *pw, unsigned r, F multiply) {
+    unsigned j;
+
+    pw[r - 1] = h;
+    for (j = r - 1; j > 0; j--)
+        pw[j - 1] = multiply(pw[j], h);
+}
+
+__attribute__((target("sse2,pclmul"))) static unsigned long long
+w64_mac_clmul(const unsigned long long *src, unsigned long n,
+              unsigned long long h, unsigned long long acc) {
+    unsigned long long pw[8];
+    __m128i p, a, s, x, k[4];
+    unsigned long i;
+    unsigned j;
+
+    i = 0;
+    if (n >= 8) {
+        wide_mac_powers(h, pw, 8, w64_clmul_multiply);
+        for (j = 0; j < 4; j++)
+            k[j] = _mm_loadu_si128((const __m128i *)(pw + 2 * j));
+        p = _mm_cvtsi64_si128(GALOIS_W64_POLY);
+        a = _mm_cvtsi64_si128((long long)acc);
+        for (; i + 8 <= n; i += 8) {
+            x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + i)), a);
+            s = _mm_xor_si128(_mm_clmulepi64_si128(x, k[0], 0x00),
+                              _mm_clmulepi64_si128(x, k[0], 0x11));
+            for (j = 1; j < 4; j++) {
+                x = _mm_loadu_si128((const __m128i *)(src + i + 2 * j));
+                s = _mm_xor_si128(s, _mm_clmulepi64_si128(x, k[j], 0x00));
+                s = _mm_xor_si128(s, _mm_clmulepi64_si128(x, k[j], 0x11));
+            }
+            a = w64_clmul_reduce(s, p);
+        }
+        acc = (unsigned long long)_mm_cvtsi128_si64(a);
+    }
+    for (; i < n; i++)
+        acc = w64_clmul_multiply(acc ^ src[i], h);
+    return acc;
+}
+
+/* The 256-bit product of a and b is hi x^128 + lo + mid x^64, before the
+   middle is split between the two. */
+
+__attribute__((target("sse2,pclmul"))) static inline void
+w128_clmul_product(__m128i a, __m128i b, __m128i *lo, __m128i *mid,
+                   __m128i *hi) {
+    *lo = _mm_clmulepi64_si128(a, b, 0x00);
+    *hi = _mm_clmulepi64_si128(a, b, 0x11);
+    *mid = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x01),
+                         _mm_clmulepi64_si128(a, b, 0x10));
+}
+
+/* The top quadword of hi is worth t = hi.hi * poly at x^64, which adds
+   into mid.  That leaves hi.lo + mid.hi at x^128, and as multiplying by
+   poly is linear, its fold is two multiplies rather than a shuffle and a
+   multiply. */
+
+__attribute__((target("sse2,pclmul"))) static inline __m128i
+w128_clmul_reduce(__m128i lo, __m128i mid, __m128i hi, __m128i p) {
+    mid = _mm_xor_si128(mid, _mm_clmulepi64_si128(hi, p, 0x01));
+    lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+    lo = _mm_xor_si128(lo, _mm_clmulepi64_si128(hi, p, 0x00));
+    return _mm_xor_si128(lo, _mm_clmulepi64_si128(mid, p, 0x01));
+}
+
+__attribute__((target("sse2,pclmul"))) static galois_w128
+w128_clmul_multiply(galois_w128 x, galois_w128 y) {
+    __m128i lo, mid, hi;
+    galois_w128 r;
+
+    w128_clmul_product(_mm_loadu_si128((const __m128i *)&x),
+                       _mm_loadu_si128((const __m128i *)&y), &lo, &mid, &hi);
+    _mm_storeu_si128((__m128i *)&r,
+                     w128_clmul_reduce(lo, mid, hi,
+                                       _mm_cvtsi64_si128(GALOIS_W128_POLY)));
+    return r;
+}
+
+__attribute__((target("sse2,pclmul"))) static void
+w128_clmul(const galois_w128 *src, galois_w128 *dst, unsigned long n,
+           galois_w128 multby, unsigned add) {
+    __m128i p, m, v, lo, mid, hi;
+    unsigned long i;
+
+    p = _mm_cvtsi64_si128(GALOIS_W128_POLY);
+    m = _mm_loadu_si128((const __m128i *)&multby);
+    for (i = 0; i < n; i++) {
+        v = _mm_loadu_si128((const __m128i *)(src + i));
+        w128_clmul_product(v, m, &lo, &mid, &hi);
+        v = w128_clmul_reduce(lo, mid, hi, p);
+        if (add)
+            v = _mm_xor_si128(v, _mm_loadu_si128((const __m128i *)(dst + i)));
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+    }
+}
+
+__attribute__((target("sse2,pclmul"))) static galois_w128
+w128_mac_clmul(const galois_w128 *src, unsigned long n, galois_w128 h,
+               galois_w128 acc) {
+    __m128i p, a, x, k[4], lo, mid, hi, l, m, u;
+    galois_w128 pw[4];
+    unsigned long i;
+    unsigned j;
+
+    i = 0;
+    if (n >= 4) {
+        wide_mac_powers(h, pw, 4, w128_clmul_multiply);
+        for (j = 0; j < 4; j++)
+            k[j] = _mm_loadu_si128((const __m128i *)(pw + j));
+        p = _mm_cvtsi64_si128(GALOIS_W128_POLY);
+        a = _mm_loadu_si128((const __m128i *)&acc);
+        for (; i + 4 <= n; i += 4) {
+            x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + i)), a);
+            w128_clmul_product(x, k[0], &lo, &mid, &hi);
+            for (j = 1; j < 4; j++) {
+                x = _mm_loadu_si128((const __m128i *)(src + i + j));
+                w128_clmul_product(x, k[j], &l, &m, &u);
+                lo = _mm_xor_si128(lo, l);
+                mid = _mm_xor_si128(mid, m);
+                hi = _mm_xor_si128(hi, u);
+            }
+            a = w128_clmul_reduce(lo, mid, hi, p);
+        }
+        _mm_storeu_si128((__m128i *)&acc, a);
+    }
+    for (; i < n; i++)
+        acc = w128_clmul_multiply(acc ^ src[i], h);
+    return acc;
+}
+
+/* ---------------------------------------------------------------------- */
+/* VPCLMULQDQ                                                              */
+/* ---------------------------------------------------------------------- */
+
+/* The GF(2^64) and GF(2^128) kernels again, with the four 128-bit lanes of
+   a 512-bit register each doing what one register does above. */
+
+__attribute__((target("avx512f,avx512bw,pclmul,vpclmulqdq"))) static inline __m512i
+w64_vpclmul_reduce2(__m512i a, __m512i b, __m512i p) {
+    __m512i t;
+
+    t = _mm512_clmulepi64_epi128(a, p, 0x01);
+    t = _mm512_xor_si512(t, _mm512_clmulepi64_epi128(t, p, 0x01));
+    a = _mm512_xor_si512(a, t);
+    t = _mm512_clmulepi64_epi128(b, p, 0x01);
+    t = _mm512_xor_si512(t, _mm512_clmulepi64_epi128(t, p, 0x01));
+    b = _mm512_xor_si512(b, t);
+    return _mm512_unpacklo_epi64(a, b);
+}
+
+__attribute__((target("avx512f,avx512bw,pclmul,vpclmulqdq"))) static void
+w64_vpclmul(const unsigned long long *src, unsigned long long *dst,
+            unsigned long n, unsigned long long multby, unsigned add) {
+    __m512i p, m, v;
+    unsigned long i;
+
+    p = _mm512_set1_epi64(GALOIS_W64_POLY);
+    m = _mm512_set1_epi64((long long)multby);
+    for (i = 0; i + 8 <= n; i += 8) {
+        v = _mm512_loadu_si512(src + i);
+        v = w64_vpclmul_reduce2(_mm512_clmulepi64_epi128(v, m, 0x00),
+                                _mm512_clmulepi64_epi128(v, m, 0x01), p);
+        if (add)
+            v = _mm512_xor_si512(v, _mm512_loadu_si512(dst + i));
+        _mm512_storeu_si512(dst + i, v);
+    }
+    w64_clmul(src + i, dst + i, n - i, multby, add);
+}
+
+/* The XOR of the four lanes of v. */
+
+__attribute__((target("avx512f,avx512bw"))) static inline __m128i
+wide_fold_lanes(__m512i v) {
+    __m256i h;
+
+    h = _mm256_xor_si256(_mm512_castsi512_si256(v),
+                         _mm512_extracti64x4_epi64(v, 1));
+    return _mm_xor_si128(_mm256_castsi256_si128(h),
+                         _mm256_extracti128_si256(h, 1));
+}
+
+__attribute__((target("avx512f,avx512bw,pclmul,vpclmulqdq"))) static unsigned long long
+w64_mac_vpclmul(const unsigned long long *src, unsigned long n,
+                unsigned long long h, unsigned long long acc) {
+    unsigned long long pw[16];
+    __m512i k0, k1, x0, x1, s;
+    __m128i p, a;
+    unsigned long i;
+
+    i = 0;
+    if (n >= 16) {
+        wide_mac_powers(h, pw, 16, w64_clmul_multiply);
+        k0 = _mm512_loadu_si512(pw);
+        k1 = _mm512_loadu_si512(pw + 8);
+        p = _mm_cvtsi64_si128(GALOIS_W64_POLY);
+        a = _mm_cvtsi64_si128((long long)acc);
+        for (; i + 16 <= n; i += 16) {
+            x0 = _mm512_xor_si512(_mm512_loadu_si512(src + i),
+                                  _mm512_zextsi128_si512(a));
+            x1 = _mm512_loadu_si512(src + i + 8);
+            s = _mm512_xor_si512(_mm512_clmulepi64_epi128(x0, k0, 0x00),
+                                 _mm512_clmulepi64_epi128(x0, k0, 0x11));
+            s = _mm512_xor_si512(s, _mm512_clmulepi64_epi128(x1, k1, 0x00));
+            s = _mm512_xor_si512(s, _mm512_clmulepi64_epi128(x1, k1, 0x11));
+            a = w64_clmul_reduce(wide_fold_lanes(s), p);
+        }
+        acc = (unsigned long long)_mm_cvtsi128_si64(a);
+    }
+    return w64_mac_clmul(src + i, n - i, h, acc);
+}
+
+__attribute__((target("avx512f,avx512bw,pclmul,vpclmulqdq"))) static inline void
+w128_vpclmul_product(__m512i a, __m512i b, __m512i *lo, __m512i *mid,
+                     __m512i *hi) {
+    *lo = _mm512_clmulepi64_epi128(a, b, 0x00);
+    *hi = _mm512_clmulepi64_epi128(a, b, 0x11);
+    *mid = _mm512_xor_si512(_mm512_clmulepi64_epi128(a, b, 0x01),
+                            _mm512_clmulepi64_epi128(a, b, 0x10));
+}
+
+__attribute__((target("avx512f,avx512bw,pclmul,vpclmulqdq"))) static void
+w128_vpclmul(const galois_w128 *src, galois_w128 *dst, unsigned long n,
+             galois_w128 multby, unsigned add) {
+    __m512i p, m, v, lo, mid, hi;
+    unsigned long i;
+
+    p = _mm512_set1_epi64(GALOIS_W128_POLY);
+    m = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)&multby));
+    for (i = 0; i + 4 <= n; i += 4) {
+        v = _mm512_loadu_si512(src + i);
+        w128_vpclmul_product(v, m, &lo, &mid, &hi);
+        mid = _mm512_xor_si512(mid, _mm512_clmulepi64_epi128(hi, p, 0x01));
+        lo = _mm512_xor_si512(lo, _mm512_bslli_epi128(mid, 8));
+        lo = _mm512_xor_si512(lo, _mm512_clmulepi64_epi128(hi, p, 0x00));
+        v = _mm512_xor_si512(lo, _mm512_clmulepi64_epi128(mid, p, 0x01));
+        if (add)
+            v = _mm512_xor_si512(v, _mm512_loadu_si512(dst + i));
+        _mm512_storeu_si512(dst + i, v);
+    }
+    w128_clmul(src + i, dst + i, n - i, multby, add);
+}
+
+__attribute__((target("avx512f,avx512bw,pclmul,vpclmulqdq"))) static galois_w128
+w128_mac_vpclmul(const galois_w128 *src, unsigned long n, galois_w128 h,
+                 galois_w128 acc) {
+    __m512i k0, k1, x, lo, mid, hi, l, m, u;
+    galois_w128 pw[8];
+    unsigned long i;
+    __m128i p, a;
+
+    i = 0;
+    if (n >= 8) {
+        wide_mac_powers(h, pw, 8, w128_clmul_multiply);
+        k0 = _mm512_loadu_si512(pw);
+        k1 = _mm512_loadu_si512(pw + 4);
+        p = _mm_cvtsi64_si128(GALOIS_W128_POLY);
+        a = _mm_loadu_si128((const __m128i *)&acc);
+        for (; i + 8 <= n; i += 8) {
+            x = _mm512_xor_si512(_mm512_loadu_si512(src + i),
+                                 _mm512_zextsi128_si512(a));
+            w128_vpclmul_product(x, k0, &lo, &mid, &hi);
+            x = _mm512_loadu_si512(src + i + 4);
+            w128_vpclmul_product(x, k1, &l, &m, &u);
+            a = w128_clmul_reduce(wide_fold_lanes(_mm512_xor_si512(lo, l)),
+                                  wide_fold_lanes(_mm512_xor_si512(mid, m)),
+                                  wide_fold_lanes(_mm512_xor_si512(hi, u)),
+                                  p);
+        }
+        _mm_storeu_si128((__m128i *)&acc, a);
+    }
+    return w128_mac_clmul(src + i, n - i, h, acc);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Dot products                                                            */
+/* ---------------------------------------------------------------------- */
+
+/* These are templated on the number of outputs so that the accumulators
+   are fixed-size arrays the compiler can keep in registers.  Every source
+   vector is loaded once and multiplied into all N accumulators. */
+
+template <int N>
+__attribute__((target("ssse3"))) static void
+w08_dot_ssse3_n(const unsigned char *const *src, unsigned nsrc,
+                unsigned char *const *dst, const unsigned char *tables,
+                unsigned long nbytes) {
+    __m128i acc[N], mask, v, lo, hi;
+    const unsigned char *t;
+    unsigned long i;
+    unsigned j;
+    int n;
+
+    mask = _mm_set1_epi8(0x0f);
+    for (i = 0; i + 16 <= nbytes; i += 16) {
+        for (n = 0; n < N; n++)
+            acc[n] = _mm_setzero_si128();
+        for (j = 0; j < nsrc; j++) {
+            v = _mm_loadu_si128((const __m128i *)(src[j] + i));
+            lo = _mm_and_si128(v, mask);
+            hi = _mm_and_si128(_mm_srli_epi64(v, 4), mask);
+            for (n = 0; n < N; n++) {
+                t = tables + 32 * (n * nsrc + j);
+                acc[n] = _mm_xor_si128(
+                    acc[n],
+                    _mm_xor_si128(
+                        _mm_shuffle_epi8(
+                            _mm_loadu_si128((const __m128i *)t), lo),
+                        _mm_shuffle_epi8(
+                            _mm_loadu_si128((const __m128i *)(t + 16)), hi)));
+            }
+        }
+        for (n = 0; n < N; n++)
+            _mm_storeu_si128((__m128i *)(dst[n] + i), acc[n]);
+    }
+    if (i < nbytes)
+        w08_dot_scalar(src, nsrc, dst, N, tables, i, nbytes);
+}
+
+template <int N>
+__attribute__((target("avx2"))) static void
+w08_dot_avx2_n(const unsigned char *const *src, unsigned nsrc,
+               unsigned char *const *dst, const unsigned char *tables,
+               unsigned long nbytes) {
+    __m256i acc[N], mask, v, lo, hi;
+    const unsigned char *t;
+    unsigned long i;
+    unsigned j;
+    int n;
+
+    mask = _mm256_set1_epi8(0x0f);
+    for (i = 0; i + 32 <= nbytes; i += 32) {
+        for (n = 0; n < N; n++)
+            acc[n] = _mm256_setzero_si256();
+        for (j = 0; j < nsrc; j++) {
+            v = _mm256_loadu_si256((const __m256i *)(src[j] + i));
+            lo = _mm256_and_si256(v, mask);
+            hi = _mm256_and_si256(_mm256_srli_epi64(v, 4), mask);
+            for (n = 0; n < N; n++) {
+                t = tables + 32 * (n * nsrc + j);
+                acc[n] = _mm256_xor_si256(
+                    acc[n],
+                    _mm256_xor_si256(
+                        _mm256_shuffle_epi8(
+                            _mm256_broadcastsi128_si256(
+                                _mm_loadu_si128((const __m128i *)t)),
+                            lo),
+                        _mm256_shuffle_epi8(
+                            _mm256_broadcastsi128_si256(
+                                _mm_loadu_si128((const __m128i *)(t + 16))),
+                            hi)));
+            }
+        }
+        for (n = 0; n < N; n++)
+            _mm256_storeu_si256((__m256i *)(dst[n] + i), acc[n]);
+    }
+    if (i < nbytes)
+        w08_dot_scalar(src, nsrc, dst, N, tables, i, nbytes);
+}
+
+template <int N>
+__attribute__((target("avx512f,avx512bw"))) static void
+w08_dot_avx512_n(const unsigned char *const *src, unsigned nsrc,
+                 unsigned char *const *dst, const unsigned char *tables,
+                 unsigned long nbytes) {
+    __m512i acc[N], mask, v, lo, hi;
+    const unsigned char *t;
+    unsigned long i;
+    unsigned j;
+    int n;
+
+    mask = _mm512_set1_epi8(0x0f);
+    for (i = 0; i + 64 <= nbytes; i += 64) {
+        for (n = 0; n < N; n++)
+            acc[n] = _mm512_setzero_si512();
+        for (j = 0; j < nsrc; j++) {
+            v = _mm512_loadu_si512((const void *)(src[j] + i));
+            lo = _mm512_and_si512(v, mask);
+            hi = _mm512_and_si512(_mm512_srli_epi64(v, 4), mask);
+            for (n = 0; n < N; n++) {
+                t = tables + 32 * (n * nsrc + j);
+                acc[n] = _mm512_xor_si512(
+                    acc[n],
+                    _mm512_xor_si512(
+                        _mm512_shuffle_epi8(
+                            _mm512_broadcast_i32x4(
+                                _mm_loadu_si128((const __m128i *)t)),
+                            lo),
+                        _mm512_shuffle_epi8(
+                            _mm512_broadcast_i32x4(
+                                _mm_loadu_si128((const __m128i *)(t + 16))),
+                            hi)));
+            }
+        }
+        for (n = 0; n < N; n++)
+            _mm512_storeu_si512((void *)(dst[n] + i), acc[n]);
+    }
+    if (i < nbytes)
+        w08_dot_scalar(src, nsrc, dst, N, tables, i, nbytes);
+}
+
+template <int N>
+__attribute__((target("ssse3"))) static void
+w16_dot_ssse3_n(const unsigned short *const *src, unsigned nsrc,
+                unsigned short *const *dst, const unsigned char *tables,
+                unsigned long nwords) {
+    __m128i rlo[N], rhi[N], nib[4], mask, bmask, a, b, lo, hi, tl, th;
+    const unsigned char *t;
+    unsigned long i;
+    unsigned j;
+    int n, k;
+
+    mask = _mm_set1_epi8(0x0f);
+    bmask = _mm_set1_epi16(0x00ff);
+    for (i = 0; i + 16 <= nwords; i += 16) {
+        for (n = 0; n < N; n++) {
+            rlo[n] = _mm_setzero_si128();
+            rhi[n] = _mm_setzero_si128();
+        }
+        for (j = 0; j < nsrc; j++) {
+            a = _mm_loadu_si128((const __m128i *)(src[j] + i));
+            b = _mm_loadu_si128((const __m128i *)(src[j] + i + 8));
+            lo = _mm_packus_epi16(_mm_and_si128(a, bmask),
+                                  _mm_and_si128(b, bmask));
+            hi = _mm_packus_epi16(_mm_srli_epi16(a, 8),
+                                  _mm_srli_epi16(b, 8));
+            nib[0] = _mm_and_si128(lo, mask);
+            nib[1] = _mm_and_si128(_mm_srli_epi64(lo, 4), mask);
+            nib[2] = _mm_and_si128(hi, mask);
+            nib[3] = _mm_and_si128(_mm_srli_epi64(hi, 4), mask);
+            for (n = 0; n < N; n++) {
+                t = tables + 128 * (n * nsrc + j);
+                for (k = 0; k < 4; k++) {
+                    tl = _mm_loadu_si128((const __m128i *)(t + 32 * k));
+                    th = _mm_loadu_si128((const __m128i *)(t + 32 * k + 16));
+                    rlo[n] = _mm_xor_si128(
+                        rlo[n], _mm_shuffle_epi8(tl, nib[k]));
+                    rhi[n] = _mm_xor_si128(
+                        rhi[n], _mm_shuffle_epi8(th, nib[k]));
+                }
+            }
+        }
+        for (n = 0; n < N; n++) {
+            _mm_storeu_si128((__m128i *)(dst[n] + i),
+                             _mm_unpacklo_epi8(rlo[n], rhi[n]));
+            _mm_storeu_si128((__m128i *)(dst[n] + i + 8),
+                             _mm_unpackhi_epi8(rlo[n], rhi[n]));
+        }
+    }
+    if (i < nwords)
+        w16_dot_scalar(src, nsrc, dst, N, tables, i, nwords);
+}
+
+template <int N>
+__attribute__((target("avx2"))) static void
+w16_dot_avx2_n(const unsigned short *const *src, unsigned nsrc,
+               unsigned short *const *dst, const unsigned char *tables,
+               unsigned long nwords) {
+    __m256i rlo[N], rhi[N], nib[4], mask, bmask, a, b, lo, hi, tl, th;
+    const unsigned char *t;
+    unsigned long i;
+    unsigned j;
+    int n, k;
+
+    mask = _mm256_set1_epi8(0x0f);
+    bmask = _mm256_set1_epi16(0x00ff);
+    for (i = 0; i + 32 <= nwords; i += 32) {
+        for (n = 0; n < N; n++) {
+            rlo[n] = _mm256_setzero_si256();
+            rhi[n] = _mm256_setzero_si256();
+        }
+        for (j = 0; j < nsrc; j++) {
+            a = _mm256_loadu_si256((const __m256i *)(src[j] + i));
+            b = _mm256_loadu_si256((const __m256i *)(src[j] + i + 16));
+            lo = _mm256_packus_epi16(_mm256_and_si256(a, bmask),
+                                     _mm256_and_si256(b, bmask));
+            hi = _mm256_packus_epi16(_mm256_srli_epi16(a, 8),
+                                     _mm256_srli_epi16(b, 8));
+            nib[0] = _mm256_and_si256(lo, mask);
+            nib[1] = _mm256_and_si256(_mm256_srli_epi64(lo, 4), mask);
+            nib[2] = _mm256_and_si256(hi, mask);
+            nib[3] = _mm256_and_si256(_mm256_srli_epi64(hi, 4), mask);
+            for (n = 0; n < N; n++) {
+                t = tables + 128 * (n * nsrc + j);
+                for (k = 0; k < 4; k++) {
+                    tl = _mm256_broadcastsi128_si256(
+                        _mm_loadu_si128((const __m128i *)(t + 32 * k)));
+                    th = _mm256_broadcastsi128_si256(
+                        _mm_loadu_si128((const __m128i *)(t + 32 * k + 16)));
+                    rlo[n] = _mm256_xor_si256(
+                        rlo[n], _mm256_shuffle_epi8(tl, nib[k]));
+                    rhi[n] = _mm256_xor_si256(
+                        rhi[n], _mm256_shuffle_epi8(th, nib[k]));
+                }
+            }
+        }
+        for (n = 0; n < N; n++) {
+            _mm256_storeu_si256((__m256i *)(dst[n] + i),
+                                _mm256_unpacklo_epi8(rlo[n], rhi[n]));
+            _mm256_storeu_si256((__m256i *)(dst[n] + i + 16),
+                                _mm256_unpackhi_epi8(rlo[n], rhi[n]));
+        }
+    }
+    if (i < nwords)
+        w16_dot_scalar(src, nsrc, dst, N, tables, i, nwords);
+}
+
+template <int N>
+__attribute__((target("avx512f,avx512bw"))) static void
+w16_dot_avx512_n(const unsigned short *const *src, unsigned nsrc,
+                 unsigned short *const *dst, const unsigned char *tables,
+                 unsigned long nwords) {
+    __m512i rlo[N], rhi[N], nib[4], mask, bmask, a, b, lo, hi, tl, th;
+    const unsigned char *t;
+    unsigned long i;
+    unsigned j;
+    int n, k;
+
+    mask = _mm512_set1_epi8(0x0f);
+    bmask = _mm512_set1_epi16(0x00ff);
+    for (i = 0; i + 64 <= nwords; i += 64) {
+        for (n = 0; n < N; n++) {
+            rlo[n] = _mm512_setzero_si512();
+            rhi[n] = _mm512_setzero_si512();
+        }
+        for (j = 0; j < nsrc; j++) {
+            a = _mm512_loadu_si512((const void *)(src[j] + i));
+            b = _mm512_loadu_si512((const void *)(src[j] + i + 32));
+            lo = _mm512_packus_epi16(_mm512_and_si512(a, bmask),
+                                     _mm512_and_si512(b, bmask));
+            hi = _mm512_packus_epi16(_mm512_srli_epi16(a, 8),
+                                     _mm512_srli_epi16(b, 8));
+            nib[0] = _mm512_and_si512(lo, mask);
+            nib[1] = _mm512_and_si512(_mm512_srli_epi64(lo, 4), mask);
+            nib[2] = _mm512_and_si512(hi, mask);
+            nib[3] = _mm512_and_si512(_mm512_srli_epi64(hi, 4), mask);
+            for (n = 0; n < N; n++) {
+                t = tables + 128 * (n * nsrc + j);
+                for (k = 0; k < 4; k++) {
+                    tl = _mm512_broadcast_i32x4(
+                        _mm_loadu_si128((const __m128i *)(t + 32 * k)));
+                    th = _mm512_broadcast_i32x4(
+                        _mm_loadu_si128((const __m128i *)(t + 32 * k + 16)));
+                    rlo[n] = _mm512_xor_si512(
+                        rlo[n], _mm512_shuffle_epi8(tl, nib[k]));
+                    rhi[n] = _mm512_xor_si512(
+                        rhi[n], _mm512_shuffle_epi8(th, nib[k]));
+                }
+            }
+        }
+        for (n = 0; n < N; n++) {
+            _mm512_storeu_si512((void *)(dst[n] + i),
+                                _mm512_unpacklo_epi8(rlo[n], rhi[n]));
+            _mm512_storeu_si512((void *)(dst[n] + i + 32),
+                                _mm512_unpackhi_epi8(rlo[n], rhi[n]));
+        }
+    }
+    if (i < nwords)
+        w16_dot_scalar(src, nsrc, dst, N, tables, i, nwords);
+}
+
+/* For w = 32 the products are summed before they are reduced, since
+   reduction is linear.  That leaves one reduction per output word instead
+   of one per product. */
+
+template <int N>
+__attribute__((target("sse2,pclmul"))) static void
+w32_dot_clmul_n(const unsigned *const *src, unsigned nsrc,
+                unsigned *const *dst, const unsigned *coeffs,
+                unsigned long long poly, unsigned long long mu,
+                unsigned long nwords) {
+    __m128i acce[N], acco[N], k, lmask, v, e, o, c;
+    unsigned long i;
+    unsigned j, prod;
+    int n;
+
+    k = _mm_set_epi64x((long long)poly, (long long)mu);
+    lmask = _mm_set1_epi64x(0xffffffffLL);
+
+    for (i = 0; i + 4 <= nwords; i += 4) {
+        for (n = 0; n < N; n++) {
+            acce[n] = _mm_setzero_si128();
+            acco[n] = _mm_setzero_si128();
+        }
+        for (j = 0; j < nsrc; j++) {
+            v = _mm_loadu_si128((const __m128i *)(src[j] + i));
+            e = _mm_and_si128(v, lmask);
+            o = _mm_srli_epi64(v, 32);
+            for (n = 0; n < N; n++) {
+                c = _mm_cvtsi32_si128(coeffs[n * nsrc + j]);
+                acce[n] = _mm_xor_si128(
+                    acce[n],
+                    _mm_unpacklo_epi64(_mm_clmulepi64_si128(e, c, 0x00),
+                                       _mm_clmulepi64_si128(e, c, 0x01)));
+                acco[n] = _mm_xor_si128(
+                    acco[n],
+                    _mm_unpacklo_epi64(_mm_clmulepi64_si128(o, c, 0x00),
+                                       _mm_clmulepi64_si128(o, c, 0x01)));
+            }
+        }
+        for (n = 0; n < N; n++) {
+            e = _mm_and_si128(w32_clmul_reduce(acce[n], k), lmask);
+            o = _mm_slli_epi64(w32_clmul_reduce(acco[n], k), 32);
+            _mm_storeu_si128((__m128i *)(dst[n] + i), _mm_or_si128(e, o));
+        }
+    }
+    for (; i < nwords; i++) {
+        for (n = 0; n < N; n++) {
+            prod = 0;
+            for (j = 0; j < nsrc; j++)
+                prod ^= w32_clmul_multiply(src[j][i], coeffs[n * nsrc + j],
+                                           poly, mu);
+            dst[n][i] = prod;
+        }
+    }
+}
+
+/* Pick the template instance for ndst outputs. */
+
+#define GALOIS_DOT_DISPATCH(fn, ndst, ...)                                     \
+    switch (ndst) {                                                            \
+    case 1:                                                                    \
+        fn<1>(__VA_ARGS__);                                                    \
+        break;                                                                 \
+    case 2:                                                                    \
+        fn<2>(__VA_ARGS__);                                                    \
+        break;                                                                 \
+    case 3:                                                                    \
+        fn<3>(__VA_ARGS__);                                                    \
+        break;                                                                 \
+    default:                                                                   \
+        fn<4>(__VA_ARGS__);                                                    \
+        break;                                                                 \
+    }
+
+static void w08_dot_ssse3(const unsigned char *const *src, unsigned nsrc,
+                          unsigned char *const *dst, unsigned ndst,
+                          const unsigned char *tables, unsigned long nbytes) {
+    GALOIS_DOT_DISPATCH(w08_dot_ssse3_n, ndst, src, nsrc, dst, tables, nbytes)
+}
+
+static void w08_dot_avx2(const unsigned char *const *src, unsigned nsrc,
+                         unsigned char *const *dst, unsigned ndst,
+                         const unsigned char *tables, unsigned long nbytes) {
+    GALOIS_DOT_DISPATCH(w08_dot_avx2_n, ndst, src, nsrc, dst, tables, nbytes)
+}
+
+static void w08_dot_avx512(const unsigned char *const *src, unsigned nsrc,
+                           unsigned char *const *dst, unsigned ndst,
+                           const unsigned char *tables, unsigned long nbytes) {
+    GALOIS_DOT_DISPATCH(w08_dot_avx512_n, ndst, src, nsrc, dst, tables, nbytes)
+}
+
+static void w16_dot_ssse3(const unsigned short *const *src, unsigned nsrc,
+                          unsigned short *const *dst, unsigned ndst,
+                          const unsigned char *tables, unsigned long nwords) {
+    GALOIS_DOT_DISPATCH(w16_dot_ssse3_n, ndst, src, nsrc, dst, tables, nwords)
+}
+
+static void w16_dot_avx2(const unsigned short *const *src, unsigned nsrc,
+                         unsigned short *const *dst, unsigned ndst,
+                         const unsigned char *tables, unsigned long nwords) {
+    GALOIS_DOT_DISPATCH(w16_dot_avx2_n, ndst, src, nsrc, dst, tables, nwords)
+}
+
+static void w16_dot_avx512(const unsigned short *const *src, unsigned nsrc,
+                           unsigned short *const *dst, unsigned ndst,
+                           const unsigned char *tables, unsigned long nwords) {
+    GALOIS_DOT_DISPATCH(w16_dot_avx512_n, ndst, src, nsrc, dst, tables, nwords)
+}
+
+static void w32_dot_clmul(const unsigned *const *src, unsigned nsrc,
+                          unsigned *const *dst, unsigned ndst,
+                          const unsigned *coeffs, unsigned long long poly,
+                          unsigned long long mu, unsigned long nwords) {
+    GALOIS_DOT_DISPATCH(w32_dot_clmul_n, ndst, src, nsrc, dst, coeffs, poly,
+                        mu, nwords)
+}
+
+#endif /* GALOIS_X86 */
+
+/* ---------------------------------------------------------------------- */
+/* Dispatch                                                                */
+/* ---------------------------------------------------------------------- */
+
+static const galois_kernel_table scalar_kernels = {
+    GALOIS_SIMD_NONE, w08_scalar,       NULL,             NULL,
+    NULL,             NULL,             NULL,
+    xor_scalar,       w08_batch_scalar, w16_batch_scalar, NULL,
+    xor_n_scalar,     w64_multiply_scalar, w64_scalar, w64_mac_scalar,
+    w128_multiply_scalar, w128_scalar, w128_mac_scalar,
+    w32_split_scalar, w32_altmap_scalar};
+
+#ifdef GALOIS_X86
+static const galois_kernel_table ssse3_kernels = {
+    GALOIS_SIMD_SSSE3, w08_ssse3,        w16_ssse3,        w32_clmul_multiply,
+    w08_dot_ssse3,     w16_dot_ssse3,    w32_dot_clmul,
+    xor_sse2,          w08_batch_scalar, w16_batch_scalar, w32_batch_clmul,
+    xor_n_sse2,        w64_clmul_multiply, w64_clmul, w64_mac_clmul,
+    w128_clmul_multiply, w128_clmul, w128_mac_clmul,
+    w32_split_ssse3, w32_altmap_ssse3};
+static const galois_kernel_table avx2_kernels = {
+    GALOIS_SIMD_AVX2, w08_avx2,       w16_avx2,       w32_clmul_multiply,
+    w08_dot_avx2,     w16_dot_avx2,   w32_dot_clmul,
+    xor_avx2,         w08_batch_avx2, w16_batch_avx2, w32_batch_clmul,
+    xor_n_avx2,       w64_clmul_multiply, w64_clmul, w64_mac_clmul,
+    w128_clmul_multiply, w128_clmul, w128_mac_clmul,
+    w32_split_avx2, w32_altmap_avx2};
+static const galois_kernel_table avx512_kernels = {
+    GALOIS_SIMD_AVX512, w08_avx512,       w16_avx512,       w32_clmul_multiply,
+    w08_dot_avx512,     w16_dot_avx512,   w32_dot_clmul,
+    xor_avx512,         w08_batch_avx512, w16_batch_avx512, w32_batch_clmul,
+    xor_n_avx512,       w64_clmul_multiply, w64_vpclmul, w64_mac_vpclmul,
+    w128_clmul_multiply, w128_vpclmul, w128_mac_vpclmul,
+    w32_split_avx512, w32_altmap_avx512};
+#endif
+
+/* Constant-initialized to the portable kernels, so that anything running
+   before the dynamic initializer below still gets correct results. */
+galois_kernel_table galois_kernels = scalar_kernels;
+
+static unsigned cpu_simd_level() {
+#ifdef GALOIS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw"))
+        return GALOIS_SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return GALOIS_SIMD_AVX2;
+    if (__builtin_cpu_supports("ssse3"))
+        return GALOIS_SIMD_SSSE3;
+#endif
+    return GALOIS_SIMD_NONE;
+}
+
+static bool cpu_has_clmul() {
+#ifdef GALOIS_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul");
+#else
+    return false;
+#endif
+}
+
+static bool cpu_has_vpclmul() {
+#ifdef GALOIS_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("vpclmulqdq");
+#else
+    return false;
+#endif
+}
+
+unsigned galois_get_simd_level() { return galois_kernels.level; }
+
+unsigned galois_set_simd_level(unsigned level) {
+    if (level > cpu_simd_level())
+        return -1;
+
+    switch (level) {
+    case GALOIS_SIMD_NONE:
+        galois_kernels = scalar_kernels;
+        return 0;
+#ifdef GALOIS_X86
+    case GALOIS_SIMD_SSSE3:
+        galois_kernels = ssse3_kernels;
+        break;
+    case GALOIS_SIMD_AVX2:
+        galois_kernels = avx2_kernels;
+        break;
+    case GALOIS_SIMD_AVX512:
+        galois_kernels = avx512_kernels;
+        break;
+#endif
+    default:
+        return -1;
+    }
+
+    /* Carry-less multiply is a separate cpuid bit from the vector levels. */
+    if (!cpu_has_clmul()) {
+        galois_kernels.w32_multiply = NULL;
+        galois_kernels.w32_dot = NULL;
+        galois_kernels.w32_batch = NULL;
+        galois_kernels.w64_multiply = w64_multiply_scalar;
+        galois_kernels.w64 = w64_scalar;
+        galois_kernels.w64_mac = w64_mac_scalar;
+        galois_kernels.w128_multiply = w128_multiply_scalar;
+        galois_kernels.w128 = w128_scalar;
+        galois_kernels.w128_mac = w128_mac_scalar;
+#ifdef GALOIS_X86
+    } else if (level == GALOIS_SIMD_AVX512 && !cpu_has_vpclmul()) {
+        galois_kernels.w64 = w64_clmul;
+        galois_kernels.w64_mac = w64_mac_clmul;
+        galois_kernels.w128 = w128_clmul;
+        galois_kernels.w128_mac = w128_mac_clmul;
+#endif
+    }
+    return 0;
+}
+
+[[maybe_unused]] static const unsigned simd_level_at_load =
+    (galois_set_simd_level(cpu_simd_level()), galois_kernels.level);
@@ -0,0 +1,186 @@
+/* galois_simd.h
+ *
+ * Internal interface between galois.cpp and the vectorized region kernels in
+ * galois_simd.cpp.  The kernels only see plain byte/word pointers and the
+ * tables that galois.cpp passes them, so they never look up the global
+ * log/mult tables themselves.
+ *
+ * This header is not installed.
+ */
+
+#ifndef GALOIS_SIMD_H
+#define GALOIS_SIMD_H
+
+#include "galois_wide.h"
+
+/* w = 8: tables[0..15] holds multby * i and tables[16..31] holds
+   multby * (i << 4), for i = 0..15.  If add is set the products are XOR'd
+   into dst, otherwise dst is overwritten.  src and dst may be equal. */
+typedef void (*galois_w08_kernel)(const unsigned char *src, unsigned char *dst,
+                                  unsigned long nbytes,
+                                  const unsigned char *tables, unsigned add);
+
+/* w = 16: the product is split by the four nibbles of each source word.
+   For nibble k (0 = least significant), tables[32k + n] holds the low byte
+   of multby * (n << 4k) and tables[32k + 16 + n] holds its high byte.
+   nwords is the number of 16-bit words. */
+typedef void (*galois_w16_kernel)(const unsigned short *src,
+                                  unsigned short *dst, unsigned long nwords,
+                                  const unsigned char *tables, unsigned add);
+
+/* w = 32 carry-less multiplication.  The field polynomial is x^32 + poly,
+   and mu is the low 32 bits of floor(x^64 / (x^32 + poly)), which is what
+   the Barrett reduction multiplies by. */
+typedef unsigned (*galois_w32_multiply_fn)(unsigned x, unsigned y,
+                                           unsigned long long poly,
+                                           unsigned long long mu);
+
+/* w = 32 split-4:  the product is split by the eight nibbles of each
+   source word.  For nibble k (0 = least significant), tables[64k + 16b + n]
+   holds byte b of multby * (n << 4k), so the tables take 512 bytes and are
+   built per multiplier.  The altmap kernel takes regions in the altmap
+   layout of galois_w32_region_to_altmap():  whole 64-byte blocks, each
+   holding byte 0 of its 16 words, then byte 1, 2 and 3, with any words
+   after the last whole block in the standard layout. */
+typedef void (*galois_w32_split_kernel)(const unsigned *src, unsigned *dst,
+                                        unsigned long nwords,
+                                        const unsigned char *tables,
+                                        unsigned add);
+
+/* Dot-product kernels for the matrix region multiplies.  Each computes
+   ndst (1 .. GALOIS_DOT_MAX) outputs from nsrc sources:
+
+     dst[n] = sum over j of coefficient(n, j) * src[j]
+
+   overwriting dst.  For w = 8 and w = 16 the coefficients are given as the
+   same nibble tables the region kernels use, one set per (n, j) pair, at
+   tables + size * (n * nsrc + j) with size 32 and 128 respectively.  For
+   w = 32 they are plain values, coeffs[n * nsrc + j]. */
+
+#define GALOIS_DOT_MAX 4
+
+typedef void (*galois_w08_dot_kernel)(const unsigned char *const *src,
+                                      unsigned nsrc, unsigned char *const *dst,
+                                      unsigned ndst,
+                                      const unsigned char *tables,
+                                      unsigned long nbytes);
+typedef void (*galois_w16_dot_kernel)(const unsigned short *const *src,
+                                      unsigned nsrc,
+                                      unsigned short *const *dst,
+                                      unsigned ndst,
+                                      const unsigned char *tables,
+                                      unsigned long nwords);
+typedef void (*galois_w32_dot_kernel)(const unsigned *const *src,
+                                      unsigned nsrc, unsigned *const *dst,
+                                      unsigned ndst, const unsigned *coeffs,
+                                      unsigned long long poly,
+                                      unsigned long long mu,
+                                      unsigned long nwords);
+
+/* r3 = r1 ^ r2 over nbytes bytes.  r3 may be equal to r1 or r2. */
+typedef void (*galois_xor_kernel)(const unsigned char *r1,
+                                  const unsigned char *r2, unsigned char *r3,
+                                  unsigned long nbytes);
+
+/* dst = src[0] ^ src[1] ^ ... ^ src[nsrc - 1] over nbytes bytes, in one
+   pass, with nsrc >= 1.  dst may be one of the sources.  If stream is set,
+   dst is written with non-temporal stores where the kernel has them, and
+   the stores are fenced before it returns. */
+typedef void (*galois_xor_n_kernel)(const unsigned char *const *src,
+                                    unsigned nsrc, unsigned char *dst,
+                                    unsigned long nbytes, unsigned stream);
+
+/* GF(2^64) and GF(2^128), modulo x^64 + GALOIS_W64_POLY and
+   x^128 + GALOIS_W128_POLY (see galois_wide.h).  The region kernels take
+   multby itself and count elements in n, and add as the other region
+   kernels do; the mac kernels return the acc of galois_wXX_region_mac(). */
+
+#define GALOIS_W64_POLY 0x1bULL
+#define GALOIS_W128_POLY 0x87ULL
+
+typedef unsigned long long (*galois_w64_multiply_fn)(unsigned long long x,
+                                                     unsigned long long y);
+typedef void (*galois_w64_kernel)(const unsigned long long *src,
+                                  unsigned long long *dst, unsigned long n,
+                                  unsigned long long multby, unsigned add);
+typedef unsigned long long (*galois_w64_mac_kernel)(
+    const unsigned long long *src, unsigned long n, unsigned long long h,
+    unsigned long long acc);
+typedef galois_w128 (*galois_w128_multiply_fn)(galois_w128 x, galois_w128 y);
+typedef void (*galois_w128_kernel)(const galois_w128 *src, galois_w128 *dst,
+                                   unsigned long n, galois_w128 multby,
+                                   unsigned add);
+typedef galois_w128 (*galois_w128_mac_kernel)(const galois_w128 *src,
+                                              unsigned long n, galois_w128 h,
+                                              galois_w128 acc);
+
+/* Element-wise arithmetic for galois_batch_multiply/divide/inverse():
+
+     out[i] = x[i] * y[i]   or, if divide is set,   out[i] = x[i] / y[i]
+
+   with x[i] taken as 1 if x is NULL.  Products with a zero are zero, and
+   dividing by zero gives all ones, as in galois_single_multiply/divide.
+   For w = 8 and 16, log and ilog are the field's compact log tables (see
+   galois_get_compact_log_table()), which are padded so that a 32-bit load
+   at any entry stays inside the allocation.  w = 32 only multiplies, and
+   takes poly and mu as galois_w32_multiply_fn does.  out may be equal to x
+   or y. */
+typedef void (*galois_w08_batch_kernel)(const unsigned char *x,
+                                        const unsigned char *y,
+                                        unsigned char *out, unsigned long n,
+                                        const unsigned char *log,
+                                        const unsigned char *ilog,
+                                        unsigned divide);
+typedef void (*galois_w16_batch_kernel)(const unsigned short *x,
+                                        const unsigned short *y,
+                                        unsigned short *out, unsigned long n,
+                                        const unsigned short *log,
+                                        const unsigned short *ilog,
+                                        unsigned divide);
+typedef void (*galois_w32_batch_kernel)(const unsigned *x, const unsigned *y,
+                                        unsigned *out, unsigned long n,
+                                        unsigned long long poly,
+                                        unsigned long long mu);
+
+struct galois_kernel_table {
+    unsigned level; /* One of galois_simd_level */
+    galois_w08_kernel w08;
+    galois_w16_kernel w16; /* NULL: use the log tables */
+
+    /* NULL when the CPU has no carry-less multiply; then single w = 32
+       multiplies use the split_w8 tables.  w = 32 regions always use the
+       split-4 kernels below, which are faster than carry-less multiply
+       from SSSE3 up. */
+    galois_w32_multiply_fn w32_multiply;
+
+    /* NULL: galois.cpp falls back to blocked calls of the region kernels */
+    galois_w08_dot_kernel w08_dot;
+    galois_w16_dot_kernel w16_dot;
+    galois_w32_dot_kernel w32_dot;
+
+    galois_xor_kernel region_xor; /* Never NULL */
+
+    galois_w08_batch_kernel w08_batch; /* Never NULL */
+    galois_w16_batch_kernel w16_batch; /* Never NULL */
+    galois_w32_batch_kernel w32_batch; /* NULL without carry-less multiply */
+
+    galois_xor_n_kernel region_xor_n; /* Never NULL */
+
+    /* Never NULL:  without carry-less multiply these are the portable
+       kernels. */
+    galois_w64_multiply_fn w64_multiply;
+    galois_w64_kernel w64;
+    galois_w64_mac_kernel w64_mac;
+    galois_w128_multiply_fn w128_multiply;
+    galois_w128_kernel w128;
+    galois_w128_mac_kernel w128_mac;
+
+    galois_w32_split_kernel w32_split;  /* Never NULL */
+    galois_w32_split_kernel w32_altmap; /* Never NULL */
+};
+
+/* The kernel table in use.  It is filled in at load time with the best
+   kernels the CPU supports, and may be changed by galois_set_simd_level(). */
+extern galois_kernel_table galois_kernels;
+
+#endif
@@ -0,0 +1,88 @@
+/* galois_static_tables.h
+ *
+ * Compile-time generation of the log/ilog tables for w <= 16 and the
+ * mult/div tables for w <= 8, used when the library is built with
+ * GALOIS_CONSTEXPR_TABLES.  The tables have exactly the layout that
+ * galois_create_log_tables() and galois_create_mult_tables() produce, so
+ * galois.cpp can start out with its table pointers aimed at them and never
+ * build those tables at run time.
+ *
+ * This header is not installed.
+ */
+
+#ifndef GALOIS_STATIC_TABLES_H
+#define GALOIS_STATIC_TABLES_H
+
+#include <type_traits>
+
+/* The entry type galois.cpp uses for w:  the narrowest that holds w bits. */
+template <unsigned W>
+using galois_static_entry = typename std::conditional<
+    (W <= 8), unsigned char,
+    typename std::conditional<(W <= 16), unsigned short,
+                              unsigned>::type>::type;
+
+/* log has 2^w entries, with log[0] = 2^w - 1 as in the run-time tables.
+   ilog holds the powers of the generator for exponents 0 .. 2 (2^w - 1),
+   which covers log x + log y and log x + 2^w - 1 - log y.  pad keeps the
+   4-byte gathers of the batch kernels inside the object. */
+template <unsigned W> struct galois_log_data {
+    galois_static_entry<W> log[1u << W];
+    galois_static_entry<W> ilog[(2u << W) - 1];
+    unsigned pad;
+};
+
+template <unsigned W> struct galois_mult_data {
+    galois_static_entry<W> mult[1u << (2 * W)];
+    galois_static_entry<W> div[1u << (2 * W)];
+};
+
+template <unsigned W>
+constexpr galois_log_data<W> galois_make_log_data(unsigned poly) {
+    constexpr unsigned n = 1u << W;
+    constexpr unsigned nm1 = n - 1;
+    galois_log_data<W> t{};
+    unsigned j = 0, b = 1;
+
+    for (j = 0; j < n; j++)
+        t.log[j] = nm1;
+
+    for (j = 0; j < nm1; j++) {
+        t.log[b] = j;
+        t.ilog[j] = b;
+        t.ilog[j + nm1] = b;
+        b = b << 1;
+        if (b & n)
+            b = (b ^ poly) & nm1;
+    }
+    t.ilog[2 * nm1] = t.ilog[0];
+    return t;
+}
+
+template <unsigned W>
+constexpr galois_mult_data<W> galois_make_mult_data(unsigned poly) {
+    constexpr unsigned n = 1u << W;
+    constexpr unsigned nm1 = n - 1;
+    galois_log_data<W> l = galois_make_log_data<W>(poly);
+    galois_mult_data<W> t{};
+    unsigned x = 0, y = 0, j = 0;
+
+    for (x = 0; x < n; x++) {
+        for (y = 0; y < n; y++) {
+            j = (x << W) | y;
+            if (y == 0) {
+                t.mult[j] = 0;
+                t.div[j] = nm1;
+            } else if (x == 0) {
+                t.mult[j] = 0;
+                t.div[j] = 0;
+            } else {
+                t.mult[j] = l.ilog[l.log[x] + l.log[y]];
+                t.div[j] = l.ilog[l.log[x] + nm1 - l.log[y]];
+            }
+        }
+    }
+    return t;
+}
+
+#endif
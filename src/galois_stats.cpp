@@ -0,0 +1,173 @@
+/* galois_stats.cpp
+ *
+ * Statistics.  Each thread's per-call counters live in a thread_local
+ * object that registers itself on first use and, when the thread exits,
+ * folds its counts into a total for retired threads.  A snapshot sums the
+ * retired total and every live thread's counters, less the baseline taken
+ * by the last reset, so a reset never has to write another thread's
+ * counters.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "galois_counters.h"
+#include "galois_stats.h"
+
+static std::atomic<unsigned long long> galois_table_builds[GALOIS_STATS_NTABLES];
+static std::atomic<unsigned long long> galois_table_maps[GALOIS_STATS_NTABLES];
+static std::atomic<unsigned long long> galois_table_ns[GALOIS_STATS_NTABLES];
+static std::atomic<unsigned long long> galois_table_bytes[GALOIS_STATS_NTABLES];
+
+unsigned long long galois_counters_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void galois_count_table(unsigned kind, bool mapped, unsigned long long start,
+                        unsigned long long bytes) {
+    if (mapped)
+        galois_table_maps[kind].fetch_add(1, std::memory_order_relaxed);
+    else
+        galois_table_builds[kind].fetch_add(1, std::memory_order_relaxed);
+    galois_table_ns[kind].fetch_add(galois_counters_now() - start,
+                                    std::memory_order_relaxed);
+    galois_table_bytes[kind].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void galois_uncount_table(unsigned kind, unsigned long long bytes) {
+    galois_table_bytes[kind].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+/* stats += c, for the per-call fields. */
+static void galois_stats_add(galois_stats *stats, const galois_counters &c) {
+    unsigned i;
+
+    for (i = 0; i < 33; i++) {
+        stats->single_multiply[i] +=
+            c.single_multiply[i].load(std::memory_order_relaxed);
+        stats->single_divide[i] +=
+            c.single_divide[i].load(std::memory_order_relaxed);
+    }
+    for (i = 0; i < 5; i++) {
+        stats->region_overwrite[i] +=
+            c.region_overwrite[i].load(std::memory_order_relaxed);
+        stats->region_add[i] += c.region_add[i].load(std::memory_order_relaxed);
+        stats->region_bytes[i] +=
+            c.region_bytes[i].load(std::memory_order_relaxed);
+    }
+}
+
+/* stats -= base, for the per-call fields. */
+static void galois_stats_sub(galois_stats *stats, const galois_stats &base) {
+    unsigned i;
+
+    for (i = 0; i < 33; i++) {
+        stats->single_multiply[i] -= base.single_multiply[i];
+        stats->single_divide[i] -= base.single_divide[i];
+    }
+    for (i = 0; i < 5; i++) {
+        stats->region_overwrite[i] -= base.region_overwrite[i];
+        stats->region_add[i] -= base.region_add[i];
+        stats->region_bytes[i] -= base.region_bytes[i];
+    }
+}
+
+#ifdef GALOIS_STATS
+
+std::atomic<bool> galois_counters_on{false};
+
+namespace {
+
+struct galois_counter_registry {
+    std::mutex lock; /* Protects everything below */
+    std::vector<const galois_counters *> live;
+    galois_stats retired = {}; /* Threads that have exited */
+    galois_stats baseline = {}; /* Totals at the last reset */
+
+    /* The caller holds lock. */
+    void total(galois_stats *stats) {
+        *stats = retired;
+        for (const galois_counters *c : live)
+            galois_stats_add(stats, *c);
+    }
+};
+
+/* Never destroyed, so that threads that outlive static destruction can
+   still retire their counters. */
+galois_counter_registry &galois_registry() {
+    static galois_counter_registry *r = new galois_counter_registry;
+    return *r;
+}
+
+struct galois_thread_counters {
+    galois_counters c = {};
+
+    galois_thread_counters() {
+        galois_counter_registry &r = galois_registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        r.live.push_back(&c);
+    }
+
+    ~galois_thread_counters() {
+        galois_counter_registry &r = galois_registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        galois_stats_add(&r.retired, c);
+        r.live.erase(std::find(r.live.begin(), r.live.end(), &c));
+    }
+};
+
+} // namespace
+
+galois_counters *galois_counters_register() {
+    static thread_local galois_thread_counters local;
+
+    galois_counters_mine = &local.c;
+    return &local.c;
+}
+
+unsigned galois_set_stats(unsigned on) {
+    galois_counters_on.store(on != 0, std::memory_order_relaxed);
+    return 0;
+}
+
+void galois_reset_stats() {
+    galois_counter_registry &r = galois_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.total(&r.baseline);
+}
+
+#else
+
+unsigned galois_set_stats(unsigned on) { return on ? -1 : 0; }
+
+void galois_reset_stats() {}
+
+#endif
+
+void galois_get_stats(galois_stats *stats) {
+    unsigned i;
+
+    memset(stats, 0, sizeof(*stats));
+#ifdef GALOIS_STATS
+    {
+        galois_counter_registry &r = galois_registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        r.total(stats);
+        galois_stats_sub(stats, r.baseline);
+    }
+#endif
+    for (i = 0; i < GALOIS_STATS_NTABLES; i++) {
+        stats->table_builds[i] =
+            galois_table_builds[i].load(std::memory_order_relaxed);
+        stats->table_maps[i] = galois_table_maps[i].load(std::memory_order_relaxed);
+        stats->table_build_ns[i] =
+            galois_table_ns[i].load(std::memory_order_relaxed);
+        stats->table_bytes[i] =
+            galois_table_bytes[i].load(std::memory_order_relaxed);
+    }
+}
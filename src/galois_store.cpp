@@ -0,0 +1,269 @@
+/* galois_store.cpp
+ *
+ * The persistent table store.  Once galois_set_table_store() names a
+ * directory, each table set lives in its own file there, named after the
+ * set, w and the format version, e.g. galois-log-w22-v1.tbl.  A file is a
+ * 4 KB header followed by the tables, each starting on a 4 KB boundary and
+ * followed by at least four bytes of zeros.  The header says what the file
+ * holds and carries a checksum of everything after it; all of it is
+ * checked before the tables are used, so a stale, truncated or foreign
+ * file is rebuilt rather than trusted.
+ *
+ * Files are written under a temporary name and renamed into place, so
+ * processes racing to build the same set each see either no file or a
+ * complete one.  Mappings are shared and read-only, so the processes share
+ * one copy of each set in the page cache.  Like the heap tables, they are
+ * never released.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fmt/core.h"
+#include "galois.h"
+#include "galois_store.h"
+
+/* Bump this whenever the layout of any stored table changes. */
+constexpr unsigned GALOIS_STORE_VERSION = 1;
+
+constexpr unsigned long long GALOIS_STORE_ALIGN = 4096;
+
+static const char galois_store_magic[8] = {'G', 'F', 'T', 'A',
+                                           'B', 'L', 'E', 'S'};
+
+static const char *const galois_store_names[] = {NULL, "log", "mult",
+                                                 "split_w8"};
+
+struct galois_store_header {
+    char magic[8];
+    unsigned version;
+    unsigned kind;
+    unsigned w;
+    unsigned poly;
+    unsigned ntables;
+    unsigned unused;
+    unsigned long long checksum; /* Of the file after the header */
+    unsigned long long offset[GALOIS_STORE_MAX_TABLES];
+    unsigned long long size[GALOIS_STORE_MAX_TABLES];
+};
+
+static_assert(sizeof(galois_store_header) <= GALOIS_STORE_ALIGN,
+              "the header must fit in its page");
+
+static std::mutex galois_store_lock; /* Protects the two below */
+static std::string galois_store_dir; /* Empty when there is no store */
+static unsigned galois_store_mode;
+
+unsigned galois_set_table_store(const char *dir, unsigned flags) {
+    struct stat st;
+
+    if ((flags & ~GALOIS_STORE_HUGE_PAGES) != 0)
+        return -1;
+    if (dir != NULL && (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode)))
+        return -1;
+
+    std::lock_guard<std::mutex> guard(galois_store_lock);
+    galois_store_dir = (dir == NULL) ? "" : dir;
+    galois_store_mode = flags;
+    return 0;
+}
+
+/* Sets path to the file for a set, and flags to the store's flags.
+   Returns false if there is no store. */
+static bool galois_store_path(unsigned kind, unsigned w, std::string &path,
+                              unsigned &flags) {
+    std::lock_guard<std::mutex> guard(galois_store_lock);
+
+    if (galois_store_dir.empty())
+        return false;
+    path = fmt::format("{}/galois-{}-w{}-v{}.tbl", galois_store_dir,
+                       galois_store_names[kind], w, GALOIS_STORE_VERSION);
+    flags = galois_store_mode;
+    return true;
+}
+
+/* Fills in the header a file for this set must have, apart from the
+   checksum, and returns the size of the file. */
+static unsigned long long
+galois_store_layout(galois_store_header *h, unsigned kind, unsigned w,
+                    unsigned poly, unsigned n, const unsigned long *sizes) {
+    unsigned long long off;
+    unsigned i;
+
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, galois_store_magic, sizeof(h->magic));
+    h->version = GALOIS_STORE_VERSION;
+    h->kind = kind;
+    h->w = w;
+    h->poly = poly;
+    h->ntables = n;
+
+    off = GALOIS_STORE_ALIGN;
+    for (i = 0; i < n; i++) {
+        h->offset[i] = off;
+        h->size[i] = sizes[i];
+        off += (sizes[i] + 4 + GALOIS_STORE_ALIGN - 1) &
+               ~(GALOIS_STORE_ALIGN - 1);
+    }
+    return off;
+}
+
+static inline unsigned long long galois_store_rotl(unsigned long long x,
+                                                   unsigned r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+/* A 64-bit checksum of len bytes, len a multiple of 32.  Four independent
+   lanes of xxHash64-style rounds keep it running at about memory speed,
+   which matters for the 100 MB files of the larger sets. */
+static unsigned long long galois_store_checksum(const unsigned char *p,
+                                                unsigned long long len) {
+    const unsigned long long p1 = 0x9e3779b185ebca87ULL;
+    const unsigned long long p2 = 0xc2b2ae3d27d4eb4fULL;
+    unsigned long long lane[4] = {p1 + p2, p2, 0, 0 - p1};
+    unsigned long long i, v, h;
+    unsigned k;
+
+    for (i = 0; i < len; i += 32) {
+        for (k = 0; k < 4; k++) {
+            memcpy(&v, p + i + 8 * k, sizeof(v));
+            lane[k] = galois_store_rotl(lane[k] + v * p2, 31) * p1;
+        }
+    }
+
+    h = len;
+    for (k = 0; k < 4; k++)
+        h = (h ^ galois_store_rotl(lane[k], 1 + 7 * k)) * p1 + p2;
+    h ^= h >> 29;
+    h *= p2;
+    return h ^ (h >> 32);
+}
+
+/* Maps path and checks it against want, whose checksum field is ignored.
+   Returns the mapping, or NULL if the file is missing or does not match. */
+static unsigned char *galois_store_open(const std::string &path,
+                                        galois_store_header *want,
+                                        unsigned long long len,
+                                        unsigned flags) {
+    const galois_store_header *h;
+    unsigned char *base;
+    struct stat st;
+    void *p;
+    int fd;
+
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) != 0 || (unsigned long long)st.st_size != len) {
+        close(fd);
+        return NULL;
+    }
+    p = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return NULL;
+    base = (unsigned char *)p;
+
+    /* Before the checksum touches the pages.  Only advice:  the kernel
+       ignores it where the filesystem cannot give huge pages. */
+    if (flags & GALOIS_STORE_HUGE_PAGES)
+        madvise(p, len, MADV_HUGEPAGE);
+
+    h = (const galois_store_header *)base;
+    want->checksum = h->checksum;
+    if (memcmp(h, want, sizeof(*want)) != 0 ||
+        galois_store_checksum(base + GALOIS_STORE_ALIGN,
+                              len - GALOIS_STORE_ALIGN) != h->checksum) {
+        munmap(p, len);
+        return NULL;
+    }
+    return base;
+}
+
+/* Writes the file for a set under a temporary name, then renames it over
+   path.  The space is allocated up front, so that running out of it is an
+   error here rather than a SIGBUS while filling the mapping. */
+static bool galois_store_write(const std::string &path,
+                               galois_store_header *h, unsigned long long len,
+                               void *const *tables) {
+    std::string tmp;
+    unsigned char *base;
+    unsigned i;
+    void *p;
+    int fd;
+
+    tmp = path + ".XXXXXX";
+    fd = mkostemp(&tmp[0], O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    p = MAP_FAILED;
+    if (fchmod(fd, 0644) == 0 && posix_fallocate(fd, 0, len) == 0)
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    base = (unsigned char *)p;
+
+    for (i = 0; i < h->ntables; i++)
+        memcpy(base + h->offset[i], tables[i], h->size[i]);
+    h->checksum = galois_store_checksum(base + GALOIS_STORE_ALIGN,
+                                        len - GALOIS_STORE_ALIGN);
+    memcpy(base, h, sizeof(*h));
+    munmap(p, len);
+
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool galois_store_map(unsigned kind, unsigned w, unsigned poly, unsigned n,
+                      const unsigned long *sizes, void **tables) {
+    galois_store_header want;
+    unsigned long long len;
+    unsigned char *base;
+    std::string path;
+    unsigned flags, i;
+
+    if (!galois_store_path(kind, w, path, flags))
+        return false;
+    len = galois_store_layout(&want, kind, w, poly, n, sizes);
+    base = galois_store_open(path, &want, len, flags);
+    if (base == NULL)
+        return false;
+    for (i = 0; i < n; i++)
+        tables[i] = base + want.offset[i];
+    return true;
+}
+
+void galois_store_offer(unsigned kind, unsigned w, unsigned poly, unsigned n,
+                        const unsigned long *sizes, void **tables) {
+    void *mapped[GALOIS_STORE_MAX_TABLES];
+    galois_store_header h;
+    unsigned long long len;
+    std::string path;
+    unsigned flags, i;
+
+    if (!galois_store_path(kind, w, path, flags))
+        return;
+    len = galois_store_layout(&h, kind, w, poly, n, sizes);
+    if (!galois_store_write(path, &h, len, tables))
+        return;
+    /* Map whatever is there now, which may be another process's copy. */
+    if (!galois_store_map(kind, w, poly, n, sizes, mapped))
+        return;
+    for (i = 0; i < n; i++) {
+        free(tables[i]);
+        tables[i] = mapped[i];
+    }
+}
@@ -0,0 +1,41 @@
+/* galois_store.h
+ *
+ * Internal interface to the persistent table store (galois_store.cpp).
+ * The create functions in galois.cpp ask the store for a table set before
+ * building it, and hand it the freshly built set afterwards.
+ *
+ * This header is not installed.
+ */
+
+#ifndef GALOIS_STORE_H
+#define GALOIS_STORE_H
+
+/* The table sets the store knows about.  A set is the tables that one
+   create function makes:  log and ilog, mult and div, or the seven
+   split_w8 tables. */
+enum galois_store_kind : unsigned {
+    GALOIS_STORE_LOG = 1,
+    GALOIS_STORE_MULT = 2,
+    GALOIS_STORE_SPLIT_W8 = 3
+};
+
+/* Up to this many tables in a set. */
+constexpr unsigned GALOIS_STORE_MAX_TABLES = 7;
+
+/* If a store is configured and holds a good file for this set, maps it
+   and points tables[0 .. n-1] at the read-only copies.  sizes[i] is the
+   size of table i in bytes, and poly the field's polynomial; a file that
+   disagrees with either, or fails its checksum, is ignored.  Returns true
+   if tables was filled in.  Each table is followed by at least four
+   readable bytes, as galois_table_alloc() guarantees. */
+bool galois_store_map(unsigned kind, unsigned w, unsigned poly, unsigned n,
+                      const unsigned long *sizes, void **tables);
+
+/* Writes a set built with malloc to the store, and if that and mapping
+   the new file both work, frees the heap copies and points tables at the
+   mapped ones.  Otherwise, including when no store is configured, tables
+   is left alone; the store is only a cache. */
+void galois_store_offer(unsigned kind, unsigned w, unsigned poly, unsigned n,
+                        const unsigned long *sizes, void **tables);
+
+#endif
@@ -0,0 +1,268 @@
+/* galois_stream.cpp
+ *
+ * The streaming encoder.  Stripe s goes through ring slot s % depth, and
+ * the slot moves from empty to read to encoded and back to empty as the
+ * reader, the encoder and the writer take their turns with it.  Each stage
+ * handles the stripes in order, so a stage only ever waits for one slot to
+ * reach the state it needs, and whoever holds a slot in its state owns the
+ * buffer; the mutex is only taken to change states.  The first error stops
+ * all three stages.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fmt/core.h"
+#include "galois_rs.h"
+#include "galois_stream.h"
+
+namespace {
+
+enum galois_stream_state : unsigned { SLOT_EMPTY, SLOT_READ, SLOT_ENCODED };
+
+struct galois_stream_slot {
+    char *buf = nullptr;              /* k + m blocks, data first */
+    std::vector<char *> data, parity; /* The blocks of buf */
+    unsigned state = SLOT_EMPTY;
+};
+
+struct galois_stream_pipeline {
+    const galois_rs_code *code = nullptr;
+    unsigned k = 0, m = 0, block_size = 0;
+    unsigned long long nstripes = 0;
+    int in = -1;
+    std::vector<int> out;
+    std::vector<galois_stream_slot> slots;
+
+    std::mutex lock; /* Protects the slot states and error */
+    std::condition_variable cv;
+    int error = 0; /* errno of the first failure */
+
+    ~galois_stream_pipeline() { release(); }
+
+    void release() {
+        if (in >= 0)
+            close(in);
+        in = -1;
+        for (int fd : out) {
+            if (fd >= 0)
+                close(fd);
+        }
+        out.clear();
+        for (galois_stream_slot &s : slots)
+            free(s.buf);
+        slots.clear();
+    }
+
+    galois_stream_slot &slot(unsigned long long s) {
+        return slots[s % slots.size()];
+    }
+
+    /* Waits for stripe s's slot to be in state.  Returns false if a stage
+       has failed. */
+    bool wait(unsigned long long s, unsigned state) {
+        std::unique_lock<std::mutex> lk(lock);
+        cv.wait(lk, [&] { return error != 0 || slot(s).state == state; });
+        return error == 0;
+    }
+
+    void advance(unsigned long long s, unsigned state) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            slot(s).state = state;
+        }
+        cv.notify_all();
+    }
+
+    void fail(int err) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (error == 0)
+                error = (err != 0) ? err : EIO;
+        }
+        cv.notify_all();
+    }
+
+    void reader();
+    void encoder();
+    void writer();
+    int run(const char *input, const char *const *shards, unsigned depth);
+};
+
+} // namespace
+
+/* Reads stripe after stripe into the ring.  Past the end of the input the
+   stripe is filled with zeros. */
+void galois_stream_pipeline::reader() {
+    unsigned long long s, off;
+    size_t want, got;
+    ssize_t n;
+
+    want = (size_t)k * block_size;
+    for (s = 0; s < nstripes; s++) {
+        if (!wait(s, SLOT_EMPTY))
+            return;
+        galois_stream_slot &sl = slot(s);
+        off = s * want;
+        for (got = 0; got < want; got += n) {
+            n = pread(in, sl.buf + got, want - got, off + got);
+            if (n < 0 && errno == EINTR) {
+                n = 0;
+                continue;
+            }
+            if (n < 0) {
+                fail(errno);
+                return;
+            }
+            if (n == 0)
+                break;
+        }
+        memset(sl.buf + got, 0, want - got);
+        advance(s, SLOT_READ);
+    }
+}
+
+void galois_stream_pipeline::encoder() {
+    unsigned long long s;
+
+    for (s = 0; s < nstripes; s++) {
+        if (!wait(s, SLOT_READ))
+            return;
+        galois_stream_slot &sl = slot(s);
+        galois_rs_encode(code, sl.data.data(), sl.parity.data(), block_size);
+        advance(s, SLOT_ENCODED);
+    }
+}
+
+/* Writes every block of a stripe to its shard, then frees the slot. */
+void galois_stream_pipeline::writer() {
+    unsigned long long s, off;
+    size_t done;
+    unsigned i;
+    ssize_t n;
+
+    for (s = 0; s < nstripes; s++) {
+        if (!wait(s, SLOT_ENCODED))
+            return;
+        galois_stream_slot &sl = slot(s);
+        off = s * block_size;
+        for (i = 0; i < k + m; i++) {
+            for (done = 0; done < block_size; done += n) {
+                n = pwrite(out[i], sl.buf + (size_t)i * block_size + done,
+                           block_size - done, off + done);
+                if (n < 0 && errno == EINTR) {
+                    n = 0;
+                    continue;
+                }
+                if (n <= 0) {
+                    fail((n < 0) ? errno : EIO);
+                    return;
+                }
+            }
+        }
+        advance(s, SLOT_EMPTY);
+    }
+}
+
+/* Returns 0, or the errno of the first failure. */
+int galois_stream_pipeline::run(const char *input, const char *const *shards,
+                                unsigned depth) {
+    unsigned long long stripe;
+    std::thread read_thread, write_thread;
+    unsigned i, j, nslots;
+    struct stat st;
+    void *buf;
+    int fd;
+
+    in = open(input, O_RDONLY | O_CLOEXEC);
+    if (in < 0 || fstat(in, &st) != 0)
+        return errno;
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+    for (i = 0; i < k + m; i++) {
+        fd = open(shards[i], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return errno;
+        out.push_back(fd);
+    }
+
+    stripe = (unsigned long long)k * block_size;
+    nstripes = ((unsigned long long)st.st_size + stripe - 1) / stripe;
+    if (nstripes == 0)
+        return 0;
+
+    nslots = (unsigned)std::min<unsigned long long>(depth, nstripes);
+    slots.resize(nslots);
+    for (galois_stream_slot &sl : slots) {
+        if (posix_memalign(&buf, 4096, (size_t)(k + m) * block_size) != 0)
+            return ENOMEM;
+        sl.buf = (char *)buf;
+        for (j = 0; j < k; j++)
+            sl.data.push_back(sl.buf + (size_t)j * block_size);
+        for (j = 0; j < m; j++)
+            sl.parity.push_back(sl.buf + (size_t)(k + j) * block_size);
+    }
+
+    try {
+        read_thread = std::thread([this] { reader(); });
+        write_thread = std::thread([this] { writer(); });
+    } catch (const std::system_error &) {
+        fail(EAGAIN);
+    }
+
+    try {
+        encoder();
+    } catch (...) {
+        fail(ECANCELED);
+        if (read_thread.joinable())
+            read_thread.join();
+        if (write_thread.joinable())
+            write_thread.join();
+        throw;
+    }
+    if (read_thread.joinable())
+        read_thread.join();
+    if (write_thread.joinable())
+        write_thread.join();
+    return error;
+}
+
+unsigned galois_stream_encode_file(const galois_rs_code *code,
+                                   const char *input,
+                                   const char *const *shards,
+                                   const galois_stream_options *options) {
+    galois_stream_pipeline p;
+    unsigned depth, w;
+    int err;
+
+    p.block_size = (options != NULL && options->block_size != 0)
+                       ? options->block_size
+                       : 1 << 20;
+    depth = (options != NULL && options->depth != 0) ? options->depth : 4;
+    if (p.block_size % 64 != 0 || depth < 2) {
+        throw std::invalid_argument(fmt::format(
+            "galois_stream_encode_file - bad block_size={} or depth={}",
+            p.block_size, depth));
+    }
+    p.code = code;
+    galois_rs_get_params(code, &p.k, &p.m, &w);
+
+    err = p.run(input, shards, depth);
+    p.release();
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
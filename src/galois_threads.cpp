@@ -0,0 +1,205 @@
+/* galois_threads.cpp
+ *
+ * A small fixed-size thread pool, and the parallel region multiplies that
+ * use it.  The pool runs one parallel_for at a time: the submitter publishes
+ * the job under the pool lock and bumps a generation counter, every worker
+ * runs it exactly once, pulling indices from a shared atomic counter, and
+ * the submitter waits until the last worker has checked back in.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "galois.h"
+#include "galois_threads.h"
+
+namespace {
+
+struct galois_pool_state {
+    std::mutex submit; /* Held for the whole of a parallel_for or a resize */
+
+    std::mutex lock; /* Protects everything below */
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    std::vector<std::thread> threads;
+    const std::function<void(unsigned)> *fn = nullptr;
+    unsigned n = 0;
+    unsigned active = 0; /* Workers that have not finished this generation */
+    unsigned long generation = 0;
+    bool stop = false;
+    std::exception_ptr error;
+
+    std::atomic<unsigned> next{0};
+    std::atomic<unsigned> size{1}; /* threads.size() + 1, readable any time */
+
+    ~galois_pool_state() { resize(1); }
+
+    void run_items() {
+        unsigned i;
+
+        try {
+            for (i = next.fetch_add(1); i < n; i = next.fetch_add(1))
+                (*fn)(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!error)
+                error = std::current_exception();
+            /* Make the others stop picking up work. */
+            next.store(n);
+        }
+    }
+
+    /* seen is the generation when the thread was created.  Reading it here
+       instead would miss a job submitted before the thread got the lock. */
+    void worker(unsigned long seen) {
+        std::unique_lock<std::mutex> lk(lock);
+
+        for (;;) {
+            work_cv.wait(lk, [&] { return stop || generation != seen; });
+            if (stop)
+                return;
+            seen = generation;
+            lk.unlock();
+            run_items();
+            lk.lock();
+            if (--active == 0)
+                done_cv.notify_all();
+        }
+    }
+
+    /* The caller must hold submit. */
+    void resize(unsigned nthreads) {
+        unsigned i;
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stop = true;
+        }
+        work_cv.notify_all();
+        for (auto &t : threads)
+            t.join();
+        threads.clear();
+        stop = false;
+        size.store(1);
+
+        for (i = 1; i < nthreads; i++) {
+            threads.emplace_back([this, g = generation] { worker(g); });
+            size.store(i + 1);
+        }
+    }
+};
+
+} // namespace
+
+static galois_pool_state galois_pool;
+
+unsigned galois_pool_size() { return galois_pool.size.load(); }
+
+void galois_parallel_for(unsigned n, const std::function<void(unsigned)> &fn) {
+    std::unique_lock<std::mutex> busy(galois_pool.submit, std::try_to_lock);
+    std::exception_ptr error;
+    unsigned i;
+
+    if (!busy.owns_lock() || galois_pool.threads.empty() || n < 2) {
+        for (i = 0; i < n; i++)
+            fn(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(galois_pool.lock);
+        galois_pool.fn = &fn;
+        galois_pool.n = n;
+        galois_pool.next.store(0);
+        galois_pool.active = galois_pool.threads.size();
+        galois_pool.error = nullptr;
+        galois_pool.generation++;
+    }
+    galois_pool.work_cv.notify_all();
+
+    galois_pool.run_items();
+
+    {
+        std::unique_lock<std::mutex> lk(galois_pool.lock);
+        galois_pool.done_cv.wait(lk, [] { return galois_pool.active == 0; });
+        galois_pool.fn = nullptr;
+        error = galois_pool.error;
+        galois_pool.error = nullptr;
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+unsigned galois_set_region_threads(unsigned nthreads) {
+    if (nthreads == 0)
+        nthreads = 1;
+
+    std::lock_guard<std::mutex> busy(galois_pool.submit);
+    try {
+        galois_pool.resize(nthreads);
+    } catch (const std::system_error &) {
+        galois_pool.resize(1);
+        return -1;
+    }
+    return 0;
+}
+
+unsigned galois_get_region_threads() { return galois_pool_size(); }
+
+/* Regions are split into at most one chunk per thread, each at least
+   PARALLEL_MIN_CHUNK bytes so that the hand-off cost stays small next to
+   the work.  Chunk boundaries are multiples of 64 bytes, which keeps every
+   chunk word aligned for all w.  The chunk size is rounded up, so the
+   chunks cover the whole region and the last one may be short. */
+
+constexpr unsigned PARALLEL_MIN_CHUNK = 256 * 1024;
+
+template <typename F>
+static void galois_region_parallel(unsigned nbytes, F region_fn) {
+    unsigned nchunks, chunk;
+
+    nchunks = std::min(galois_pool_size(), nbytes / PARALLEL_MIN_CHUNK);
+    if (nchunks < 2) {
+        region_fn(0, nbytes);
+        return;
+    }
+    chunk = (((unsigned long)nbytes + nchunks - 1) / nchunks + 63) & ~63u;
+    galois_parallel_for(nchunks, [&](unsigned i) {
+        unsigned off = i * chunk;
+        if (off < nbytes)
+            region_fn(off, std::min(chunk, nbytes - off));
+    });
+}
+
+void galois_w08_region_multiply_parallel(char *region, unsigned multby,
+                                         unsigned nbytes, char *r2,
+                                         unsigned add) {
+    galois_region_parallel(nbytes, [&](unsigned off, unsigned len) {
+        galois_w08_region_multiply(region + off, multby, len,
+                                   (r2 == NULL) ? NULL : r2 + off, add);
+    });
+}
+
+void galois_w16_region_multiply_parallel(char *region, unsigned multby,
+                                         unsigned nbytes, char *r2,
+                                         unsigned add) {
+    galois_region_parallel(nbytes, [&](unsigned off, unsigned len) {
+        galois_w16_region_multiply(region + off, multby, len,
+                                   (r2 == NULL) ? NULL : r2 + off, add);
+    });
+}
+
+void galois_w32_region_multiply_parallel(char *region, unsigned multby,
+                                         unsigned nbytes, char *r2,
+                                         unsigned add) {
+    galois_region_parallel(nbytes, [&](unsigned off, unsigned len) {
+        galois_w32_region_multiply(region + off, multby, len,
+                                   (r2 == NULL) ? NULL : r2 + off, add);
+    });
+}
@@ -0,0 +1,24 @@
+/* galois_threads.h
+ *
+ * Internal thread pool behind the parallel region functions.  The pool is
+ * empty until galois_set_region_threads() is called, and then holds
+ * nthreads - 1 workers; the calling thread always does its share.
+ *
+ * This header is not installed.
+ */
+
+#ifndef GALOIS_THREADS_H
+#define GALOIS_THREADS_H
+
+#include <functional>
+
+/* Number of threads, including the caller, that galois_parallel_for uses. */
+unsigned galois_pool_size();
+
+/* Calls fn(i) for each i in [0, n) on the pool and the calling thread, and
+   returns once every call has finished.  If the pool is empty, or is busy
+   with another caller's work, all the calls are made on the calling thread.
+   The first exception thrown by fn is rethrown here. */
+void galois_parallel_for(unsigned n, const std::function<void(unsigned)> &fn);
+
+#endif
@@ -0,0 +1,112 @@
+/* galois_wide.cpp
+ *
+ * GF(2^64) and GF(2^128).  The arithmetic is all in the kernels of
+ * galois_simd.cpp; this file picks them out of the dispatch table, and
+ * inverts.
+ *
+ * Inverses are y^(2^w - 2) = (y^(2^(w-1) - 1))^2, with the power built by
+ * Itoh and Tsujii's chain:  from b_k = y^(2^k - 1),
+ * b_2k = b_k^(2^k) * b_k and b_(k+1) = b_k^2 * y, so it takes w - 1
+ * squarings but only about 2 log2(w) multiplies.
+ */
+
+#include <cstddef>
+
+#include "galois_counters.h"
+#include "galois_simd.h"
+#include "galois_wide.h"
+
+template <class T, class F>
+static T galois_wide_inverse(T y, unsigned w, F multiply) {
+    unsigned n, k, i;
+    int bit;
+    T b;
+
+    n = w - 1;
+    for (bit = 31; !(n & (1u << bit)); bit--)
+        ;
+
+    b = y;
+    k = 1;
+    for (bit--; bit >= 0; bit--) {
+        T t = b;
+        for (i = 0; i < k; i++)
+            t = multiply(t, t);
+        b = multiply(t, b);
+        k *= 2;
+        if (n & (1u << bit)) {
+            b = multiply(multiply(b, b), y);
+            k++;
+        }
+    }
+    return multiply(b, b);
+}
+
+unsigned long long galois_w64_multiply(unsigned long long x,
+                                       unsigned long long y) {
+    return galois_kernels.w64_multiply(x, y);
+}
+
+unsigned long long galois_w64_inverse(unsigned long long y) {
+    if (y == 0)
+        return -1;
+    return galois_wide_inverse(y, 64, galois_kernels.w64_multiply);
+}
+
+unsigned long long galois_w64_divide(unsigned long long a,
+                                     unsigned long long b) {
+    if (b == 0)
+        return -1;
+    return galois_kernels.w64_multiply(a, galois_w64_inverse(b));
+}
+
+galois_w128 galois_w128_multiply(galois_w128 x, galois_w128 y) {
+    return galois_kernels.w128_multiply(x, y);
+}
+
+galois_w128 galois_w128_inverse(galois_w128 y) {
+    if (y.lo == 0 && y.hi == 0)
+        return galois_w128{~0ULL, ~0ULL};
+    return galois_wide_inverse(y, 128, galois_kernels.w128_multiply);
+}
+
+galois_w128 galois_w128_divide(galois_w128 a, galois_w128 b) {
+    if (b.lo == 0 && b.hi == 0)
+        return galois_w128{~0ULL, ~0ULL};
+    return galois_kernels.w128_multiply(a, galois_w128_inverse(b));
+}
+
+void galois_w64_region_multiply(char *region, unsigned long long multby,
+                                unsigned nbytes, char *r2, unsigned add) {
+    unsigned long long *ur1, *ur2;
+
+    GALOIS_COUNT_REGION(3, nbytes, r2 != NULL && add);
+    ur1 = (unsigned long long *)region;
+    ur2 = (r2 == NULL) ? ur1 : (unsigned long long *)r2;
+    galois_kernels.w64(ur1, ur2, nbytes / sizeof(*ur1), multby,
+                       (r2 != NULL && add));
+}
+
+void galois_w128_region_multiply(char *region, galois_w128 multby,
+                                 unsigned nbytes, char *r2, unsigned add) {
+    galois_w128 *ur1, *ur2;
+
+    GALOIS_COUNT_REGION(4, nbytes, r2 != NULL && add);
+    ur1 = (galois_w128 *)region;
+    ur2 = (r2 == NULL) ? ur1 : (galois_w128 *)r2;
+    galois_kernels.w128(ur1, ur2, nbytes / sizeof(*ur1), multby,
+                        (r2 != NULL && add));
+}
+
+unsigned long long galois_w64_region_mac(const char *region, unsigned nbytes,
+                                         unsigned long long h,
+                                         unsigned long long acc) {
+    return galois_kernels.w64_mac((const unsigned long long *)region,
+                                  nbytes / sizeof(unsigned long long), h, acc);
+}
+
+galois_w128 galois_w128_region_mac(const char *region, unsigned nbytes,
+                                   galois_w128 h, galois_w128 acc) {
+    return galois_kernels.w128_mac((const galois_w128 *)region,
+                                   nbytes / sizeof(galois_w128), h, acc);
+}
@@ -0,0 +1,55 @@
+/* galois_alloc_count.h
+ *
+ * Replaces the global operator new and delete of a test program with ones
+ * that count every allocation in allocations, so a test can check that a
+ * call does not allocate.  Include it in exactly one file of the program.
+ */
+
+#ifndef GALOIS_ALLOC_COUNT_H
+#define GALOIS_ALLOC_COUNT_H
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<unsigned long> allocations{0};
+
+void *operator new(size_t n) {
+    void *p;
+
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    p = malloc(n ? n : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t n) { return operator new(n); }
+
+void *operator new(size_t n, std::align_val_t align) {
+    void *p;
+
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    n = (n + (size_t)align - 1) & ~((size_t)align - 1);
+    p = aligned_alloc((size_t)align, n ? n : (size_t)align);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t n, std::align_val_t align) {
+    return operator new(n, align);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+    free(p);
+}
+
+#endif
@@ -0,0 +1,75 @@
+/* galois_parallel_test.cpp
+ *
+ * Checks that galois_wXX_region_multiply_parallel() gives the same results
+ * as the plain region multiplies, as galois.h promises, for pools of a few
+ * sizes and for region lengths that do not divide evenly among the threads,
+ * in overwrite and add mode.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "galois.h"
+
+typedef void (*region_multiply_fn)(char *, unsigned, unsigned, char *,
+                                   unsigned);
+
+/* Regions are nthreads * 256 KB plus a few bytes, so the pool splits them
+   into one chunk per thread, with a remainder. */
+constexpr unsigned CHUNK = 256 * 1024, MAX_THREADS = 5, MAX_EXTRA = 8;
+
+static int test_w(unsigned w, region_multiply_fn serial,
+                  region_multiply_fn parallel, unsigned nthreads,
+                  unsigned nbytes) {
+    std::vector<long> src(nbytes / 8 + 1), r1(nbytes / 8 + 1),
+        r2(nbytes / 8 + 1);
+    unsigned multby = (w == 32) ? 0x8badf00d : (w == 16) ? 0xbeef : 0x5b;
+    unsigned i, add;
+    int failed = 0;
+
+    for (i = 0; i < src.size(); i++)
+        src[i] = (long)(i * 0x9e3779b97f4a7c15ULL);
+    for (add = 0; add < 2; add++) {
+        for (i = 0; i < r1.size(); i++)
+            r1[i] = r2[i] = (long)(i * 2654435761ULL);
+        serial((char *)src.data(), multby, nbytes, (char *)r1.data(), add);
+        parallel((char *)src.data(), multby, nbytes, (char *)r2.data(), add);
+        if (memcmp(r1.data(), r2.data(), r1.size() * sizeof(long)) != 0) {
+            printf("w=%u threads=%u nbytes=%u add=%u: parallel result "
+                   "differs\n",
+                   w, nthreads, nbytes, add);
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+int main() {
+    unsigned nthreads, extra, nbytes;
+    int failed = 0;
+
+    for (nthreads = 3; nthreads <= MAX_THREADS; nthreads++) {
+        if (galois_set_region_threads(nthreads) != 0) {
+            printf("cannot start %u threads\n", nthreads);
+            return EXIT_FAILURE;
+        }
+        for (extra = 1; extra <= MAX_EXTRA; extra++) {
+            nbytes = nthreads * CHUNK + extra;
+            failed |= test_w(8, galois_w08_region_multiply,
+                             galois_w08_region_multiply_parallel, nthreads,
+                             nbytes);
+            if (nbytes % 2 == 0)
+                failed |= test_w(16, galois_w16_region_multiply,
+                                 galois_w16_region_multiply_parallel,
+                                 nthreads, nbytes);
+            if (nbytes % 4 == 0)
+                failed |= test_w(32, galois_w32_region_multiply,
+                                 galois_w32_region_multiply_parallel,
+                                 nthreads, nbytes);
+        }
+    }
+    galois_set_region_threads(1);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,89 @@
+/* galois_region_test.cpp
+ *
+ * Edge cases of the w = 8, 16 and 32 region multiplies with multby = 0:
+ * the product region must be all zeros (or left alone when adding into
+ * r2), including when r2 is NULL and add is set, and nothing past nbytes
+ * may be written when nbytes is not a multiple of a long.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "galois.h"
+
+typedef void (*region_multiply_fn)(char *, unsigned, unsigned, char *,
+                                   unsigned);
+
+constexpr unsigned GUARD = 0xa5;
+
+/* Fills buf with a pattern, so untouched bytes can be told apart */
+static void fill(unsigned char *buf, unsigned n) {
+    unsigned i;
+
+    for (i = 0; i < n; i++)
+        buf[i] = (unsigned char)(i * 37 + 9);
+}
+
+static int check(const char *what, unsigned w, unsigned nbytes,
+                 const unsigned char *buf, const unsigned char *expect,
+                 unsigned n) {
+    unsigned i;
+
+    for (i = 0; i < n; i++) {
+        if (buf[i] != expect[i]) {
+            printf("w=%u nbytes=%u %s: byte %u is %u, not %u\n", w, nbytes,
+                   what, i, buf[i], expect[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int test_zero(unsigned w, region_multiply_fn multiply,
+                     unsigned nbytes) {
+    alignas(16) unsigned char region[64], r2[64], expect[64];
+    unsigned used = nbytes - nbytes % (w / 8);
+    unsigned add;
+    int failed = 0;
+
+    /* Overwriting r2 */
+    fill(region, 64);
+    memset(r2, GUARD, 64);
+    memset(expect, GUARD, 64);
+    memset(expect, 0, used);
+    multiply((char *)region, 0, nbytes, (char *)r2, 0);
+    failed |= check("r2, add=0", w, nbytes, r2, expect, 64);
+
+    /* Adding 0 into r2 leaves it alone */
+    fill(region, 64);
+    memset(r2, GUARD, 64);
+    memset(expect, GUARD, 64);
+    multiply((char *)region, 0, nbytes, (char *)r2, 1);
+    failed |= check("r2, add=1", w, nbytes, r2, expect, 64);
+
+    /* In place, with and without add:  add only applies to r2 */
+    for (add = 0; add < 2; add++) {
+        fill(region, 64);
+        fill(expect, 64);
+        memset(expect, 0, used);
+        multiply((char *)region, 0, nbytes, NULL, add);
+        failed |= check(add ? "in place, add=1" : "in place, add=0", w,
+                        nbytes, region, expect, 64);
+    }
+    return failed;
+}
+
+int main() {
+    unsigned sizes[4] = {6, 7, 12, 40};
+    int failed = 0;
+    unsigned i;
+
+    for (i = 0; i < 4; i++) {
+        failed |= test_zero(8, galois_w08_region_multiply, sizes[i]);
+        failed |= test_zero(16, galois_w16_region_multiply, sizes[i]);
+        if (sizes[i] % 4 == 0)
+            failed |= test_zero(32, galois_w32_region_multiply, sizes[i]);
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
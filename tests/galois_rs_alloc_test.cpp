@@ -0,0 +1,93 @@
+/* galois_rs_alloc_test.cpp
+ *
+ * Checks that galois_rs_encode() and galois_rs_decode() do not allocate
+ * once the decoding matrix for an erasure pattern is in the cache, as
+ * galois_rs.h promises.  Every operator new in the process is counted, and
+ * the count must not move across repeated encodes, decodes that hit the
+ * cache and decodes of lost parity, for each w and matrix kind.  The
+ * rebuilt blocks must match the ones that were lost.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "galois_alloc_count.h"
+#include "galois_rs.h"
+
+constexpr unsigned K = 10, M = 4, NBYTES = 64 * 1024, ROUNDS = 100;
+
+static int test_code(unsigned w, unsigned kind) {
+    std::vector<std::vector<long>> storage(K + M + 5,
+                                           std::vector<long>(NBYTES / 8));
+    std::vector<char *> blocks(K + M), data_out(3), parity_out(2);
+    unsigned data_lost[3] = {1, 4, K + 2}, parity_lost[2] = {K, K + 3};
+    unsigned long before;
+    galois_rs_code *code;
+    unsigned i, j;
+    int failed = 0;
+
+    code = galois_rs_create(K, M, w, kind);
+    for (i = 0; i < K + M; i++)
+        blocks[i] = (char *)storage[i].data();
+    for (i = 0; i < 3; i++)
+        data_out[i] = (char *)storage[K + M + i].data();
+    for (i = 0; i < 2; i++)
+        parity_out[i] = (char *)storage[K + M + 3 + i].data();
+    for (i = 0; i < K; i++)
+        for (j = 0; j < NBYTES / 8; j++)
+            storage[i][j] = (long)(i * 0x9e3779b97f4a7c15ULL + j * 7919);
+
+    /* The first decode of a pattern fills the cache, and may allocate */
+    galois_rs_encode(code, blocks.data(), blocks.data() + K, NBYTES);
+    galois_rs_decode(code, blocks.data(), data_lost, 3, data_out.data(),
+                     NBYTES);
+    galois_rs_decode(code, blocks.data(), parity_lost, 2, parity_out.data(),
+                     NBYTES);
+
+    before = allocations.load();
+    for (i = 0; i < ROUNDS; i++) {
+        galois_rs_encode(code, blocks.data(), blocks.data() + K, NBYTES);
+        if (galois_rs_decode(code, blocks.data(), data_lost, 3,
+                             data_out.data(), NBYTES) != 0)
+            failed = 1;
+        if (galois_rs_decode(code, blocks.data(), parity_lost, 2,
+                             parity_out.data(), NBYTES) != 0)
+            failed = 1;
+    }
+    if (allocations.load() != before) {
+        printf("w=%u kind=%u: %lu allocations in %u rounds\n", w, kind,
+               allocations.load() - before, ROUNDS);
+        failed = 1;
+    }
+
+    /* The decodes rebuilt the lost data and the lost parity */
+    for (i = 0; i < 3; i++) {
+        if (memcmp(data_out[i], blocks[data_lost[i]], NBYTES) != 0) {
+            printf("w=%u kind=%u: block %u rebuilt wrong\n", w, kind,
+                   data_lost[i]);
+            failed = 1;
+        }
+    }
+    for (i = 0; i < 2; i++) {
+        if (memcmp(parity_out[i], blocks[parity_lost[i]], NBYTES) != 0) {
+            printf("w=%u kind=%u: block %u rebuilt wrong\n", w, kind,
+                   parity_lost[i]);
+            failed = 1;
+        }
+    }
+    galois_rs_free(code);
+    return failed;
+}
+
+int main() {
+    unsigned ws[3] = {8, 16, 32};
+    int failed = 0;
+    unsigned i, kind;
+
+    for (i = 0; i < 3; i++)
+        for (kind = GALOIS_RS_VANDERMONDE; kind <= GALOIS_RS_CAUCHY; kind++)
+            failed |= test_code(ws[i], kind);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+/* galois_stats_test.cpp
+ *
+ * Checks that the table byte counters of galois_stats.h only count tables
+ * that still exist:  creating a field context, using it until it builds
+ * its tables and freeing it must leave table_bytes where it was, for each
+ * method, with and without NUMA replicas.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "galois.h"
+#include "galois_ctx.h"
+#include "galois_stats.h"
+
+constexpr unsigned CYCLES = 5;
+
+/* Builds ctx's tables by using it.  split_w8 fields build their inverse
+   tables on the first inverse. */
+static void use(galois_ctx *ctx) {
+    unsigned x;
+
+    for (x = 1; x < 100; x++) {
+        galois_ctx_multiply(ctx, x, x + 12345);
+        galois_ctx_divide(ctx, x + 7, x);
+    }
+    galois_ctx_inverse(ctx, 3);
+}
+
+static int test_method(unsigned w, unsigned method) {
+    galois_stats before, after;
+    unsigned long long built;
+    galois_ctx *ctx;
+    unsigned poly, i, kind;
+    int failed = 0;
+
+    galois_ctx_get_params(galois_default_ctx(w), NULL, &poly, NULL);
+    galois_get_stats(&before);
+    for (i = 0; i < CYCLES; i++) {
+        ctx = galois_ctx_create(w, poly, method);
+        use(ctx);
+        galois_ctx_free(ctx);
+    }
+    galois_get_stats(&after);
+
+    built = 0;
+    for (kind = 0; kind < GALOIS_STATS_NTABLES; kind++) {
+        built += after.table_builds[kind] - before.table_builds[kind];
+        if (after.table_bytes[kind] != before.table_bytes[kind]) {
+            printf("w=%u method=%u: table_bytes[%u] went from %llu to %llu "
+                   "with no table left\n",
+                   w, method, kind, before.table_bytes[kind],
+                   after.table_bytes[kind]);
+            failed = 1;
+        }
+    }
+    if (built == 0) {
+        printf("w=%u method=%u: no tables were built\n", w, method);
+        failed = 1;
+    }
+    return failed;
+}
+
+static int test_all() {
+    int failed = 0;
+
+    failed |= test_method(8, GALOIS_METHOD_MULTTABLE);
+    failed |= test_method(16, GALOIS_METHOD_LOGTABLE);
+    failed |= test_method(20, GALOIS_METHOD_LOGTABLE);
+    failed |= test_method(32, GALOIS_METHOD_SPLITW8);
+    return failed;
+}
+
+int main() {
+    int failed = 0;
+
+    failed |= test_all();
+    if (galois_set_numa_replicas(1) == 0) {
+        failed |= test_all();
+        galois_set_numa_replicas(0);
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
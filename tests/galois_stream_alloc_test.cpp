@@ -0,0 +1,149 @@
+/* galois_stream_alloc_test.cpp
+ *
+ * Checks that galois_stream_encode_file() allocates nothing per stripe, as
+ * galois_stream.h promises:  encoding a file of many stripes, or one that
+ * ends partway through a stripe, must allocate exactly as often as encoding
+ * one of a few, with the same options.  Every shard must also have the
+ * length and contents galois_stream.h describes.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "galois_alloc_count.h"
+#include "galois_rs.h"
+#include "galois_stream.h"
+
+constexpr unsigned K = 4, M = 2, BLOCK = 4096, STRIPE = K * BLOCK;
+
+static bool read_file(const std::string &name, std::vector<char> *out) {
+    char buf[4096];
+    size_t n;
+    FILE *f;
+
+    out->clear();
+    f = fopen(name.c_str(), "rb");
+    if (f == NULL)
+        return false;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        out->insert(out->end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+/* Checks the shards against galois_rs_encode() of the zero-padded stripes
+   of data. */
+static bool check_shards(galois_rs_code *code,
+                         const std::vector<std::string> &names,
+                         const std::vector<char> &data) {
+    size_t nstripes = (data.size() + STRIPE - 1) / STRIPE;
+    std::vector<char> stripe(STRIPE), shard;
+    std::vector<long> parity(M * BLOCK / 8);
+    char *dptrs[K], *pptrs[M];
+    size_t s, off, n;
+    unsigned i;
+
+    for (i = 0; i < K; i++)
+        dptrs[i] = stripe.data() + i * BLOCK;
+    for (i = 0; i < M; i++)
+        pptrs[i] = (char *)parity.data() + i * BLOCK;
+
+    for (i = 0; i < K + M; i++) {
+        if (!read_file(names[i], &shard) ||
+            shard.size() != nstripes * BLOCK) {
+            printf("%zu bytes: shard %u is %zu bytes, not %zu\n",
+                   data.size(), i, shard.size(), nstripes * BLOCK);
+            return false;
+        }
+        for (s = 0; s < nstripes; s++) {
+            off = s * STRIPE;
+            n = std::min((size_t)STRIPE, data.size() - off);
+            memset(stripe.data(), 0, stripe.size());
+            memcpy(stripe.data(), data.data() + off, n);
+            galois_rs_encode(code, dptrs, pptrs, BLOCK);
+            if (memcmp(shard.data() + s * BLOCK,
+                       (i < K) ? dptrs[i] : pptrs[i - K], BLOCK) != 0) {
+                printf("%zu bytes: shard %u is wrong in stripe %zu\n",
+                       data.size(), i, s);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* Writes a file of size bytes to dir, encodes it, checks the shards, and
+   returns the allocations the encode made, or -1 if it failed. */
+static long encode_file(galois_rs_code *code, const std::string &dir,
+                        size_t size) {
+    std::vector<std::string> names;
+    std::vector<const char *> shards;
+    std::vector<char> data(size);
+    galois_stream_options opts = {BLOCK, 2};
+    std::string input = dir + "/input";
+    unsigned long before, after;
+    unsigned i, status;
+    size_t j;
+    bool ok;
+    FILE *f;
+
+    for (j = 0; j < data.size(); j++)
+        data[j] = (char)(j * 131 + j / 4096);
+    f = fopen(input.c_str(), "wb");
+    if (f == NULL || fwrite(data.data(), 1, data.size(), f) != data.size())
+        return -1;
+    fclose(f);
+    for (i = 0; i < K + M; i++)
+        names.push_back(dir + "/shard" + std::to_string(i));
+    for (i = 0; i < K + M; i++)
+        shards.push_back(names[i].c_str());
+
+    before = allocations.load();
+    status = galois_stream_encode_file(code, input.c_str(), shards.data(),
+                                       &opts);
+    after = allocations.load();
+    ok = (status == 0) && check_shards(code, names, data);
+
+    unlink(input.c_str());
+    for (i = 0; i < K + M; i++)
+        unlink(shards[i]);
+    return ok ? (long)(after - before) : -1;
+}
+
+int main() {
+    char dir[] = "/tmp/galois_stream_alloc_XXXXXX";
+    galois_rs_code *code;
+    long few, many, ragged;
+
+    if (mkdtemp(dir) == NULL) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    code = galois_rs_create(K, M, 8, GALOIS_RS_CAUCHY);
+
+    /* The first run may set up tables and thread state */
+    encode_file(code, dir, 2 * STRIPE);
+    few = encode_file(code, dir, 2 * STRIPE);
+    many = encode_file(code, dir, 64 * STRIPE);
+    ragged = encode_file(code, dir, 37 * STRIPE + BLOCK + 123);
+
+    galois_rs_free(code);
+    rmdir(dir);
+    if (few < 0 || many < 0 || ragged < 0) {
+        printf("encoding failed\n");
+        return EXIT_FAILURE;
+    }
+    if (few != many || few != ragged) {
+        printf("%ld allocations for 2 stripes, %ld for 64, %ld for 38 with "
+               "the last one short\n",
+               few, many, ragged);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}